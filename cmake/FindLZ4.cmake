@@ -0,0 +1,19 @@
+find_path(LZ4_INCLUDE_DIR NAMES lz4.h)
+find_library(LZ4_LIBRARIES NAMES lz4)
+
+if(LZ4_INCLUDE_DIR AND LZ4_LIBRARIES)
+    set(LZ4_FOUND ON)
+endif(LZ4_INCLUDE_DIR AND LZ4_LIBRARIES)
+
+if(LZ4_FOUND)
+    if (NOT LZ4_FIND_QUIETLY)
+        message(STATUS "Found lz4 includes: ${LZ4_INCLUDE_DIR}/lz4.h")
+        message(STATUS "Found lz4 library: ${LZ4_LIBRARIES}")
+    endif (NOT LZ4_FIND_QUIETLY)
+else(LZ4_FOUND)
+    if (LZ4_FIND_REQUIRED)
+        message(FATAL_ERROR "Could not find lz4 development files")
+    endif (LZ4_FIND_REQUIRED)
+endif (LZ4_FOUND)
+
+mark_as_advanced(LZ4_INCLUDE_DIR LZ4_LIBRARIES)
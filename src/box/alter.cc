@@ -89,6 +89,46 @@ access_check_ddl(uint32_t owner_uid)
 	}
 }
 
+/**
+ * Index flags follow the key parts in an _index tuple.
+ * The field is optional and is a comma-separated list
+ * of key=value pairs, e.g. "hash_func=crc32c".
+ */
+static void
+key_def_init_flags(struct key_def *key_def, struct tuple *tuple)
+{
+	uint32_t fieldno = INDEX_PART_COUNT + 1 + key_def->part_count * 2;
+	/* there is no property in the index */
+	if (tuple_field_count(tuple) <= fieldno)
+		return;
+
+	const char *flags = tuple_field_cstr(tuple, fieldno);
+	while (flags && *flags) {
+		while (isspace(*flags)) /* skip space */
+			flags++;
+		if (*flags == '\0') {
+			break;
+		} else if (strncmp(flags, "hash_func=",
+				   strlen("hash_func=")) == 0) {
+			const char *value = flags + strlen("hash_func=");
+			char name[BOX_NAME_MAX + 1];
+			size_t len = strcspn(value, ", ");
+			snprintf(name, sizeof(name), "%.*s", (int) len, value);
+			key_def->hash_func = STR2ENUM(hash_func, name);
+		} else {
+			char msg[BOX_NAME_MAX + 32];
+			size_t len = strcspn(flags, ", ");
+			snprintf(msg, sizeof(msg), "unknown option '%.*s'",
+				 (int) MIN(len, BOX_NAME_MAX), flags);
+			tnt_raise(ClientError, ER_WRONG_INDEX_OPTIONS,
+				  fieldno, msg);
+		}
+		flags = strchr(flags, ',');
+		if (flags)
+			flags++;
+	}
+}
+
 /**
  * Create a key_def object from a record in _index
  * system space.
@@ -100,6 +140,7 @@ access_check_ddl(uint32_t owner_uid)
  * - there are parts for the specified part count
  * - types of parts in the parts array are known to the system
  * - fieldno of each part in the parts array is within limits
+ * - hash function, if given in index flags, is known
  */
 struct key_def *
 key_def_new_from_tuple(struct tuple *tuple)
@@ -129,16 +170,21 @@ key_def_new_from_tuple(struct tuple *tuple)
 		field_type = STR2ENUM(field_type, field_type_str);
 		key_def_set_part(key_def, i, fieldno, field_type);
 	}
+	key_def_init_flags(key_def, tuple);
 	key_def_check(key_def);
 	scoped_guard.is_active = false;
 	return key_def;
 }
 
 static void
-space_def_init_flags(struct space_def *def, struct tuple *tuple)
+space_def_init_flags(struct space_def *def, struct tuple *tuple,
+		     uint32_t errcode)
 {
 	/* default values of flags */
 	def->temporary = false;
+	def->compress_threshold = 0;
+	def->field_offsets = 0;
+	def->dict_fields = 0;
 
 	/* there is no property in the space */
 	if (tuple_field_count(tuple) <= FLAGS)
@@ -150,6 +196,28 @@ space_def_init_flags(struct space_def *def, struct tuple *tuple)
 			flags++;
 		if (strncmp(flags, "temporary", strlen("temporary")) == 0)
 			def->temporary = true;
+		if (strncmp(flags, "compress", strlen("compress")) == 0) {
+			const char *value = flags + strlen("compress");
+			def->compress_threshold = *value == '=' ?
+				strtoul(value + 1, NULL, 10) :
+				SPACE_COMPRESS_THRESHOLD_DEFAULT;
+		}
+		if (strncmp(flags, "field_offsets=",
+			    strlen("field_offsets=")) == 0) {
+			def->field_offsets = strtoul(flags +
+				strlen("field_offsets="), NULL, 10);
+		}
+		if (strncmp(flags, "dict=", strlen("dict=")) == 0) {
+			uint32_t fieldno = strtoul(flags + strlen("dict="),
+						   NULL, 10);
+			/* The first field is usually unique. */
+			if (fieldno == 0 || fieldno >= TUPLE_DICT_FIELD_MAX) {
+				tnt_raise(ClientError, errcode, def->name,
+					  "dictionary-encoded field number "
+					  "is out of range");
+			}
+			def->dict_fields |= 1ULL << fieldno;
+		}
 		flags = strchr(flags, ',');
 		if (flags)
 			flags++;
@@ -171,7 +239,7 @@ space_def_create_from_tuple(struct space_def *def, struct tuple *tuple,
 	int engine_namelen = snprintf(def->engine_name, sizeof(def->engine_name),
 			 "%s", tuple_field_cstr(tuple, ENGINE));
 
-	space_def_init_flags(def, tuple);
+	space_def_init_flags(def, tuple, errcode);
 	space_def_check(def, namelen, engine_namelen, errcode);
 	access_check_ddl(def->uid);
 }
@@ -318,6 +386,12 @@ alter_space_commit(struct trigger *trigger, void * /* event */)
 	 */
 	rlist_swap(&alter->new_space->on_replace,
 		   &alter->old_space->on_replace);
+	/*
+	 * The tuples go along with the primary key, if there
+	 * is one.
+	 */
+	if (space_index(alter->new_space, 0) != NULL)
+		alter->new_space->bsize = alter->old_space->bsize;
 	/*
 	 * The new space is ready. Time to update the space
 	 * cache with it.
@@ -510,6 +584,14 @@ ModifySpace::prepare(struct alter_space *alter)
 			  space_name(alter->old_space),
 			  "can not switch temporary flag on a non-empty space");
 	}
+	if (def.compress_threshold == 0 &&
+	    alter->old_space->def.compress_threshold != 0 &&
+	    space_index(alter->old_space, 0) != NULL &&
+	    space_size(alter->old_space) > 0) {
+		tnt_raise(ClientError, ER_ALTER_SPACE,
+			  space_name(alter->old_space),
+			  "can not switch compress flag off on a non-empty space");
+	}
 }
 
 /** Amend the definition of the new space. */
@@ -797,6 +879,19 @@ AddIndex::alter(struct alter_space *alter)
 	Index *pk = index_find(alter->old_space, 0);
 	Index *new_index = index_find(alter->new_space, new_key_def->iid);
 
+	/*
+	 * Compressed tuples keep only the fields indexed at the
+	 * time of insertion directly addressable.
+	 */
+	if (alter->old_space->def.compress_threshold != 0 &&
+	    alter->new_space->format->field_count >
+	    alter->old_space->format->field_count &&
+	    space_size(alter->old_space) > 0) {
+		tnt_raise(ClientError, ER_ALTER_SPACE,
+			  space_name(alter->new_space),
+			  "can not index a compressed field on a non-empty space");
+	}
+
 	/* Now deal with any kind of add index during normal operation. */
 	struct iterator *it = pk->position();
 	pk->initIterator(it, ITER_ALL, NULL, 0);
@@ -37,6 +37,7 @@
 #include <stat.h>
 #include "main.h"
 #include "tuple.h"
+#include "small/slab_arena.h"
 #include "lua/call.h"
 #include "session.h"
 #include "schema.h"
@@ -52,6 +53,7 @@
 #include "cfg.h"
 #include "iobuf.h"
 #include "coio.h"
+#include "watchdog.h"
 
 static void process_ro(struct request *request, struct port *port);
 box_process_func box_process = process_ro;
@@ -132,6 +134,92 @@ box_check_readahead(int readahead)
 	}
 }
 
+/** 0 stands for the default stack size. */
+static int
+box_check_fiber_stack_size(int size)
+{
+	enum { FIBER_STACK_SIZE_MAX = 1 << 30 };
+	if (size == 0)
+		return FIBER_STACK_SIZE_DEFAULT;
+	if (size < FIBER_STACK_SIZE_MIN || size > FIBER_STACK_SIZE_MAX) {
+		tnt_raise(ClientError, ER_CFG, "fiber_stack_size",
+			  "specified value is out of bounds");
+	}
+	return size;
+}
+
+static enum say_format
+box_check_log_format(const char *format_name)
+{
+	if (format_name == NULL)
+		return SF_PLAIN;
+	enum say_format format = say_format_by_name(format_name);
+	if (format == SAY_FORMAT_MAX) {
+		tnt_raise(ClientError, ER_CFG, "log_format",
+			  "expected 'plain' or 'json'");
+	}
+	return format;
+}
+
+static void
+box_check_slab_placement(struct slab_placement *placement)
+{
+	memset(placement, 0, sizeof(*placement));
+	const char *hugepages = cfg_gets("slab_alloc_hugepages");
+	if (hugepages != NULL) {
+		placement->hugepages = (enum slab_hugepages)
+			strindex(slab_hugepages_strs, hugepages,
+				 slab_hugepages_MAX);
+		if (placement->hugepages == slab_hugepages_MAX) {
+			tnt_raise(ClientError, ER_CFG, "slab_alloc_hugepages",
+				  "expected 'off', 'madvise' or 'hugetlb'");
+		}
+	}
+	const char *numa = cfg_gets("slab_alloc_numa");
+	if (numa != NULL) {
+		placement->numa = (enum slab_numa)
+			strindex(slab_numa_strs, numa, slab_numa_MAX);
+		if (placement->numa == slab_numa_MAX) {
+			tnt_raise(ClientError, ER_CFG, "slab_alloc_numa",
+				  "expected 'default', 'interleave' or 'bind'");
+		}
+	}
+	const char *nodes = cfg_gets("slab_alloc_numa_nodes");
+	if (nodes != NULL &&
+	    slab_numa_nodes_parse(nodes, &placement->numa_nodes) != 0) {
+		tnt_raise(ClientError, ER_CFG, "slab_alloc_numa_nodes",
+			  "expected a list of NUMA nodes, such as '0-1,3'");
+	}
+}
+
+static void
+box_check_slab_alloc_defrag_threshold(double threshold)
+{
+	if (threshold < 0 || threshold >= 1) {
+		tnt_raise(ClientError, ER_CFG, "slab_alloc_defrag_threshold",
+			  "the value must be in range [0, 1)");
+	}
+}
+
+static size_t
+box_check_slab_alloc_arena(double arena)
+{
+	if (arena <= 0 || arena * 1024 * 1024 * 1024 > QUOTA_MAX) {
+		tnt_raise(ClientError, ER_CFG, "slab_alloc_arena",
+			  "the value is out of range");
+	}
+	return arena * 1024 * 1024 * 1024;
+}
+
+static void
+box_check_slab_alloc_release_period(double period)
+{
+	if (period < 0) {
+		tnt_raise(ClientError, ER_CFG, "slab_alloc_release_period",
+			  "the value must not be negative");
+	}
+}
+
 static int
 box_check_rows_per_wal(int rows_per_wal)
 {
@@ -150,8 +238,17 @@ box_check_config()
 	box_check_uri(cfg_gets("listen"), "listen");
 	box_check_uri(cfg_gets("replication_source"), "replication_source");
 	box_check_readahead(cfg_geti("readahead"));
+	box_check_fiber_stack_size(cfg_geti("fiber_stack_size"));
+	box_check_log_format(cfg_gets("log_format"));
 	box_check_rows_per_wal(cfg_geti("rows_per_wal"));
 	box_check_wal_mode(cfg_gets("wal_mode"));
+	struct slab_placement placement;
+	box_check_slab_placement(&placement);
+	box_check_slab_alloc_defrag_threshold(
+		cfg_getd("slab_alloc_defrag_threshold"));
+	box_check_slab_alloc_arena(cfg_getd("slab_alloc_arena"));
+	box_check_slab_alloc_release_period(
+		cfg_getd("slab_alloc_release_period"));
 }
 
 extern "C" void
@@ -236,6 +333,12 @@ box_set_too_long_threshold(double threshold)
 	too_long_threshold = threshold;
 }
 
+extern "C" void
+box_set_loop_stall_threshold(double threshold)
+{
+	watchdog_set_threshold(threshold);
+}
+
 extern "C" void
 box_set_readahead(int readahead)
 {
@@ -243,6 +346,36 @@ box_set_readahead(int readahead)
 	iobuf_set_readahead(readahead);
 }
 
+extern "C" void
+box_set_fiber_stack_size(int size)
+{
+	fiber_set_stack_size(box_check_fiber_stack_size(size));
+}
+
+extern "C" void
+box_set_slab_alloc_defrag_threshold(double threshold)
+{
+	box_check_slab_alloc_defrag_threshold(threshold);
+	memtx_defrag_set_threshold(threshold);
+}
+
+extern "C" void
+box_set_slab_alloc_arena(double arena)
+{
+	size_t size = box_check_slab_alloc_arena(arena);
+	if (memtx_set_quota(size) != 0) {
+		tnt_raise(ClientError, ER_CFG, "slab_alloc_arena",
+			  "the value is less than memory in use");
+	}
+}
+
+extern "C" void
+box_set_slab_alloc_release_period(double period)
+{
+	box_check_slab_alloc_release_period(period);
+	memtx_release_set_period(period);
+}
+
 extern "C" void
 box_set_panic_on_wal_error(int /* yesno */)
 {
@@ -416,10 +549,13 @@ engine_init()
 static inline void
 box_init(void)
 {
+	struct slab_placement placement;
+	box_check_slab_placement(&placement);
 	tuple_init(cfg_getd("slab_alloc_arena"),
 		   cfg_geti("slab_alloc_minimal"),
 		   cfg_geti("slab_alloc_maximal"),
-		   cfg_getd("slab_alloc_factor"));
+		   cfg_getd("slab_alloc_factor"),
+		   &placement);
 
 	stat_init();
 	stat_base = stat_register(iproto_type_strs, IPROTO_TYPE_STAT_MAX);
@@ -70,8 +70,6 @@ box_is_ro(void);
 
 /** Non zero if snapshot is in progress. */
 extern int snapshot_pid;
-/** Incremented with each next snapshot. */
-extern uint32_t snapshot_version;
 
 /**
  * Iterate over all spaces and save them to the
@@ -107,7 +105,12 @@ void box_set_log_level(int level);
 void box_set_io_collect_interval(double interval);
 void box_set_snap_io_rate_limit(double limit);
 void box_set_too_long_threshold(double threshold);
+void box_set_loop_stall_threshold(double threshold);
 void box_set_readahead(int readahead);
+void box_set_fiber_stack_size(int size);
+void box_set_slab_alloc_defrag_threshold(double threshold);
+void box_set_slab_alloc_arena(double arena);
+void box_set_slab_alloc_release_period(double period);
 
 extern struct recovery_state *recovery;
 
@@ -31,6 +31,7 @@
 #include "exception.h"
 #include "schema.h"
 #include "salad/rlist.h"
+#include "ipc.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -149,12 +150,11 @@ engine_end_recovery()
 int
 engine_checkpoint(int64_t checkpoint_id)
 {
-	static bool snapshot_is_in_progress = false;
-	if (snapshot_is_in_progress)
+	static struct ipc_latch checkpoint_latch =
+		IPC_LATCH_INITIALIZER(checkpoint_latch);
+	if (! ipc_latch_trylock(&checkpoint_latch))
 		return EINPROGRESS;
 
-	snapshot_is_in_progress = true;
-
 	/* create engine snapshot */
 	Engine *engine;
 	engine_foreach(engine) {
@@ -172,14 +172,14 @@ engine_checkpoint(int64_t checkpoint_id)
 	engine_foreach(engine) {
 		engine->commitCheckpoint();
 	}
-	snapshot_is_in_progress = false;
+	ipc_latch_unlock(&checkpoint_latch);
 	return 0;
 error:
 	int save_errno = errno;
 	/* rollback snapshot creation */
 	engine_foreach(engine)
 		engine->abortCheckpoint();
-	snapshot_is_in_progress = false;
+	ipc_latch_unlock(&checkpoint_latch);
 	return save_errno;
 }
 
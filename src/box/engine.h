@@ -48,6 +48,17 @@ enum engine_flags {
 	 * that the primary key is not changed.
 	 */
 	ENGINE_AUTO_CHECK_UPDATE = 2,
+	/**
+	 * The engine stores tuples of spaces with the
+	 * 'compress' flag partially compressed,
+	 * @sa tuple_format::compressed.
+	 */
+	ENGINE_CAN_COMPRESS = 4,
+	/**
+	 * The engine stores fields listed in the 'dict' flag
+	 * of a space dictionary-encoded, @sa tuple_format::dict.
+	 */
+	ENGINE_CAN_ENCODE = 8,
 };
 
 extern struct rlist engines;
@@ -294,6 +305,18 @@ engine_can_be_temporary(uint32_t flags)
 	return flags & ENGINE_CAN_BE_TEMPORARY;
 }
 
+static inline bool
+engine_can_compress(uint32_t flags)
+{
+	return flags & ENGINE_CAN_COMPRESS;
+}
+
+static inline bool
+engine_can_encode(uint32_t flags)
+{
+	return flags & ENGINE_CAN_ENCODE;
+}
+
 static inline bool
 engine_auto_check_update(uint32_t flags)
 {
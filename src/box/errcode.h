@@ -149,6 +149,7 @@ struct errcode_record {
 	/* 95 */_(ER_UPDATE_INTEGER_OVERFLOW,   2, "Integer overflow when performing '%c' operation on field %u") \
 	/* 96 */_(ER_GUEST_USER_PASSWORD,       2, "Setting password for guest user has no effect") \
 	/* 97 */_(ER_TRANSACTION_CONFLICT,      2, "Transaction has been aborted by conflict") \
+	/* 98 */_(ER_WRONG_INDEX_OPTIONS,       2, "Wrong index options (field %u): %s") \
 
 /*
  * !IMPORTANT! Please follow instructions at start of the file
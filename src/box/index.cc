@@ -219,6 +219,29 @@ Index::bsize() const
 	return 0;
 }
 
+bool
+Index::canRelocate() const
+{
+	return false;
+}
+
+void
+Index::relocate(struct tuple *old_tuple, struct tuple *new_tuple)
+{
+	(void) old_tuple;
+	(void) new_tuple;
+	tnt_raise(ClientError, ER_UNSUPPORTED,
+		  index_type_strs[key_def->type],
+		  "relocate()");
+}
+
+void
+Index::initIteratorAfter(struct iterator *iterator, const char *key,
+			 uint32_t part_count) const
+{
+	initIterator(iterator, ITER_GT, key, part_count);
+}
+
 void
 index_build(Index *index, Index *pk)
 {
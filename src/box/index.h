@@ -188,6 +188,22 @@ public:
 	virtual struct tuple *replace(struct tuple *old_tuple,
 				      struct tuple *new_tuple,
 				      enum dup_replace_mode mode) = 0;
+	/**
+	 * Check if the index can replace a tuple with its copy
+	 * without changing the position of the tuple in the
+	 * index, @sa relocate().
+	 */
+	virtual bool canRelocate() const;
+	/**
+	 * Replace a tuple with its copy, which lives at a
+	 * different address but has the same contents, in place,
+	 * so that iterators opened before a yield neither miss
+	 * nor repeat it. Used to move tuples around the tuple
+	 * arena when it is defragmented. Only called if
+	 * canRelocate() is true.
+	 */
+	virtual void relocate(struct tuple *old_tuple,
+			      struct tuple *new_tuple);
 	virtual size_t bsize() const;
 
 	/**
@@ -198,6 +214,16 @@ public:
 	virtual void initIterator(struct iterator *iterator,
 				  enum iterator_type type,
 				  const char *key, uint32_t part_count) const = 0;
+	/**
+	 * Position the iterator after the key in the index order
+	 * to resume a full scan of the index after a yield, or at
+	 * the beginning if @a part_count is 0. Unlike ITER_GT,
+	 * unordered indexes support it, so it is not available to
+	 * users. The default implementation uses ITER_GT.
+	 */
+	virtual void initIteratorAfter(struct iterator *iterator,
+				       const char *key,
+				       uint32_t part_count) const;
 
 	inline struct iterator *position() const
 	{
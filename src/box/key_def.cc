@@ -34,6 +34,7 @@
 
 const char *field_type_strs[] = {"UNKNOWN", "NUM", "STR", "ARRAY", "NUMBER", ""};
 STRS(index_type, ENUM_INDEX_TYPE);
+STRS(hash_func, ENUM_HASH_FUNC);
 
 const uint32_t key_mp_type[] = {
 	/* [UNKNOWN] = */ UINT32_MAX,
@@ -85,6 +86,7 @@ key_def_new(uint32_t space_id, uint32_t iid, const char *name,
 	def->space_id = space_id;
 	def->iid = iid;
 	def->is_unique = is_unique;
+	def->hash_func = MURMUR;
 	def->part_count = part_count;
 
 	memset(def->parts, 0, parts_size);
@@ -126,6 +128,8 @@ key_def_cmp(const struct key_def *key1, const struct key_def *key2)
 		return (int) key1->type < (int) key2->type ? -1 : 1;
 	if (key1->is_unique != key2->is_unique)
 		return (int) key1->is_unique < (int) key2->is_unique ? -1 : 1;
+	if (key1->hash_func != key2->hash_func)
+		return (int) key1->hash_func < (int) key2->hash_func ? -1 : 1;
 
 	return key_part_cmp(key1->parts, key1->part_count,
 			    key2->parts, key2->part_count);
@@ -201,6 +205,19 @@ key_def_check(struct key_def *key_def)
 		}
 	}
 
+	if (key_def->hash_func == hash_func_MAX) {
+		tnt_raise(ClientError, ER_MODIFY_INDEX,
+			  key_def->name,
+			  space_name(space),
+			  "unknown hash function");
+	}
+	if (key_def->hash_func != MURMUR && key_def->type != HASH) {
+		tnt_raise(ClientError, ER_MODIFY_INDEX,
+			  key_def->name,
+			  space_name(space),
+			  "hash function can only be set for HASH index");
+	}
+
 	/* validate key_def->type */
 	space->handler->engine->keydefCheck(space, key_def);
 }
@@ -234,6 +251,25 @@ space_def_check(struct space_def *def, uint32_t namelen, uint32_t engine_namelen
 				  def->name,
 			         "space does not support temporary flag");
 	}
+	if (def->compress_threshold != 0) {
+		Engine *engine = engine_find(def->engine_name);
+		if (! engine_can_compress(engine->flags))
+			tnt_raise(ClientError, ER_ALTER_SPACE,
+				  def->name,
+				  "space does not support compress flag");
+#if !defined(HAVE_LZ4)
+		tnt_raise(ClientError, ER_ALTER_SPACE,
+			  def->name,
+			  "tuple compression requires a build with LZ4");
+#endif
+	}
+	if (def->dict_fields != 0) {
+		Engine *engine = engine_find(def->engine_name);
+		if (! engine_can_encode(engine->flags))
+			tnt_raise(ClientError, ER_ALTER_SPACE,
+				  def->name,
+				  "space does not support dict flag");
+	}
 }
 
 bool
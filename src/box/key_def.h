@@ -97,6 +97,14 @@ field_type_maxlen(enum field_type type)
 ENUM(index_type, ENUM_INDEX_TYPE);
 extern const char *index_type_strs[];
 
+#define ENUM_HASH_FUNC(_) \
+	_(MURMUR,  0) /* PMurHash32, byte at a time, the default */ \
+	_(CRC32C,  1) /* CRC32C, hardware-accelerated with SSE 4.2 */ \
+	_(WYHASH,  2) /* 64-bit multiply-mix, 8 bytes at a time */ \
+
+ENUM(hash_func, ENUM_HASH_FUNC);
+extern const char *hash_func_strs[];
+
 /** Descriptor of a single part in a multipart key. */
 struct key_part {
 	uint32_t fieldno;
@@ -119,6 +127,8 @@ struct key_def {
 	enum index_type type;
 	/** Is this key unique. */
 	bool is_unique;
+	/** Hash function, only used by HASH indexes. */
+	enum hash_func hash_func;
 	/** Description of parts of a multipart index. */
 	struct key_part parts[];
 };
@@ -135,6 +145,7 @@ key_def_dup(struct key_def *def)
 					  def->type, def->is_unique,
 					  def->part_count);
 	if (dup) {
+		dup->hash_func = def->hash_func;
 		memcpy(dup->parts, def->parts,
 		       def->part_count * sizeof(*def->parts));
 	}
@@ -245,6 +256,35 @@ struct space_def {
 	 * - changes are not part of a snapshot
 	 */
 	bool temporary;
+	/**
+	 * If not 0, tuples bigger than this many bytes are
+	 * stored with the non-indexed tail compressed,
+	 * @sa tuple_format::compressed.
+	 */
+	uint32_t compress_threshold;
+	/**
+	 * If not 0, offsets of every field_offsets-th field
+	 * are cached in tuples, @sa tuple_format::offset_step.
+	 */
+	uint32_t field_offsets;
+	/**
+	 * Bit i is set if field i is dictionary-encoded,
+	 * @sa tuple_format::dict.
+	 */
+	uint64_t dict_fields;
+};
+
+enum {
+	/**
+	 * Tuple size above which tuples are compressed if
+	 * the space has the 'compress' flag without a value.
+	 */
+	SPACE_COMPRESS_THRESHOLD_DEFAULT = 1024,
+	/**
+	 * The number of leading fields covered by the field
+	 * offset cache if the space has no fixed field count.
+	 */
+	SPACE_FIELD_OFFSETS_RANGE = 256
 };
 
 /** Check space definition structure for errors. */
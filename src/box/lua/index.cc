@@ -57,6 +57,18 @@ boxffi_index_bsize(uint32_t space_id, uint32_t index_id)
        }
 }
 
+size_t
+boxffi_space_bsize(uint32_t space_id)
+{
+	try {
+		struct space *space = space_cache_find(space_id);
+		access_check_space(space, PRIV_R);
+		return space->bsize;
+	} catch (Exception *) {
+		return (size_t) -1; /* handled by box.error() in Lua */
+	}
+}
+
 size_t
 boxffi_index_len(uint32_t space_id, uint32_t index_id)
 {
@@ -202,21 +214,33 @@ boxffi_index_iterator(uint32_t space_id, uint32_t index_id, int type,
 	}
 }
 
-struct tuple*
-boxffi_iterator_next(struct iterator *itr)
+/**
+ * Check that the index of the iterator has not been altered
+ * or dropped since the iterator was created.
+ */
+static inline bool
+iterator_is_valid(struct iterator *itr)
 {
+	if (itr->sc_version == sc_version)
+		return true;
 	try {
-		if (itr->sc_version != sc_version) {
-			Index *index = check_index(itr->space_id, itr->index_id);
-			if (index != itr->index)
-				return NULL;
-			if (index->sc_version > itr->sc_version)
-				return NULL;
-			itr->sc_version = sc_version;
-		}
+		Index *index = check_index(itr->space_id, itr->index_id);
+		if (index != itr->index)
+			return false;
+		if (index->sc_version > itr->sc_version)
+			return false;
+		itr->sc_version = sc_version;
+		return true;
 	} catch (Exception *) {
-		return NULL; /* invalidate iterator */
+		return false; /* invalidate iterator */
 	}
+}
+
+struct tuple*
+boxffi_iterator_next(struct iterator *itr)
+{
+	if (! iterator_is_valid(itr))
+		return NULL;
 	try {
 		struct tuple *tuple = itr->next(itr);
 		if (tuple == NULL)
@@ -228,6 +252,29 @@ boxffi_iterator_next(struct iterator *itr)
 	}
 }
 
+int
+boxffi_iterator_next_batch(struct iterator *itr, struct tuple **tuples,
+			   int count)
+{
+	if (! iterator_is_valid(itr))
+		return 0;
+	int i = 0;
+	try {
+		for (; i < count; i++) {
+			struct tuple *tuple = itr->next(itr);
+			if (tuple == NULL)
+				break;
+			tuple_ref(tuple);
+			tuples[i] = tuple;
+		}
+		return i;
+	} catch (Exception *) {
+		while (i-- > 0)
+			tuple_unref(tuples[i]);
+		return -1; /* handled by box.error() in Lua */
+	}
+}
+
 /* }}} */
 
 void
@@ -69,9 +69,23 @@ boxffi_index_iterator(uint32_t space_id, uint32_t index_id, int type,
 size_t
 boxffi_index_bsize(uint32_t space_id, uint32_t index_id);
 
+size_t
+boxffi_space_bsize(uint32_t space_id);
+
 struct tuple*
 boxffi_iterator_next(struct iterator *itr);
 
+/**
+ * Fetch up to count tuples from the iterator into tuples[],
+ * with a reference taken on each of them, so that a Lua loop
+ * crosses the FFI boundary once per batch, not once per tuple.
+ * @return the number of tuples fetched, 0 at the end of the
+ *         iteration, -1 on error (handled by box.error()).
+ */
+int
+boxffi_iterator_next_batch(struct iterator *itr, struct tuple **tuples,
+			   int count);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
@@ -9,10 +9,15 @@ void box_set_listen(const char *uri);
 void box_set_replication_source(const char *source);
 void box_set_log_level(int level);
 void box_set_readahead(int readahead);
+void box_set_fiber_stack_size(int size);
 void box_set_io_collect_interval(double interval);
 void box_set_too_long_threshold(double threshold);
+void box_set_loop_stall_threshold(double threshold);
 void box_set_snap_io_rate_limit(double limit);
 void box_set_panic_on_wal_error(int);
+void box_set_slab_alloc_defrag_threshold(double);
+void box_set_slab_alloc_arena(double);
+void box_set_slab_alloc_release_period(double);
 ]])
 
 local log = require('log')
@@ -33,6 +38,11 @@ local default_cfg = {
     slab_alloc_minimal  = 16,
     slab_alloc_maximal  = 1024 * 1024,
     slab_alloc_factor   = 1.1,
+    slab_alloc_hugepages = nil, -- 'off'
+    slab_alloc_numa     = nil, -- 'default'
+    slab_alloc_numa_nodes = nil, -- all online nodes
+    slab_alloc_defrag_threshold = nil, -- disabled
+    slab_alloc_release_period = nil, -- disabled
     work_dir            = nil,
     snap_dir            = ".",
     wal_dir             = ".",
@@ -40,11 +50,15 @@ local default_cfg = {
     sophia              = default_sophia_cfg,
     logger              = nil,
     logger_nonblock     = true,
+    logger_async        = nil, -- false
+    log_format          = nil, -- 'plain'
     log_level           = 5,
     io_collect_interval = nil,
     readahead           = 16320,
+    fiber_stack_size    = nil, -- 65536
     snap_io_rate_limit  = nil, -- no limit
     too_long_threshold  = 0.5,
+    loop_stall_threshold = nil, -- disabled
     wal_mode            = "write",
     rows_per_wal        = 500000,
     wal_dir_rescan_delay= 0.1,
@@ -79,6 +93,11 @@ local template_cfg = {
     slab_alloc_minimal  = 'number',
     slab_alloc_maximal  = 'number',
     slab_alloc_factor   = 'number',
+    slab_alloc_hugepages = 'string',
+    slab_alloc_numa     = 'string',
+    slab_alloc_numa_nodes = 'string, number',
+    slab_alloc_defrag_threshold = 'number',
+    slab_alloc_release_period = 'number',
     work_dir            = 'string',
     snap_dir            = 'string',
     wal_dir             = 'string',
@@ -86,11 +105,15 @@ local template_cfg = {
     sophia              = sophia_template_cfg,
     logger              = 'string',
     logger_nonblock     = 'boolean',
+    logger_async        = 'boolean',
+    log_format          = 'string',
     log_level           = 'number',
     io_collect_interval = 'number',
     readahead           = 'number',
+    fiber_stack_size    = 'number',
     snap_io_rate_limit  = 'number',
     too_long_threshold  = 'number',
+    loop_stall_threshold = 'number',
     wal_mode            = 'string',
     rows_per_wal        = 'number',
     wal_dir_rescan_delay= 'number',
@@ -127,9 +150,14 @@ local dynamic_cfg = {
     log_level               = ffi.C.box_set_log_level,
     io_collect_interval     = ffi.C.box_set_io_collect_interval,
     readahead               = ffi.C.box_set_readahead,
+    fiber_stack_size        = ffi.C.box_set_fiber_stack_size,
     too_long_threshold      = ffi.C.box_set_too_long_threshold,
+    loop_stall_threshold    = ffi.C.box_set_loop_stall_threshold,
     snap_io_rate_limit      = ffi.C.box_set_snap_io_rate_limit,
     panic_on_wal_error      = ffi.C.box_set_panic_on_wal_error,
+    slab_alloc_defrag_threshold = ffi.C.box_set_slab_alloc_defrag_threshold,
+    slab_alloc_arena        = ffi.C.box_set_slab_alloc_arena,
+    slab_alloc_release_period = ffi.C.box_set_slab_alloc_release_period,
     -- snapshot_daemon
     snapshot_period         = box.internal.snapshot_daemon.set_snapshot_period,
     snapshot_count          = box.internal.snapshot_daemon.set_snapshot_count,
@@ -143,6 +171,8 @@ local dynamic_cfg_skip_at_load = {
     replication_source      = true,
     wal_dir_rescan_delay    = true,
     panic_on_wal_error      = true,
+    -- applied by tuple_init() at start
+    slab_alloc_arena        = true,
 }
 
 local function prepare_cfg(cfg, default_cfg, template_cfg, modify_cfg, prefix)
@@ -24,6 +24,8 @@ ffi.cdef[[
     boxffi_index_len(uint32_t space_id, uint32_t index_id);
     size_t
     boxffi_index_bsize(uint32_t space_id, uint32_t index_id);
+    size_t
+    boxffi_space_bsize(uint32_t space_id);
     struct tuple *
     boxffi_index_random(uint32_t space_id, uint32_t index_id, uint32_t rnd);
     struct tuple *
@@ -40,6 +42,15 @@ ffi.cdef[[
                   const char *key);
     struct tuple *
     boxffi_iterator_next(struct iterator *itr);
+    int
+    boxffi_iterator_next_batch(struct iterator *itr, struct tuple **tuples,
+                               int count);
+    struct iterator_batch {
+        int size;
+        int pos;
+        int count;
+        struct tuple *tuples[?];
+    };
 
     struct port;
     struct port_ffi
@@ -220,6 +231,9 @@ box.schema.space.create = function(name, options)
     local options_template = {
         if_not_exists = 'boolean',
         temporary = 'boolean',
+        compress = 'number',
+        field_offsets = 'number',
+        dict = 'table',
         engine = 'string',
         id = 'number',
         field_count = 'number',
@@ -261,9 +275,28 @@ box.schema.space.create = function(name, options)
     if uid == nil then
         uid = session.uid()
     end
-    local temporary = options.temporary and "temporary" or ""
+    local flags = {}
+    if options.temporary then
+        table.insert(flags, "temporary")
+    end
+    if options.compress then
+        table.insert(flags, "compress="..options.compress)
+    end
+    if options.field_offsets then
+        table.insert(flags, "field_offsets="..options.field_offsets)
+    end
+    if options.dict then
+        for _, fieldno in ipairs(options.dict) do
+            if type(fieldno) ~= 'number' then
+                box.error(box.error.ILLEGAL_PARAMS,
+                          "options.dict: expected field numbers")
+            end
+            table.insert(flags, "dict="..(fieldno - 1))
+        end
+    end
+    flags = table.concat(flags, ",")
     local format = options.format and options.format or {}
-    _space:insert{id, uid, name, options.engine, options.field_count, temporary, format}
+    _space:insert{id, uid, name, options.engine, options.field_count, flags, format}
     return box.space[id], "created"
 end
 
@@ -358,6 +391,7 @@ box.schema.index.create = function(space_id, name, options)
         unique = 'boolean',
         id = 'number',
         if_not_exists = 'boolean',
+        hash_func = 'string',
     }
     local options_defaults = {
         type = 'tree',
@@ -394,8 +428,12 @@ box.schema.index.create = function(space_id, name, options)
     if options.id then
         iid = options.id
     end
-    _index:insert{space_id, iid, name, options.type,
-                  unique, part_count, unpack(options.parts)}
+    local tuple = {space_id, iid, name, options.type,
+                   unique, part_count, unpack(options.parts)}
+    if options.hash_func then
+        table.insert(tuple, 'hash_func='..options.hash_func)
+    end
+    _index:insert(tuple)
     return box.space[space_id].index[name]
 end
 
@@ -433,6 +471,7 @@ box.schema.index.alter = function(space_id, index_id, options)
         parts = 'table',
         unique = 'boolean',
         id = 'number',
+        hash_func = 'string',
     }
     check_param_table(options, options_template)
 
@@ -474,14 +513,26 @@ box.schema.index.alter = function(space_id, index_id, options)
     if options.unique == nil then
         options.unique = tuple[5]
     end
+    local part_count = tuple[6]
+    -- index flags, if any, follow the parts
+    local flags = tuple[7 + part_count * 2]
     if options.parts == nil then
-        options.parts = {tuple:slice(6)} -- not part count
+        -- not part count
+        options.parts = {tuple:slice(6, 6 + part_count * 2)}
     else
         check_index_parts(options.parts)
         options.parts = update_index_parts(options.parts)
     end
-    _index:replace{space_id, index_id, options.name, options.type,
-                   options.unique, #options.parts/2, unpack(options.parts)}
+    if options.hash_func ~= nil then
+        flags = 'hash_func='..options.hash_func
+    end
+    local new_tuple = {space_id, index_id, options.name, options.type,
+                       options.unique, #options.parts/2,
+                       unpack(options.parts)}
+    if flags ~= nil then
+        table.insert(new_tuple, flags)
+    end
+    _index:replace(new_tuple)
 end
 
 local function keify(key)
@@ -569,6 +620,42 @@ local iterator_cdata_gc = function(iterator)
     return iterator.free(iterator)
 end
 
+local iterator_batch_t = ffi.typeof('struct iterator_batch')
+
+local iterator_batch_gc = function(batch)
+    -- release tuples which have been fetched but not returned
+    for i = batch.pos, batch.count - 1 do
+        builtin.tuple_unref(batch.tuples[i])
+    end
+end
+
+local iterator_batch_gen = function(param, state)
+    --[[
+        The same as iterator_gen(), but tuples are fetched from the
+        index *param[2].size* at a time, to cross the Lua/C boundary
+        once per batch. *param[2]* is a buffer of fetched tuples, the
+        only part of *param* which changes during iteration.
+    --]]
+    if not ffi.istype(iterator_t, state) then
+        error('usage gen(param, state)')
+    end
+    local batch = param[2]
+    if batch.pos == batch.count then
+        local count = builtin.boxffi_iterator_next_batch(state, batch.tuples,
+                                                         batch.size)
+        if count == -1 then
+            return box.error() -- error
+        elseif count == 0 then
+            return nil
+        end
+        batch.pos = 0
+        batch.count = count
+    end
+    local tuple = batch.tuples[batch.pos]
+    batch.pos = batch.pos + 1
+    return state, box.tuple.bless(tuple) -- new state, value
+end
+
 -- global struct port instance to use by select()/get()
 local port = ffi.new('struct port_ffi')
 builtin.port_ffi_create(port)
@@ -668,14 +755,28 @@ function box.schema.space.bless(space)
         local pkey, pkey_end = msgpackffi.encode_tuple(key)
         local itype = check_iterator_type(opts, pkey + 1 >= pkey_end);
 
+        local batch_size = opts and opts.batch
+        if batch_size ~= nil and (type(batch_size) ~= 'number' or
+                                  batch_size < 1) then
+            box.error(box.error.ILLEGAL_PARAMS,
+                      "options parameter 'batch' should be a positive number")
+        end
+
         local keybuf = ffi.string(pkey, pkey_end - pkey)
         local cdata = builtin.boxffi_index_iterator(index.space_id, index.id,
             itype, keybuf);
         if cdata == nil then
             box.error()
         end
+        cdata = ffi.gc(cdata, iterator_cdata_gc)
 
-        return fun.wrap(iterator_gen, keybuf, ffi.gc(cdata, iterator_cdata_gc))
+        if batch_size == nil then
+            return fun.wrap(iterator_gen, keybuf, cdata)
+        end
+        local batch = ffi.new(iterator_batch_t, batch_size)
+        batch.size = batch_size
+        return fun.wrap(iterator_batch_gen,
+                        { keybuf, ffi.gc(batch, iterator_batch_gc) }, cdata)
     end
     index_mt.__pairs = index_mt.pairs -- Lua 5.2 compatibility
     index_mt.__ipairs = index_mt.pairs -- Lua 5.2 compatibility
@@ -777,6 +878,13 @@ function box.schema.space.bless(space)
         end
         return space.index[0]:len()
     end
+    space_mt.bsize = function(space)
+        local ret = builtin.boxffi_space_bsize(space.id)
+        if ret == -1 then
+            box.error()
+        end
+        return tonumber(ret)
+    end
     space_mt.__newindex = index_mt.__newindex
 
     space_mt.get = function(space, key)
@@ -854,13 +962,13 @@ function box.schema.space.bless(space)
         end
     end
 
-    space_mt.pairs = function(space, key)
+    space_mt.pairs = function(space, key, opts)
         if space.index[0] == nil then
             -- empty space without indexes, return empty iterator
             return fun.iter({})
         end
         check_index(space, 0)
-        return space.index[0]:pairs(key)
+        return space.index[0]:pairs(key, opts)
     end
     space_mt.__pairs = space_mt.pairs -- Lua 5.2 compatibility
     space_mt.__ipairs = space_mt.pairs -- Lua 5.2 compatibility
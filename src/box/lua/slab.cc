@@ -36,6 +36,7 @@ extern "C" {
 } /* extern "C" */
 
 #include "box/tuple.h"
+#include "box/memtx_engine.h"
 #include "small/small.h"
 #include "small/quota.h"
 #include "memory.h"
@@ -134,6 +135,69 @@ lbox_slab_info(struct lua_State *L)
 	return 1;
 }
 
+static void
+lbox_slab_placement_push(struct lua_State *L, struct slab_arena *arena)
+{
+	lua_newtable(L);
+
+	lua_pushstring(L, "hugepages");
+	lua_pushstring(L, slab_hugepages_strs[arena->placement.hugepages]);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "numa");
+	lua_pushstring(L, slab_numa_strs[arena->placement.numa]);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "hugetlb_size");
+	luaL_pushuint64(L, arena->hugetlb_size);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "madvise_size");
+	luaL_pushuint64(L, arena->madvise_size);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "numa_size");
+	luaL_pushuint64(L, arena->numa_size);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "errors");
+	luaL_pushuint64(L, arena->placement_errors);
+	lua_settable(L, -3);
+}
+
+/**
+ * Huge page and NUMA placement statistics of the tuple
+ * and index arenas.
+ */
+static int
+lbox_slab_placement(struct lua_State *L)
+{
+	lua_newtable(L);
+
+	lua_pushstring(L, "tuple");
+	lbox_slab_placement_push(L, &memtx_arena);
+	lua_settable(L, -3);
+
+	struct slab_arena *index_arena = memtx_index_arena_get();
+	if (index_arena != NULL) {
+		lua_pushstring(L, "index");
+		lbox_slab_placement_push(L, index_arena);
+		lua_settable(L, -3);
+	}
+	return 1;
+}
+
+/**
+ * Move tuples out of sparsely populated slabs of the tuple
+ * arena, return the number of moved tuples.
+ */
+static int
+lbox_slab_defrag(struct lua_State *L)
+{
+	luaL_pushuint64(L, memtx_defrag());
+	return 1;
+}
+
 static int
 lbox_runtime_info(struct lua_State *L)
 {
@@ -173,6 +237,14 @@ box_lua_slab_init(struct lua_State *L)
 	lua_pushcfunction(L, lbox_slab_check);
 	lua_settable(L, -3);
 
+	lua_pushstring(L, "placement");
+	lua_pushcfunction(L, lbox_slab_placement);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "defrag");
+	lua_pushcfunction(L, lbox_slab_defrag);
+	lua_settable(L, -3);
+
 	lua_settable(L, -3); /* box.slab */
 
 	lua_pushstring(L, "runtime");
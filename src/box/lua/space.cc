@@ -165,6 +165,11 @@ lbox_fillspace(struct lua_State *L, struct space *space, int i)
 		lua_pushstring(L, index_type_strs[key_def->type]);
 		lua_setfield(L, -2, "type");
 
+		if (key_def->hash_func != MURMUR) {
+			lua_pushstring(L, hash_func_strs[key_def->hash_func]);
+			lua_setfield(L, -2, "hash_func");
+		}
+
 		lua_pushnumber(L, key_def->iid);
 		lua_setfield(L, -2, "id");
 
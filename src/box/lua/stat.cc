@@ -39,6 +39,8 @@ extern "C" {
 } /* extern "C" */
 
 #include "lua/utils.h"
+#include "box/space.h"
+#include "box/schema.h"
 
 static void
 fill_stat_item(struct lua_State *L, int rps, int64_t total)
@@ -99,6 +101,55 @@ lbox_stat_call(struct lua_State *L)
 	return 1;
 }
 
+static void
+set_space_stat_item(struct space *space, void *cb_ctx)
+{
+	struct lua_State *L = (struct lua_State *) cb_ctx;
+	if (! space_is_memtx(space))
+		return;
+	struct space_stat *stat = space_stat(space);
+
+	lua_pushstring(L, space_name(space));
+	lua_newtable(L);
+
+	lua_pushstring(L, "bsize");
+	luaL_pushint64(L, stat->bsize);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "index");
+	lua_newtable(L);
+	for (struct index_stat *index = stat->index; index->id != -1;
+	     index++) {
+		lua_pushnumber(L, index->id);
+		lua_newtable(L);
+
+		lua_pushstring(L, "keys");
+		luaL_pushint64(L, index->keys);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "bsize");
+		luaL_pushint64(L, index->bsize);
+		lua_settable(L, -3);
+
+		lua_settable(L, -3);
+	}
+	lua_settable(L, -3);
+
+	lua_settable(L, -3);
+}
+
+/**
+ * box.stat.spaces() - memory occupied by tuples and indexes
+ * of each memtx space.
+ */
+static int
+lbox_stat_spaces(struct lua_State *L)
+{
+	lua_newtable(L);
+	space_foreach(set_space_stat_item, L);
+	return 1;
+}
+
 static const struct luaL_reg lbox_stat_meta [] = {
 	{"__index", lbox_stat_index},
 	{"__call",  lbox_stat_call},
@@ -110,6 +161,7 @@ void
 box_lua_stat_init(struct lua_State *L)
 {
 	static const struct luaL_reg statlib [] = {
+		{"spaces", lbox_stat_spaces},
 		{NULL, NULL}
 	};
 
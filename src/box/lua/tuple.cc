@@ -373,3 +373,9 @@ boxffi_tuple_update(struct tuple *tuple, const char *expr, const char *expr_end)
 		return NULL;
 	}
 }
+
+bool
+boxffi_tuple_is_packed(const struct tuple *tuple)
+{
+	return tuple_format_is_packed(tuple_format(tuple));
+}
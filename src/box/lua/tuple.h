@@ -54,6 +54,9 @@ extern "C" {
 struct tuple *
 boxffi_tuple_update(struct tuple *tuple, const char *expr, const char *expr_end);
 
+bool
+boxffi_tuple_is_packed(const struct tuple *tuple);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif
@@ -5,11 +5,11 @@ local yaml = require('yaml')
 local msgpackffi = require('msgpackffi')
 local fun = require('fun')
 local internal = require('box.internal')
+require('digest') -- declares PMurHash32()
 
 ffi.cdef([[
 struct tuple
 {
-    uint32_t _version;
     uint16_t _refs;
     uint16_t _format_id;
     uint32_t _bsize;
@@ -26,6 +26,7 @@ tuple_field(const struct tuple *tuple, uint32_t i);
 struct tuple_iterator {
     const struct tuple *tuple;
     const char *pos;
+    const char *end;
     int fieldno;
 };
 
@@ -38,11 +39,17 @@ tuple_seek(struct tuple_iterator *it, uint32_t field_no);
 const char *
 tuple_next(struct tuple_iterator *it);
 
-void
-tuple_to_buf(struct tuple *tuple, char *buf);
+const char *
+tuple_data_range(const struct tuple *tuple, uint32_t *p_size);
 
 struct tuple *
 boxffi_tuple_update(struct tuple *tuple, const char *expr, const char *expr_end);
+
+bool
+boxffi_tuple_is_packed(const struct tuple *tuple);
+
+int
+memcmp(const void *s1, const void *s2, size_t n);
 ]])
 
 local builtin = ffi.C
@@ -168,11 +175,110 @@ local function tuple_update(tuple, expr)
     return tuple_bless(tuple)
 end
 
+--
+-- Field accessors which look at the tuple data in place. Unlike
+-- tuple[i], they never create Lua strings, so a filter over
+-- millions of tuples does not intern every string it looks at.
+--
+local const_uint8_ptr_t = ffi.typeof('const uint8_t *')
+local char_array_t = ffi.typeof('char[?]')
+
+-- The same seed as in digest.murmur()
+local MURMUR_SEED = 13
+
+-- Return a pointer to the data of a string field and its length,
+-- or nil if the field is missing or is not a string. The data of
+-- a compressed tuple lives in a small cache of decompressed
+-- tuples, so the pointer is only valid until the next access
+-- to the tuple data.
+local function tuple_field_string_raw(tuple, field_n)
+    local field = builtin.tuple_field(tuple, field_n - 1)
+    if field == nil then
+        return nil
+    end
+    local p = ffi.cast(const_uint8_ptr_t, field)
+    local c = p[0]
+    if c >= 0xa0 and c <= 0xbf then
+        return field + 1, c - 0xa0 -- fixstr
+    elseif c == 0xd9 then
+        return field + 2, p[1]
+    elseif c == 0xda then
+        return field + 3, p[1] * 0x100 + p[2]
+    elseif c == 0xdb then
+        return field + 5, ((p[1] * 0x100 + p[2]) * 0x100 + p[3]) * 0x100 + p[4]
+    end
+    return nil
+end
+
+-- Return the data of a string field and its length, or nil if
+-- the field is missing or is not a string. The data of a tuple
+-- of a compressed or dictionary-encoded space is not stored in
+-- the tuple, so it is copied: the result stays valid as long as
+-- it is referenced. Otherwise it points into the tuple and stays
+-- valid as long as the tuple is referenced.
+local function tuple_field_string(tuple, field_n)
+    local data, len = tuple_field_string_raw(tuple, field_n)
+    if data == nil or not builtin.boxffi_tuple_is_packed(tuple) then
+        return data, len
+    end
+    local copy = ffi.new(char_array_t, len)
+    ffi.copy(copy, data, len)
+    return copy, len
+end
+
+-- Return a numeric field as a Lua number, or nil if the field is
+-- missing or is not a number. 64-bit integers beyond 2^53 are
+-- rounded, as tonumber() does.
+local function tuple_field_number(tuple, field_n)
+    local field = builtin.tuple_field(tuple, field_n - 1)
+    if field == nil then
+        return nil
+    end
+    local c = ffi.cast(const_uint8_ptr_t, field)[0]
+    if c <= 0x7f or c >= 0xe0 or (c >= 0xca and c <= 0xd3) then
+        -- Use () to shrink stack to the first return value
+        return tonumber((msgpackffi.decode_unchecked(field)))
+    end
+    return nil
+end
+
+-- Compare a string field with a Lua string, like memcmp():
+-- a negative number, 0 or a positive number. Returns nil if
+-- the field is not a string.
+local function tuple_field_compare(tuple, field_n, str)
+    if type(str) ~= 'string' then
+        error("Usage: tuple:field_compare(field_number, string)")
+    end
+    local data, len = tuple_field_string_raw(tuple, field_n)
+    if data == nil then
+        return nil
+    end
+    local r = builtin.memcmp(data, str, math.min(len, #str))
+    if r ~= 0 then
+        return r
+    end
+    return len - #str
+end
+
+-- Hash a string field, the result is equal to
+-- digest.murmur(tuple[field_n]). Returns nil if the field
+-- is not a string.
+local function tuple_field_hash(tuple, field_n)
+    local data, len = tuple_field_string_raw(tuple, field_n)
+    if data == nil then
+        return nil
+    end
+    return builtin.PMurHash32(MURMUR_SEED, data, len)
+end
+
 -- Set encode hooks for msgpackffi
+local tuple_bsize = ffi.new('uint32_t[1]')
 local function tuple_to_msgpack(buf, tuple)
-    buf:reserve(tuple._bsize)
-    builtin.tuple_to_buf(tuple, buf.p)
-    buf.p = buf.p + tuple._bsize
+    local data = builtin.tuple_data_range(tuple, tuple_bsize)
+    local bsize = tuple_bsize[0]
+    buf:reserve(bsize)
+    ffi.copy(buf.p, data, bsize)
+    buf.p = buf.p + bsize
 end
 
 msgpackffi.on_encode(ffi.typeof('const struct tuple &'), tuple_to_msgpack)
@@ -191,6 +297,10 @@ local methods = {
     ["unpack"]      = tuple_unpack;
     ["totable"]     = tuple_totable;
     ["update"]      = tuple_update;
+    ["field_string"]  = tuple_field_string;
+    ["field_number"]  = tuple_field_number;
+    ["field_compare"] = tuple_field_compare;
+    ["field_hash"]    = tuple_field_hash;
     ["bsize"]       = function(tuple)
         return tonumber(tuple._bsize)
     end;
@@ -112,7 +112,7 @@ MemtxBitset::size() const
 size_t
 MemtxBitset::bsize() const
 {
-	return 0;
+	return bitset_index_bsize(&index);
 }
 
 struct iterator *
@@ -177,6 +177,10 @@ MemtxBitset::replace(struct tuple *old_tuple, struct tuple *new_tuple,
 			ret = old_tuple;
 
 			assert(old_tuple != new_tuple);
+			if (bitset_index_reserve_remove(&index) != 0) {
+				tnt_raise(ClientError, ER_MEMORY_ISSUE, 0,
+					  "MemtxBitset", "delete");
+			}
 			bitset_index_remove_value(&index, value);
 		}
 	}
@@ -318,6 +322,9 @@ MemtxBitset::count(enum iterator_type type, const char *key,
 			return bitset_index_size(&index) - bitset_index_count(&index, bit);
 	}
 
-	/* Call generic method */
-	return Index::count(type, key, part_count);
+	/* Evaluate the expression page by page, see bitset_iterator_count() */
+	struct iterator *it = position();
+	initIterator(it, type, key, part_count);
+	IteratorGuard guard(it);
+	return bitset_iterator_count(&bitset_index_iterator(it)->bitset_it);
 }
@@ -37,6 +37,7 @@
 #include "memtx_bitset.h"
 #include "space.h"
 #include "salad/rlist.h"
+#include "small/small.h"
 #include "request.h"
 #include <stdlib.h>
 #include <string.h>
@@ -47,7 +48,7 @@
 #include "recovery.h"
 #include "schema.h"
 #include "main.h"
-#include "coeio_file.h"
+#include "coeio.h"
 #include "coio.h"
 #include "errinj.h"
 #include "scoped_guard.h"
@@ -136,6 +137,7 @@ memtx_replace_build_next(struct txn * /* txn */, struct space *space,
 	}
 	space->index[0]->buildNext(new_tuple);
 	tuple_ref(new_tuple);
+	space_update_bsize(space, NULL, new_tuple);
 }
 
 /**
@@ -147,9 +149,11 @@ memtx_replace_primary_key(struct txn *txn, struct space *space,
 			  struct tuple *old_tuple, struct tuple *new_tuple,
 			  enum dup_replace_mode mode)
 {
-	(void) space->index[0]->replace(old_tuple, new_tuple, mode);
+	struct tuple *dup_tuple =
+		space->index[0]->replace(old_tuple, new_tuple, mode);
 	if (new_tuple)
 		tuple_ref(new_tuple);
+	space_update_bsize(space, dup_tuple, new_tuple);
 	memtx_txn_add_undo(txn, space, old_tuple, new_tuple);
 }
 
@@ -186,6 +190,7 @@ memtx_replace_all_keys(struct txn *txn, struct space *space,
 	}
 	if (new_tuple)
 		tuple_ref(new_tuple);
+	space_update_bsize(space, old_tuple, new_tuple);
 	memtx_txn_add_undo(txn, space, old_tuple, new_tuple);
 }
 
@@ -239,7 +244,9 @@ MemtxEngine::MemtxEngine()
 	m_state(MEMTX_INITIALIZED)
 {
 	flags = ENGINE_CAN_BE_TEMPORARY |
-		ENGINE_AUTO_CHECK_UPDATE;
+		ENGINE_AUTO_CHECK_UPDATE |
+		ENGINE_CAN_COMPRESS |
+		ENGINE_CAN_ENCODE;
 }
 
 /**
@@ -523,6 +530,7 @@ MemtxEngine::rollbackStatement(struct txn_stmt *stmt)
 		Index *index = space->index[i];
 		index->replace(stmt->new_tuple, stmt->old_tuple, DUP_INSERT);
 	}
+	space_update_bsize(space, stmt->new_tuple, stmt->old_tuple);
 	if (stmt->new_tuple)
 		tuple_unref(stmt->new_tuple);
 
@@ -648,11 +656,16 @@ snapshot_write_tuple(struct xlog *l,
 	memset(&row, 0, sizeof(struct xrow_header));
 	row.type = IPROTO_INSERT;
 
+	/* A compressed tuple is written decompressed. */
+	RegionGuard region_guard(&fiber()->gc);
+	uint32_t bsize;
+	const char *data = tuple_data_range(tuple, &bsize);
+
 	row.bodycnt = 2;
 	row.body[0].iov_base = &body;
 	row.body[0].iov_len = sizeof(body);
-	row.body[1].iov_base = tuple->data;
-	row.body[1].iov_len = tuple->bsize;
+	row.body[1].iov_base = (void *) data;
+	row.body[1].iov_len = bsize;
 	snapshot_write_row(recovery, l, &row);
 }
 
@@ -760,6 +773,25 @@ MemtxEngine::waitCheckpoint()
 	return rc;
 }
 
+/*
+ * File operations of a checkpoint run in the system coio pool,
+ * not to wait behind user I/O in the libeio threads.
+ */
+static ssize_t
+checkpoint_rename_cb(va_list ap)
+{
+	const char *from = va_arg(ap, const char *);
+	const char *to = va_arg(ap, const char *);
+	return rename(from, to);
+}
+
+static ssize_t
+checkpoint_unlink_cb(va_list ap)
+{
+	const char *filename = va_arg(ap, const char *);
+	return unlink(filename);
+}
+
 void
 MemtxEngine::commitCheckpoint()
 {
@@ -773,8 +805,12 @@ MemtxEngine::commitCheckpoint()
 	char to[PATH_MAX];
 	snprintf(to, sizeof(to), "%s",
 		 format_filename(dir, m_checkpoint_id, NONE));
-	char *from = format_filename(dir, m_checkpoint_id, INPROGRESS);
-	int rc = coeio_rename(from, to);
+	/* format_filename() reuses its buffer, and the call yields. */
+	char from[PATH_MAX];
+	snprintf(from, sizeof(from), "%s",
+		 format_filename(dir, m_checkpoint_id, INPROGRESS));
+	int rc = coio_pool_call(coio_system_pool, checkpoint_rename_cb,
+				from, to);
 	if (rc != 0)
 		panic("can't rename .snap.inprogress");
 
@@ -793,9 +829,12 @@ MemtxEngine::abortCheckpoint()
 	}
 	if (m_checkpoint_id > 0) {
 		/** Remove garbage .inprogress file. */
-		char *filename = format_filename(&::recovery->snap_dir,
-						m_checkpoint_id, INPROGRESS);
-		(void) coeio_unlink(filename);
+		char filename[PATH_MAX];
+		snprintf(filename, sizeof(filename), "%s",
+			 format_filename(&::recovery->snap_dir,
+					 m_checkpoint_id, INPROGRESS));
+		(void) coio_pool_call(coio_system_pool,
+				      checkpoint_unlink_cb, filename);
 	}
 	m_checkpoint_id = -1;
 }
@@ -819,9 +858,11 @@ memtx_index_arena_init()
 		/* already done.. */
 		return;
 	}
-	/* Creating arena */
-	if (slab_arena_create(&memtx_index_arena, &memtx_quota,
-			      0, MEMTX_SLAB_SIZE, MAP_PRIVATE)) {
+	/* Creating arena, placed in memory like the tuple arena */
+	if (slab_arena_create_with_placement(&memtx_index_arena,
+					     &memtx_quota, 0,
+					     MEMTX_SLAB_SIZE, MAP_PRIVATE,
+					     &memtx_arena.placement)) {
 		panic_syserror("failed to initialize index arena");
 	}
 	/* Creating slab cache */
@@ -834,6 +875,12 @@ memtx_index_arena_init()
 	memtx_index_arena_initialized = true;
 }
 
+struct slab_arena *
+memtx_index_arena_get()
+{
+	return memtx_index_arena_initialized ? &memtx_index_arena : NULL;
+}
+
 /**
  * Allocate a block of size MEMTX_EXTENT_SIZE for memtx index
  */
@@ -852,3 +899,341 @@ memtx_index_extent_free(void *extent)
 {
 	return mempool_free(&memtx_index_extent_pool, extent);
 }
+
+/* {{{ Online defragmentation of the tuple arena ******************/
+
+enum {
+	/** How many tuples are looked at between yields. */
+	MEMTX_DEFRAG_BATCH = 1000,
+};
+
+/** How often the defragmentation fiber checks the arena, seconds. */
+static const ev_tstamp MEMTX_DEFRAG_PERIOD = 1.0;
+
+/** Fragmentation which triggers defragmentation, 0 if disabled. */
+static double memtx_defrag_threshold = 0;
+
+/** The background defragmentation fiber, if running. */
+static struct fiber *memtx_defrag_fiber = NULL;
+
+static int
+memtx_defrag_stats_cb(const struct mempool_stats * /* stats */,
+		      void * /* cb_ctx */)
+{
+	return 0;
+}
+
+double
+memtx_defrag_fragmentation()
+{
+	struct small_stats totals;
+	small_stats(&memtx_alloc, &totals, memtx_defrag_stats_cb, NULL);
+	if (totals.total == 0)
+		return 0;
+	return 1.0 - (double) totals.used / totals.total;
+}
+
+/**
+ * A statement of a transaction which waits for WAL write
+ * refers to its tuples without holding a reference, and will
+ * use them if the transaction is rolled back. Such tuples can
+ * not be moved. While a DDL transaction waits for WAL nothing
+ * can be moved at all: indexes of the altered space, which
+ * are not in the space cache yet, refer to the same tuples.
+ * Only candidates for relocation are checked, so the commit
+ * path pays for nothing but linking into txn_wal_queue.
+ */
+static bool
+memtx_defrag_is_pinned(struct tuple *tuple)
+{
+	struct txn *txn;
+	rlist_foreach_entry(txn, &txn_wal_queue, in_wal_queue) {
+		struct txn_stmt *stmt;
+		rlist_foreach_entry(stmt, &txn->stmts, next) {
+			if (stmt->new_tuple == tuple ||
+			    stmt->old_tuple == tuple)
+				return true;
+			if (stmt->space != NULL &&
+			    space_is_system(stmt->space))
+				return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Check if all indexes of the space can switch to a copy of
+ * a tuple in place, @sa Index::canRelocate(). Moving tuples
+ * of other spaces would make iterators, which are kept open
+ * across a yield, skip or repeat tuples.
+ */
+static bool
+memtx_defrag_space_is_supported(struct space *space)
+{
+	if (space_is_system(space) ||
+	    space->handler->replace != memtx_replace_all_keys)
+		return false;
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		if (!space->index[i]->canRelocate())
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Move a tuple to a new place in the tuple arena and make all
+ * indexes of the space refer to the copy.
+ * @return the copy
+ */
+static struct tuple *
+memtx_defrag_relocate(struct space *space, struct tuple *tuple)
+{
+	struct tuple *copy = tuple_dup(tuple);
+	uint32_t i = 0;
+	try {
+		for (; i < space->index_count; i++)
+			space->index[i]->relocate(tuple, copy);
+	} catch (Exception *e) {
+		/* Rollback all changes */
+		for (; i > 0; i--)
+			space->index[i - 1]->relocate(copy, tuple);
+		tuple_delete(copy);
+		throw;
+	}
+	tuple_ref(copy);
+	tuple_unref(tuple);
+	return copy;
+}
+
+/**
+ * Copy the primary key of a tuple to resume the scan of the
+ * space after it.
+ */
+static char *
+memtx_defrag_save_key(struct key_def *key_def, struct tuple *tuple,
+		      char *key, size_t *key_size)
+{
+	size_t size = mp_sizeof_array(key_def->part_count);
+	for (uint32_t part = 0; part < key_def->part_count; part++) {
+		const char *field =
+			tuple_field(tuple, key_def->parts[part].fieldno);
+		const char *end = field;
+		mp_next(&end);
+		size += end - field;
+	}
+	if (size > *key_size) {
+		char *new_key = (char *) realloc(key, size);
+		if (new_key == NULL) {
+			tnt_raise(ClientError, ER_MEMORY_ISSUE, size,
+				  "memtx_defrag", "key");
+		}
+		key = new_key;
+		*key_size = size;
+	}
+	char *pos = mp_encode_array(key, key_def->part_count);
+	for (uint32_t part = 0; part < key_def->part_count; part++) {
+		const char *field =
+			tuple_field(tuple, key_def->parts[part].fieldno);
+		const char *end = field;
+		mp_next(&end);
+		memcpy(pos, field, end - field);
+		pos += end - field;
+	}
+	return key;
+}
+
+/**
+ * Move tuples out of sparsely populated slabs of the tuple
+ * arena, scanning the space by its primary key. Yields every
+ * MEMTX_DEFRAG_BATCH tuples and resumes after the last seen
+ * key, since an iterator can't survive a yield.
+ * @return the number of moved tuples
+ */
+static size_t
+memtx_defrag_space(uint32_t space_id)
+{
+	size_t moved = 0;
+	char *key = NULL;
+	size_t key_size = 0;
+	uint32_t part_count = 0;
+	auto key_guard = make_scoped_guard([&] { free(key); });
+
+	while (true) {
+		/* The space may be dropped or altered during yield. */
+		struct space *space = space_by_id(space_id);
+		if (space == NULL || !memtx_defrag_space_is_supported(space))
+			break;
+		Index *pk = space->index[0];
+		struct iterator *it = pk->allocIterator();
+		auto it_guard = make_scoped_guard([=] { it->free(it); });
+		pk->initIteratorAfter(it, key, part_count);
+
+		struct tuple *tuple = NULL;
+		for (uint32_t n = 0; n < MEMTX_DEFRAG_BATCH; n++) {
+			tuple = it->next(it);
+			if (tuple == NULL)
+				break;
+			/* Skip tuples referenced from Lua or a port. */
+			if (tuple->refs != 1 ||
+			    !tuple_should_relocate(tuple) ||
+			    memtx_defrag_is_pinned(tuple))
+				continue;
+			tuple = memtx_defrag_relocate(space, tuple);
+			moved++;
+		}
+		if (tuple == NULL)
+			break;
+		key = memtx_defrag_save_key(pk->key_def, tuple,
+					    key, &key_size);
+		part_count = pk->key_def->part_count;
+		fiber_sleep(0);
+	}
+	return moved;
+}
+
+/** Ids of spaces to defragment, @sa memtx_defrag(). */
+struct memtx_defrag_spaces {
+	uint32_t *ids;
+	uint32_t count;
+	uint32_t capacity;
+};
+
+static void
+memtx_defrag_add_space(struct space *space, void *udata)
+{
+	if (!memtx_defrag_space_is_supported(space))
+		return;
+	struct memtx_defrag_spaces *spaces =
+		(struct memtx_defrag_spaces *) udata;
+	if (spaces->count == spaces->capacity) {
+		uint32_t capacity = MAX(spaces->capacity * 2, 16);
+		uint32_t *ids = (uint32_t *)
+			realloc(spaces->ids, capacity * sizeof(*ids));
+		if (ids == NULL) {
+			tnt_raise(ClientError, ER_MEMORY_ISSUE,
+				  capacity * sizeof(*ids),
+				  "memtx_defrag", "space list");
+		}
+		spaces->ids = ids;
+		spaces->capacity = capacity;
+	}
+	spaces->ids[spaces->count++] = space_id(space);
+}
+
+size_t
+memtx_defrag()
+{
+	/* Remember space ids: the space cache may change on yield. */
+	struct memtx_defrag_spaces spaces = { NULL, 0, 0 };
+	auto spaces_guard = make_scoped_guard([&] { free(spaces.ids); });
+	space_foreach(memtx_defrag_add_space, &spaces);
+
+	size_t moved = 0;
+	for (uint32_t i = 0; i < spaces.count; i++)
+		moved += memtx_defrag_space(spaces.ids[i]);
+	return moved;
+}
+
+static void
+memtx_defrag_f(va_list /* ap */)
+{
+	while (memtx_defrag_threshold > 0) {
+		if (memtx_defrag_fragmentation() >= memtx_defrag_threshold) {
+			try {
+				size_t moved = memtx_defrag();
+				say_debug("memtx_defrag: moved %zu tuples",
+					  moved);
+			} catch (Exception *e) {
+				e->log();
+			}
+		}
+		fiber_sleep(MEMTX_DEFRAG_PERIOD);
+	}
+	memtx_defrag_fiber = NULL;
+}
+
+void
+memtx_defrag_set_threshold(double threshold)
+{
+	memtx_defrag_threshold = threshold;
+	if (memtx_defrag_fiber != NULL) {
+		/* Apply the new threshold, or stop, right away. */
+		fiber_wakeup(memtx_defrag_fiber);
+	} else if (threshold > 0) {
+		memtx_defrag_fiber = fiber_new("memtx_defrag",
+					       memtx_defrag_f);
+		fiber_start(memtx_defrag_fiber);
+	}
+}
+
+/* }}} */
+
+/* {{{ Returning free memory to the operating system **************/
+
+/** How often idle slabs are released, seconds, 0 if disabled. */
+static double memtx_release_period = 0;
+
+/** The background release fiber, if running. */
+static struct fiber *memtx_release_fiber = NULL;
+
+size_t
+memtx_release(bool idle_only)
+{
+	size_t released = 0;
+	if (idle_only) {
+		released += slab_cache_trim(memtx_alloc.cache);
+		if (memtx_index_arena_initialized)
+			released += slab_cache_trim(
+				&memtx_index_arena_slab_cache);
+	} else {
+		released += slab_cache_release(memtx_alloc.cache);
+		if (memtx_index_arena_initialized)
+			released += slab_cache_release(
+				&memtx_index_arena_slab_cache);
+	}
+	return released;
+}
+
+static void
+memtx_release_f(va_list /* ap */)
+{
+	while (memtx_release_period > 0) {
+		/*
+		 * A slab is released on the second pass which
+		 * finds it unused, i.e. it stays free for one to
+		 * two periods.
+		 */
+		size_t released = memtx_release(true);
+		if (released > 0)
+			say_debug("memtx_release: released %zu bytes",
+				  released);
+		fiber_sleep(memtx_release_period);
+	}
+	memtx_release_fiber = NULL;
+}
+
+void
+memtx_release_set_period(double period)
+{
+	memtx_release_period = period;
+	if (memtx_release_fiber != NULL) {
+		/* Apply the new period, or stop, right away. */
+		fiber_wakeup(memtx_release_fiber);
+	} else if (period > 0) {
+		memtx_release_fiber = fiber_new("memtx_release",
+						memtx_release_f);
+		fiber_start(memtx_release_fiber);
+	}
+}
+
+int
+memtx_set_quota(size_t size)
+{
+	if (quota_set(&memtx_quota, size) >= 0)
+		return 0;
+	/* Memory of free slabs is still charged to the quota. */
+	memtx_release(false);
+	return quota_set(&memtx_quota, size) >= 0 ? 0 : -1;
+}
+
+/* }}} */
@@ -83,6 +83,13 @@ enum {
 void
 memtx_index_arena_init();
 
+/**
+ * Return the arena for indexes or NULL if it
+ * is not initialized yet.
+ */
+struct slab_arena *
+memtx_index_arena_get();
+
 /**
  * Allocate a block of size MEMTX_EXTENT_SIZE for memtx index
  */
@@ -95,4 +102,70 @@ memtx_index_extent_alloc();
 void
 memtx_index_extent_free(void *extent);
 
+/**
+ * Online defragmentation of the tuple arena.
+ *
+ * After a lot of deletes and updates, mempools of the tuple
+ * allocator may keep many partially populated slabs. The
+ * defragmentation moves tuples out of such slabs, updates
+ * all indexes to point to the copies (@sa Index::relocate()),
+ * and thus lets empty slabs return to the slab cache, where
+ * they can be reused by any size class.
+ *
+ * Tuples referenced from Lua or from a transaction waiting
+ * for WAL are never moved, and nothing is moved while
+ * a snapshot is in progress. Only spaces which indexes can
+ * switch to a copy in place (unique TREE and HASH) are
+ * defragmented.
+ */
+
+/**
+ * Share of the tuple arena memory which is not occupied
+ * by tuples, 0..1.
+ */
+double
+memtx_defrag_fragmentation();
+
+/**
+ * Make one defragmentation pass over all memtx spaces.
+ * Yields.
+ * @return the number of moved tuples
+ */
+size_t
+memtx_defrag();
+
+/**
+ * Start or stop background defragmentation, which makes
+ * a pass whenever fragmentation of the tuple arena exceeds
+ * the threshold. 0 disables background defragmentation.
+ */
+void
+memtx_defrag_set_threshold(double threshold);
+
+/**
+ * Give memory of free slabs of the tuple and index arenas
+ * back to the operating system. If @a idle_only is set, only
+ * slabs which have stayed free since the previous call are
+ * released.
+ * @return the amount of released memory
+ */
+size_t
+memtx_release(bool idle_only);
+
+/**
+ * Start or stop background release of slabs which stay
+ * free longer than @a period seconds. 0 disables it.
+ */
+void
+memtx_release_set_period(double period);
+
+/**
+ * Change the memory limit shared by the tuple and index
+ * arenas. Free slabs are released to make room if the limit
+ * is decreased.
+ * @retval -1 memory in use exceeds the new limit
+ */
+int
+memtx_set_quota(size_t size);
+
 #endif /* TARANTOOL_BOX_MEMTX_ENGINE_H_INCLUDED */
@@ -33,6 +33,7 @@
 #include "space.h"
 #include "schema.h" /* space_cache_find() */
 #include "errinj.h"
+#include "crc32.h"
 
 #include "third_party/PMurHash.h"
 
@@ -90,8 +91,127 @@ mh_hash_field(uint32_t *ph1, uint32_t *pcarry, const char **field,
 	return size;
 }
 
+/**
+ * Get the bytes of a key part which are subject to hashing.
+ * The same rules as in mh_hash_field() apply.
+ */
+static inline const char *
+hash_field_data(const char **field, enum field_type type, uint32_t *size)
+{
+	const char *f = *field;
+	if (type == STRING)
+		return mp_decode_str(field, size);
+	mp_next(field);
+	*size = *field - f;
+	return f;
+}
+
+/** A single multiply-mix of a 64-bit integer key (Fibonacci hashing). */
 static inline uint32_t
-tuple_hash(struct tuple *tuple, const struct key_def *key_def)
+hash_u64(uint64_t val)
+{
+	return (uint32_t) ((val * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+/** Multiply two 64-bit words and fold the 128-bit product. */
+static inline uint64_t
+hash_mum(uint64_t a, uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+	__uint128_t r = (__uint128_t) a * b;
+	return (uint64_t) (r >> 64) ^ (uint64_t) r;
+#else
+	uint64_t ha = a >> 32, la = (uint32_t) a;
+	uint64_t hb = b >> 32, lb = (uint32_t) b;
+	uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+	uint64_t t = rl + (rm0 << 32);
+	uint64_t c = t < rl;
+	uint64_t lo = t + (rm1 << 32);
+	c += lo < t;
+	uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+	return hi ^ lo;
+#endif
+}
+
+static inline uint64_t
+hash_load64(const char *p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static const uint64_t WYHASH_P0 = 0xa0761d6478bd642fULL;
+static const uint64_t WYHASH_P1 = 0xe7037ed1a0b428dbULL;
+static const uint64_t WYHASH_P2 = 0x8ebc6af09c88c6e3ULL;
+
+/**
+ * wyhash-style hashing of a byte string: consume 16 bytes
+ * per multiplication, the tail is zero-padded.
+ */
+static inline uint64_t
+hash_wide(uint64_t seed, const char *data, uint32_t size)
+{
+	uint64_t h = seed ^ WYHASH_P0;
+	for (; size >= 16; size -= 16, data += 16) {
+		h = hash_mum(hash_load64(data) ^ WYHASH_P1,
+			     hash_load64(data + 8) ^ h);
+	}
+	if (size >= 8) {
+		h = hash_mum(hash_load64(data) ^ WYHASH_P1, h ^ WYHASH_P2);
+		size -= 8;
+		data += 8;
+	}
+	if (size > 0) {
+		uint64_t tail = 0;
+		memcpy(&tail, data, size);
+		h = hash_mum(tail ^ WYHASH_P1, h ^ WYHASH_P2);
+	}
+	return h;
+}
+
+static inline uint32_t
+hash_wide_result(uint64_t h, uint32_t total_size)
+{
+	h = hash_mum(h ^ total_size, WYHASH_P1);
+	return (uint32_t) (h ^ (h >> 32));
+}
+
+/* {{{ Hash functions *********************************************/
+
+/*
+ * Each hash function has a tuple and a key flavour, which
+ * must produce equal values for a tuple and a key it
+ * matches. The flavour is selected once per index in
+ * MemtxHash constructor, depending on key_def->hash_func
+ * and the key shape.
+ */
+
+static uint32_t
+murmur_key_hash(const char *key, const struct key_def *key_def)
+{
+	const struct key_part *part = key_def->parts;
+
+	if (key_def->part_count == 1 && part->type == NUM) {
+		uint64_t val = mp_decode_uint(&key);
+		if (likely(val <= UINT32_MAX))
+			return val;
+		return ((uint32_t)((val)>>33^(val)^(val)<<11));
+	}
+
+	uint32_t h = HASH_SEED;
+	uint32_t carry = 0;
+	uint32_t total_size = 0;
+
+	/* Hash fields part by part (see mh_hash_field() comments) */
+	for ( ; part < key_def->parts + key_def->part_count; part++)
+		total_size += mh_hash_field(&h, &carry, &key, part->type);
+
+	return PMurHash32_Result(h, carry, total_size);
+}
+
+static uint32_t
+murmur_tuple_hash(struct tuple *tuple, const struct key_def *key_def)
 {
 	const struct key_part *part = key_def->parts;
 	/*
@@ -118,29 +238,88 @@ tuple_hash(struct tuple *tuple, const struct key_def *key_def)
 	return PMurHash32_Result(h, carry, total_size);
 }
 
-static inline uint32_t
-key_hash(const char *key, const struct key_def *key_def)
+/** Single-part NUM key, shared by CRC32C and WYHASH. */
+static uint32_t
+num_key_hash(const char *key, const struct key_def *key_def)
 {
-	const struct key_part *part = key_def->parts;
+	(void) key_def;
+	return hash_u64(mp_decode_uint(&key));
+}
 
-	if (key_def->part_count == 1 && part->type == NUM) {
-		uint64_t val = mp_decode_uint(&key);
-		if (likely(val <= UINT32_MAX))
-			return val;
-		return ((uint32_t)((val)>>33^(val)^(val)<<11));
+static uint32_t
+num_tuple_hash(struct tuple *tuple, const struct key_def *key_def)
+{
+	const char *field = tuple_field(tuple, key_def->parts[0].fieldno);
+	return hash_u64(mp_decode_uint(&field));
+}
+
+/*
+ * Multipart keys mix the size of each part in, otherwise
+ * ("ab", "c") and ("a", "bc") would always collide.
+ */
+
+static uint32_t
+crc32c_key_hash(const char *key, const struct key_def *key_def)
+{
+	uint32_t h = HASH_SEED;
+	const struct key_part *part = key_def->parts;
+	for ( ; part < key_def->parts + key_def->part_count; part++) {
+		uint32_t size;
+		const char *f = hash_field_data(&key, part->type, &size);
+		h = crc32_calc(h, (const char *) &size, sizeof(size));
+		h = crc32_calc(h, f, size);
 	}
+	return h;
+}
 
+static uint32_t
+crc32c_tuple_hash(struct tuple *tuple, const struct key_def *key_def)
+{
 	uint32_t h = HASH_SEED;
-	uint32_t carry = 0;
-	uint32_t total_size = 0;
+	const struct key_part *part = key_def->parts;
+	for ( ; part < key_def->parts + key_def->part_count; part++) {
+		const char *field = tuple_field(tuple, part->fieldno);
+		uint32_t size;
+		const char *f = hash_field_data(&field, part->type, &size);
+		h = crc32_calc(h, (const char *) &size, sizeof(size));
+		h = crc32_calc(h, f, size);
+	}
+	return h;
+}
 
-	/* Hash fields part by part (see mh_hash_field() comments) */
-	for ( ; part < key_def->parts + key_def->part_count; part++)
-		total_size += mh_hash_field(&h, &carry, &key, part->type);
+static uint32_t
+wyhash_key_hash(const char *key, const struct key_def *key_def)
+{
+	uint64_t h = HASH_SEED;
+	uint32_t total_size = 0;
+	const struct key_part *part = key_def->parts;
+	for ( ; part < key_def->parts + key_def->part_count; part++) {
+		uint32_t size;
+		const char *f = hash_field_data(&key, part->type, &size);
+		h = hash_wide(h ^ size, f, size);
+		total_size += size;
+	}
+	return hash_wide_result(h, total_size);
+}
 
-	return PMurHash32_Result(h, carry, total_size);
+static uint32_t
+wyhash_tuple_hash(struct tuple *tuple, const struct key_def *key_def)
+{
+	uint64_t h = HASH_SEED;
+	uint32_t total_size = 0;
+	const struct key_part *part = key_def->parts;
+	for ( ; part < key_def->parts + key_def->part_count; part++) {
+		const char *field = tuple_field(tuple, part->fieldno);
+		uint32_t size;
+		const char *f = hash_field_data(&field, part->type, &size);
+		h = hash_wide(h ^ size, f, size);
+		total_size += size;
+	}
+	return hash_wide_result(h, total_size);
 }
 
+/* }}} */
+
 #define LIGHT_NAME _index
 #define LIGHT_DATA_TYPE struct tuple *
 #define LIGHT_KEY_TYPE const char *
@@ -175,6 +354,17 @@ hash_iterator_ge(struct iterator *ptr)
 	return res ? *res : 0;
 }
 
+static struct tuple *
+hash_iterator_gt(struct iterator *ptr)
+{
+	assert(ptr->free == hash_iterator_free);
+	ptr->next = hash_iterator_ge;
+	/* Skip the tuple matching the key. */
+	if (hash_iterator_ge(ptr) == NULL)
+		return NULL;
+	return hash_iterator_ge(ptr);
+}
+
 static struct tuple *
 hash_iterator_eq_next(struct iterator *it __attribute__((unused)))
 {
@@ -195,6 +385,22 @@ hash_iterator_eq(struct iterator *it)
 MemtxHash::MemtxHash(struct key_def *key_def)
 	: Index(key_def)
 {
+	bool is_num = key_def->part_count == 1 &&
+		      key_def->parts[0].type == NUM;
+	switch (key_def->hash_func) {
+	case CRC32C:
+		tuple_hash = is_num ? num_tuple_hash : crc32c_tuple_hash;
+		key_hash = is_num ? num_key_hash : crc32c_key_hash;
+		break;
+	case WYHASH:
+		tuple_hash = is_num ? num_tuple_hash : wyhash_tuple_hash;
+		key_hash = is_num ? num_key_hash : wyhash_key_hash;
+		break;
+	default:
+		tuple_hash = murmur_tuple_hash;
+		key_hash = murmur_key_hash;
+		break;
+	}
 	memtx_index_arena_init();
 	hash_table = (struct light_index_core *) malloc(sizeof(*hash_table));
 	if (hash_table == NULL) {
@@ -215,7 +421,15 @@ MemtxHash::~MemtxHash()
 void
 MemtxHash::reserve(uint32_t size_hint)
 {
-	(void)size_hint;
+	/*
+	 * The size is only a hint: if there is not enough
+	 * memory, the table grows on demand during insertion
+	 * and reports an error there.
+	 */
+	if (light_index_reserve(hash_table, size_hint) != 0) {
+		say_warn("failed to reserve %u records for index '%s'",
+			 (unsigned) size_hint, index_name(this));
+	}
 }
 
 size_t
@@ -308,6 +522,23 @@ MemtxHash::replace(struct tuple *old_tuple, struct tuple *new_tuple,
 	return old_tuple;
 }
 
+bool
+MemtxHash::canRelocate() const
+{
+	return true;
+}
+
+void
+MemtxHash::relocate(struct tuple *old_tuple, struct tuple *new_tuple)
+{
+	uint32_t h = tuple_hash(old_tuple, key_def);
+	struct tuple *replaced = NULL;
+	hash_t pos = light_index_replace(hash_table, h, new_tuple, &replaced);
+	assert(pos != light_index_end && replaced == old_tuple);
+	(void) pos;
+	(void) replaced;
+}
+
 struct iterator *
 MemtxHash::allocIterator() const
 {
@@ -343,7 +574,8 @@ MemtxHash::initIterator(struct iterator *ptr, enum iterator_type type,
 		break;
 	case ITER_EQ:
 		assert(part_count > 0);
-		light_index_itr_key(it->hash_table, &it->hitr, key_hash(key, key_def), key);
+		light_index_itr_key(it->hash_table, &it->hitr,
+				    key_hash(key, key_def), key);
 		it->base.next = hash_iterator_eq;
 		break;
 	default:
@@ -351,4 +583,34 @@ MemtxHash::initIterator(struct iterator *ptr, enum iterator_type type,
 			  "Hash index", "requested iterator type");
 	}
 }
+
+void
+MemtxHash::initIteratorAfter(struct iterator *ptr, const char *key,
+			     uint32_t part_count) const
+{
+	assert(part_count == 0 || key != NULL);
+	assert(ptr->free == hash_iterator_free);
+
+	struct hash_iterator *it = (struct hash_iterator *) ptr;
+	light_index_itr_begin(it->hash_table, &it->hitr);
+	it->base.next = hash_iterator_ge;
+	if (part_count == 0)
+		return;
+	/* Continue after the key in hash table order. */
+	uint32_t h = key_hash(key, key_def);
+	light_index_itr_key(it->hash_table, &it->hitr, h, key);
+	if (it->hitr.slotpos != light_index_end) {
+		it->base.next = hash_iterator_gt;
+		return;
+	}
+	/*
+	 * The key has been deleted: continue from the slot
+	 * where it would be, so that the scan goes on instead
+	 * of stopping early. A few tuples moved by the table
+	 * since may be missed or repeated.
+	 */
+	light_index_itr_begin(it->hash_table, &it->hitr);
+	if (it->hash_table->table_size > 0)
+		it->hitr.slotpos = light_index_slot(it->hash_table, h);
+}
 /* }}} */
@@ -33,6 +33,11 @@
 
 struct light_index_core;
 
+typedef uint32_t (*tuple_hash_f)(struct tuple *tuple,
+				 const struct key_def *key_def);
+typedef uint32_t (*key_hash_f)(const char *key,
+			       const struct key_def *key_def);
+
 class MemtxHash: public Index {
 public:
 	MemtxHash(struct key_def *key_def);
@@ -45,15 +50,24 @@ public:
 	virtual struct tuple *replace(struct tuple *old_tuple,
 				      struct tuple *new_tuple,
 				      enum dup_replace_mode mode);
+	virtual bool canRelocate() const;
+	virtual void relocate(struct tuple *old_tuple,
+			      struct tuple *new_tuple);
 
 	virtual struct iterator *allocIterator() const;
 	virtual void initIterator(struct iterator *iterator,
 				  enum iterator_type type,
 				  const char *key, uint32_t part_count) const;
+	virtual void initIteratorAfter(struct iterator *iterator,
+				       const char *key,
+				       uint32_t part_count) const;
 	virtual size_t bsize() const;
 
 protected:
 	struct light_index_core *hash_table;
+	/** Hash functions picked by key_def->hash_func. */
+	tuple_hash_f tuple_hash;
+	key_hash_f key_hash;
 };
 
 #endif /* TARANTOOL_BOX_MEMTX_HASH_H_INCLUDED */
@@ -165,10 +165,12 @@ MemtxRTree::~MemtxRTree()
 		m_position = NULL;
 	}
 	rtree_destroy(&tree);
+	free(build_array);
 }
 
 MemtxRTree::MemtxRTree(struct key_def *key_def)
-  : Index(key_def)
+  : Index(key_def), build_array(0), build_array_size(0),
+    build_array_alloc_size(0)
 {
 	assert(key_def->part_count == 1);
 	assert(key_def->parts[0].type = ARRAY);
@@ -373,4 +375,54 @@ MemtxRTree::beginBuild()
 	rtree_purge(&tree);
 }
 
+void
+MemtxRTree::reserve(uint32_t size_hint)
+{
+	if (size_hint < build_array_alloc_size)
+		return;
+	struct rtree_entry *tmp = (struct rtree_entry *)
+		realloc(build_array, size_hint * sizeof(*build_array));
+	if (tmp == NULL) {
+		tnt_raise(ClientError, ER_MEMORY_ISSUE,
+			  size_hint * sizeof(*build_array),
+			  "MemtxRTree", "reserve");
+	}
+	build_array = tmp;
+	build_array_alloc_size = size_hint;
+}
+
+void
+MemtxRTree::buildNext(struct tuple *tuple)
+{
+	if (build_array_size == build_array_alloc_size) {
+		reserve(build_array_alloc_size > 0 ?
+			build_array_alloc_size + build_array_alloc_size / 2 :
+			RTREE_PAGE_SIZE / sizeof(*build_array));
+	}
+	struct rtree_entry *entry = &build_array[build_array_size];
+	extract_rectangle(&entry->rect, tuple, key_def);
+	entry->record = tuple;
+	build_array_size++;
+}
+
+void
+MemtxRTree::endBuild()
+{
+	/*
+	 * Pack all tuples at once instead of inserting them
+	 * one by one: it is faster and gives full pages with
+	 * less overlap between them.
+	 */
+	int rc = rtree_build(&tree, build_array, build_array_size);
+
+	free(build_array);
+	build_array = 0;
+	build_array_size = 0;
+	build_array_alloc_size = 0;
+	if (rc != 0) {
+		tnt_raise(ClientError, ER_MEMORY_ISSUE, RTREE_PAGE_SIZE,
+			  "MemtxRTree", "build");
+	}
+}
+
 
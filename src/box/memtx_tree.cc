@@ -264,6 +264,28 @@ MemtxTree::replace(struct tuple *old_tuple, struct tuple *new_tuple,
 	return old_tuple;
 }
 
+bool
+MemtxTree::canRelocate() const
+{
+	/*
+	 * Non-unique indexes order equal keys by tuple address,
+	 * so the copy would have to be put to a different place.
+	 */
+	return key_def->is_unique;
+}
+
+void
+MemtxTree::relocate(struct tuple *old_tuple, struct tuple *new_tuple)
+{
+	assert(canRelocate());
+	/* The keys are equal: the element is overwritten in place. */
+	struct tuple *replaced = NULL;
+	int tree_res = bps_tree_index_insert(&tree, new_tuple, &replaced);
+	assert(tree_res == 0 && replaced == old_tuple);
+	(void) tree_res;
+	(void) replaced;
+}
+
 struct iterator *
 MemtxTree::allocIterator() const
 {
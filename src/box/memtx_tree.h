@@ -67,6 +67,9 @@ public:
 	virtual struct tuple *replace(struct tuple *old_tuple,
 				      struct tuple *new_tuple,
 				      enum dup_replace_mode mode);
+	virtual bool canRelocate() const;
+	virtual void relocate(struct tuple *old_tuple,
+			      struct tuple *new_tuple);
 
 	virtual size_t bsize() const;
 	virtual struct iterator *allocIterator() const;
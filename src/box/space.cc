@@ -99,6 +99,19 @@ space_new(struct space_def *def, struct rlist *key_list)
 	space->def = *def;
 	space->format = tuple_format_new(key_list);
 	tuple_format_ref(space->format, 1);
+	if (def->field_offsets != 0) {
+		tuple_format_set_field_offsets(space->format,
+					       def->field_offsets,
+					       def->field_count != 0 ?
+					       def->field_count :
+					       SPACE_FIELD_OFFSETS_RANGE);
+	}
+	if (def->dict_fields != 0)
+		tuple_format_set_dict(space->format, def->dict_fields);
+	if (def->compress_threshold != 0) {
+		tuple_format_set_compression(space->format, key_list,
+					     def->compress_threshold);
+	}
 	space->index_id_max = index_id_max;
 	/* init space engine instance */
 	Engine *engine = engine_find(def->engine_name);
@@ -179,15 +192,13 @@ space_stat(struct space *sp)
 	static __thread struct space_stat space_stat;
 
 	space_stat.id = space_id(sp);
-	int i = 0;
-	for (; i < sp->index_id_max; i++) {
-		Index *index = space_index(sp, i);
-		if (index) {
-			space_stat.index[i].id      = i;
-			space_stat.index[i].keys    = index->size();
-			space_stat.index[i].bsize   = index->bsize();
-		} else
-			space_stat.index[i].id = -1;
+	space_stat.bsize = sp->bsize;
+	uint32_t i = 0;
+	for (; i < sp->index_count; i++) {
+		Index *index = sp->index[i];
+		space_stat.index[i].id      = index_id(index);
+		space_stat.index[i].keys    = index->size();
+		space_stat.index[i].bsize   = index->bsize();
 	}
 	space_stat.index[i].id = -1;
 	return &space_stat;
@@ -31,6 +31,7 @@
 #include "index.h"
 #include "key_def.h"
 #include "engine.h"
+#include "tuple.h"
 #include "salad/rlist.h"
 
 struct space {
@@ -66,6 +67,12 @@ struct space {
 
 	/** Default tuple format used by this space */
 	struct tuple_format *format;
+	/**
+	 * Memory occupied by the tuples of the space, in bytes,
+	 * @sa tuple_size(). Maintained by the engine, only memtx
+	 * does it.
+	 */
+	size_t bsize;
 	/**
 	 * Sparse array of indexes defined on the space, indexed
 	 * by id. Used to quickly find index by id (for SELECTs).
@@ -80,6 +87,22 @@ struct space {
 	Index *index[];
 };
 
+/**
+ * Account replacement of @a old_tuple with @a new_tuple in
+ * the space memory usage. Either tuple may be NULL.
+ */
+static inline void
+space_update_bsize(struct space *space, const struct tuple *old_tuple,
+		   const struct tuple *new_tuple)
+{
+	if (new_tuple != NULL)
+		space->bsize += tuple_size(new_tuple);
+	if (old_tuple != NULL) {
+		assert(space->bsize >= tuple_size(old_tuple));
+		space->bsize -= tuple_size(old_tuple);
+	}
+}
+
 /** Check whether or not the current user can be granted
  * the requested access to the space.
  */
@@ -185,9 +208,15 @@ struct index_stat {
 	int64_t bsize;
 };
 
+/**
+ * Statistics of a space, the index array is terminated
+ * by an entry with id -1.
+ */
 struct space_stat {
 	int32_t id;
-	struct index_stat index[BOX_INDEX_MAX];
+	/** Memory occupied by tuples, @sa space::bsize. */
+	int64_t bsize;
+	struct index_stat index[BOX_INDEX_MAX + 1];
 };
 
 struct space_stat *
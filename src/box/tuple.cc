@@ -36,6 +36,11 @@
 #include "key_def.h"
 #include "tuple_update.h"
 #include "errinj.h"
+#include "fiber.h"
+
+#if defined(HAVE_LZ4)
+#include <lz4.h>
+#endif /* defined(HAVE_LZ4) */
 
 /** Global table of tuple formats */
 struct tuple_format **tuple_formats;
@@ -44,8 +49,6 @@ static intptr_t recycled_format_ids = FORMAT_ID_NIL;
 
 static uint32_t formats_size, formats_capacity;
 
-uint32_t snapshot_version;
-
 struct quota memtx_quota;
 
 struct slab_arena memtx_arena;
@@ -58,7 +61,9 @@ enum {
 	/** Lowest allowed slab_alloc_maximal */
 	OBJSIZE_MAX_MIN = 16 * 1024,
 	/** Lowest allowed slab size, for mmapped slabs */
-	SLAB_SIZE_MIN = 1024 * 1024
+	SLAB_SIZE_MIN = 1024 * 1024,
+	/** Size class step of the tuple allocator */
+	TUPLE_ALLOC_STEP = 4
 };
 
 /** Extract all available type info from keys. */
@@ -163,6 +168,14 @@ tuple_format_alloc(struct rlist *key_list)
 	format->id = FORMAT_ID_NIL;
 	format->max_fieldno = max_fieldno;
 	format->field_count = field_count;
+	format->compressed = NULL;
+	format->compress_threshold = 0;
+	format->is_compressed = false;
+	format->offset_step = 0;
+	format->offset_slots = 0;
+	format->offset_slot_base = 0;
+	format->dict = NULL;
+	format->dict_fields = 0;
 	format->types = (enum field_type *)
 		((char *) format + sizeof(*format) +
 		field_count * sizeof(int32_t));
@@ -172,10 +185,65 @@ tuple_format_alloc(struct rlist *key_list)
 void
 tuple_format_delete(struct tuple_format *format)
 {
+	if (format->compressed != NULL)
+		tuple_format_ref(format->compressed, -1);
+	if (format->dict != NULL)
+		tuple_dict_unref(format->dict);
 	tuple_format_deregister(format);
 	free(format);
 }
 
+void
+tuple_format_set_compression(struct tuple_format *format,
+			     struct rlist *key_list, uint32_t threshold)
+{
+	assert(format->compressed == NULL && !format->is_compressed);
+	struct tuple_format *compressed = tuple_format_new(key_list);
+	/*
+	 * The offset cache does not apply to compressed
+	 * fields, but the field map must have the same size.
+	 */
+	assert(compressed->field_map_size <= format->field_map_size);
+	compressed->field_map_size = format->field_map_size;
+	compressed->is_compressed = true;
+	if (format->dict != NULL) {
+		compressed->dict = format->dict;
+		compressed->dict_fields = format->dict_fields;
+		tuple_dict_ref(compressed->dict);
+	}
+	tuple_format_ref(compressed, 1);
+	format->compressed = compressed;
+	format->compress_threshold = threshold;
+}
+
+void
+tuple_format_set_field_offsets(struct tuple_format *format, uint32_t step,
+			       uint32_t field_count)
+{
+	assert(step > 0 && format->offset_step == 0);
+	assert(format->compressed == NULL);
+	if (field_count <= step)
+		return; /* Nothing to cache. */
+	format->offset_step = step;
+	format->offset_slots = (field_count - 1) / step;
+	format->offset_slot_base = -(int32_t) (format->field_map_size /
+					       sizeof(uint32_t));
+	format->field_map_size += format->offset_slots * sizeof(uint32_t);
+}
+
+void
+tuple_format_set_dict(struct tuple_format *format, uint64_t fields)
+{
+	assert(format->dict == NULL && format->compressed == NULL);
+	/* The first field is read directly by tuple_compare(). */
+	assert((fields & 1) == 0);
+	if (fields == 0)
+		return;
+	format->dict = tuple_dict_new();
+	tuple_dict_ref(format->dict);
+	format->dict_fields = fields;
+}
+
 struct tuple_format *
 tuple_format_new(struct rlist *key_list)
 {
@@ -214,6 +282,32 @@ tuple_format_new(struct rlist *key_list)
 	return format;
 }
 
+/**
+ * Fill the offset cache of a new tuple, @sa
+ * tuple_format::offset_step. The cache is never changed
+ * afterwards, so reading a tuple doesn't write to it.
+ */
+static void
+tuple_init_offset_cache(struct tuple_format *format, struct tuple *tuple,
+			uint32_t *field_map)
+{
+	int32_t base = format->offset_slot_base;
+	uint32_t step = format->offset_step;
+	const char *pos = tuple->data;
+	uint32_t field_count = mp_decode_array(&pos);
+	uint32_t fieldno = 0;
+	for (uint32_t k = 1; k <= format->offset_slots; k++) {
+		if (k * step >= field_count) {
+			/* The tuple is shorter than the cache. */
+			field_map[base - k] = 0;
+			continue;
+		}
+		for (; fieldno < k * step; fieldno++)
+			mp_next(&pos);
+		field_map[base - k] = pos - tuple->data;
+	}
+}
+
 /*
  * Validate a new tuple format and initialize tuple-local
  * format data.
@@ -221,6 +315,17 @@ tuple_format_new(struct rlist *key_list)
 void
 tuple_init_field_map(struct tuple_format *format, struct tuple *tuple, uint32_t *field_map)
 {
+	/*
+	 * The tuple may belong to another format when it is
+	 * checked against the format of a new index.
+	 */
+	struct tuple_format *tuple_fmt = tuple_format(tuple);
+	/*
+	 * Fields past the prefix of a compressed tuple are not
+	 * there to cache offsets of.
+	 */
+	if (format->offset_slots > 0 && !tuple_fmt->is_compressed)
+		tuple_init_offset_cache(format, tuple, field_map);
 	if (format->field_count == 0)
 		return; /* Nothing to initialize */
 
@@ -243,6 +348,10 @@ tuple_init_field_map(struct tuple_format *format, struct tuple *tuple, uint32_t
 		enum mp_type mp_type = mp_typeof(*pos);
 		mp_next(&pos);
 
+		/* An id of an interned string. */
+		if (unlikely(mp_type == MP_UINT &&
+			     tuple_format_is_encoded(tuple_fmt, i)))
+			mp_type = MP_STR;
 		key_mp_type_validate(*type, mp_type, ER_FIELD_TYPE, i);
 
 		if (*offset < 0 && *offset != INT32_MIN)
@@ -251,13 +360,85 @@ tuple_init_field_map(struct tuple_format *format, struct tuple *tuple, uint32_t
 }
 
 /**
- * Incremented on every snapshot and is used to distinguish tuples
- * which were created after start of a snapshot (these tuples can
- * be freed right away, since they are not used for snapshot) or
- * before start of a snapshot (these tuples can be freed only
- * after the snapshot has finished, otherwise it'll write bad data
- * to the snapshot file).
+ * Recently unpacked tuples. Accessing a few fields of a tuple,
+ * or iterating over them, unpacks it only once,
+ * @sa tuple_unpack().
  */
+struct tuple_unpacked {
+	/** The tuple, NULL if the entry is unused. */
+	const struct tuple *tuple;
+	/** The unpacked data, reused by the next tuple. */
+	char *data;
+	uint32_t size;
+	uint32_t capacity;
+};
+
+static struct tuple_unpacked tuple_unpacked[TUPLE_UNPACKED_CACHE_SIZE];
+/** The entry to reuse next. */
+static uint32_t tuple_unpacked_next;
+
+/** Forget the decompressed data of a deleted tuple. */
+static inline void
+tuple_unpacked_forget(const struct tuple *tuple)
+{
+	for (uint32_t i = 0; i < TUPLE_UNPACKED_CACHE_SIZE; i++) {
+		if (tuple_unpacked[i].tuple == tuple)
+			tuple_unpacked[i].tuple = NULL;
+	}
+}
+
+/**
+ * While a snapshot is in progress, the snapshot process may
+ * read any tuple which existed when it was forked, so such tuples
+ * can be freed only after the snapshot has finished, otherwise
+ * it'll write bad data to the snapshot file.
+ *
+ * The tuple header has no room for a snapshot generation, and
+ * tracking tuples born during a snapshot would cost a hash
+ * lookup per allocation, so all tuples deleted during a
+ * snapshot are put aside until tuple_end_snapshot(). The latter
+ * doesn't use smfree_delayed(), which links the chunks through
+ * their first bytes: that would overwrite the header the
+ * snapshot process is reading.
+ *
+ * Only needed if the arena is shared with the snapshot process,
+ * a private one is protected by copy-on-write, @sa
+ * SMALL_DELAYED_FREE_MODE.
+ */
+
+/** A tuple chunk which is freed at the end of the snapshot. */
+struct snapshot_garbage {
+	void *ptr;
+	size_t size;
+};
+
+/** Chunks of tuples deleted during the current snapshot. */
+static struct snapshot_garbage *snapshot_garbage;
+static size_t snapshot_garbage_size, snapshot_garbage_capacity;
+
+/** Free a chunk at the end of the current snapshot. */
+static void
+tuple_snapshot_defer(void *ptr, size_t size)
+{
+	if (snapshot_garbage_size == snapshot_garbage_capacity) {
+		size_t capacity = snapshot_garbage_capacity > 0 ?
+			snapshot_garbage_capacity * 2 : 1024;
+		struct snapshot_garbage *garbage = (struct snapshot_garbage *)
+			realloc(snapshot_garbage, capacity * sizeof(*garbage));
+		if (garbage == NULL) {
+			/* Can't be freed now, leak it. */
+			say_warn("failed to allocate %zu bytes for "
+				 "the snapshot garbage list, %zu bytes leaked",
+				 capacity * sizeof(*garbage), size);
+			return;
+		}
+		snapshot_garbage = garbage;
+		snapshot_garbage_capacity = capacity;
+	}
+	snapshot_garbage[snapshot_garbage_size].ptr = ptr;
+	snapshot_garbage[snapshot_garbage_size].size = size;
+	snapshot_garbage_size++;
+}
 
 /** Allocate a tuple */
 struct tuple *
@@ -269,7 +450,6 @@ tuple_alloc(struct tuple_format *format, size_t size)
 	struct tuple *tuple = (struct tuple *)(ptr + format->field_map_size);
 
 	tuple->refs = 0;
-	tuple->version = snapshot_version;
 	tuple->bsize = size;
 	tuple->format_id = tuple_format_id(format);
 	tuple_format_ref(format, 1);
@@ -288,13 +468,35 @@ tuple_delete(struct tuple *tuple)
 	say_debug("tuple_delete(%p)", tuple);
 	assert(tuple->refs == 0);
 	struct tuple_format *format = tuple_format(tuple);
-	size_t total = sizeof(struct tuple) + tuple->bsize + format->field_map_size;
+	size_t total = tuple_size(tuple);
 	char *ptr = (char *) tuple - format->field_map_size;
+	if (tuple_format_is_packed(format))
+		tuple_unpacked_forget(tuple);
 	tuple_format_ref(format, -1);
-	if (!memtx_alloc.is_delayed_free_mode || tuple->version == snapshot_version)
+	if (!memtx_alloc.is_delayed_free_mode)
 		smfree(&memtx_alloc, ptr, total);
 	else
-		smfree_delayed(&memtx_alloc, ptr, total);
+		tuple_snapshot_defer(ptr, total);
+}
+
+struct tuple *
+tuple_dup(struct tuple *tuple)
+{
+	struct tuple_format *format = tuple_format(tuple);
+	struct tuple *copy = tuple_alloc(format, tuple->bsize);
+	memcpy((char *) copy - format->field_map_size,
+	       (char *) tuple - format->field_map_size,
+	       format->field_map_size);
+	memcpy(copy->data, tuple->data, tuple->bsize);
+	return copy;
+}
+
+bool
+tuple_should_relocate(struct tuple *tuple)
+{
+	struct tuple_format *format = tuple_format(tuple);
+	char *ptr = (char *) tuple - format->field_map_size;
+	return small_should_relocate(&memtx_alloc, ptr, tuple_size(tuple));
 }
 
 /**
@@ -309,13 +511,25 @@ tuple_ref_exception()
 const char *
 tuple_seek(struct tuple_iterator *it, uint32_t i)
 {
+	if (unlikely(tuple_format_is_packed(tuple_format(it->tuple)))) {
+		/*
+		 * The iterator walks over an unpacked copy
+		 * of the data, scan it rather than use the
+		 * field map.
+		 */
+		if (i < (uint32_t) it->fieldno)
+			tuple_rewind(it, it->tuple);
+		while ((uint32_t) it->fieldno < i && tuple_next(it) != NULL)
+			;
+		return tuple_next(it);
+	}
 	const char *field = tuple_field(it->tuple, i);
 	if (likely(field != NULL)) {
 		it->pos = field;
 		it->fieldno = i;
 		return tuple_next(it);
 	} else {
-		it->pos = it->tuple->data + it->tuple->bsize;
+		it->pos = it->end;
 		it->fieldno = tuple_field_count(it->tuple);
 		return NULL;
 	}
@@ -324,11 +538,23 @@ tuple_seek(struct tuple_iterator *it, uint32_t i)
 const char *
 tuple_next(struct tuple_iterator *it)
 {
-	const char *tuple_end = it->tuple->data + it->tuple->bsize;
-	if (it->pos < tuple_end) {
+	if (unlikely(tuple_format_is_packed(tuple_format(it->tuple)))) {
+		/*
+		 * The unpacked data may have been evicted from
+		 * the cache since the last call: find the current
+		 * copy and continue at the same offset.
+		 */
+		uint32_t size;
+		const char *data = tuple_unpack(it->tuple, &size);
+		if (data + size != it->end) {
+			it->pos = data + size - (it->end - it->pos);
+			it->end = data + size;
+		}
+	}
+	if (it->pos < it->end) {
 		const char *field = it->pos;
 		mp_next(&it->pos);
-		assert(it->pos <= tuple_end);
+		assert(it->pos <= it->end);
 		it->fieldno++;
 		return field;
 	}
@@ -366,6 +592,9 @@ tuple_next_cstr(struct tuple_iterator *it)
 extern inline const char *
 tuple_field(const struct tuple *tuple, uint32_t i);
 
+extern inline const char *
+tuple_data_range(const struct tuple *tuple, uint32_t *p_size);
+
 extern inline uint32_t
 tuple_field_u32(struct tuple *tuple, uint32_t i);
 
@@ -389,31 +618,330 @@ tuple_update(struct tuple_format *format,
 	     const struct tuple *old_tuple, const char *expr,
 	     const char *expr_end, int field_base)
 {
+	uint32_t old_size = 0;
+	const char *old_data = tuple_data_range(old_tuple, &old_size);
 	uint32_t new_size = 0;
 	const char *new_data = tuple_update_execute(region_alloc, alloc_ctx,
-					expr, expr_end, old_tuple->data,
-					old_tuple->data + old_tuple->bsize,
+					expr, expr_end, old_data,
+					old_data + old_size,
 					&new_size, field_base);
 
 	/* Allocate a new tuple. */
 	assert(mp_typeof(*new_data) == MP_ARRAY);
-	struct tuple *new_tuple = tuple_new(format, new_data,
-					    new_data + new_size);
+	return tuple_new(format, new_data, new_data + new_size);
+}
 
+/**
+ * Create a tuple of the compressed format, @sa
+ * tuple_format::compressed.
+ *
+ * @return NULL if the tuple has no fields past the
+ * indexed ones or its tail does not compress.
+ */
+static struct tuple *
+tuple_compress(struct tuple_format *format, const char *data,
+	       const char *end)
+{
+#if defined(HAVE_LZ4)
+	assert(format->is_compressed);
+	const char *tail = data;
+	uint32_t field_count = mp_decode_array(&tail);
+	if (field_count <= format->field_count)
+		return NULL;
+	for (uint32_t i = 0; i < format->field_count; i++)
+		mp_next(&tail);
+	uint32_t prefix_size = tail - data;
+	uint32_t tail_size = end - tail;
+
+	RegionGuard region_guard(&fiber()->gc);
+	int block_max = LZ4_compressBound(tail_size);
+	char *block = (char *) region_alloc(&fiber()->gc, block_max);
+	int block_size = LZ4_compress_default(tail, block, tail_size,
+					      block_max);
+	if (block_size <= 0)
+		return NULL;
+	size_t bsize = prefix_size + mp_sizeof_uint(tail_size) +
+		mp_sizeof_binl(block_size) + block_size;
+	if (bsize >= (size_t) (end - data))
+		return NULL; /* Incompressible. */
+
+	struct tuple *tuple = tuple_alloc(format, bsize);
+	char *pos = tuple->data;
+	memcpy(pos, data, prefix_size);
+	pos = mp_encode_uint(pos + prefix_size, tail_size);
+	pos = mp_encode_bin(pos, block, block_size);
+	assert(pos == tuple->data + bsize);
+	(void) pos;
 	try {
-		tuple_init_field_map(format, new_tuple, (uint32_t *)new_tuple);
-	} catch (Exception *e) {
-		tuple_delete(new_tuple);
+		tuple_init_field_map(format, tuple, (uint32_t *) tuple);
+	} catch (...) {
+		tuple_delete(tuple);
 		throw;
 	}
-	return new_tuple;
+	return tuple;
+#else
+	(void) format;
+	(void) data;
+	(void) end;
+	return NULL;
+#endif /* defined(HAVE_LZ4) */
 }
 
-struct tuple *
-tuple_new(struct tuple_format *format, const char *data, const char *end)
+/**
+ * Get a cache entry for the unpacked data of a tuple.
+ * @return the buffer of the entry or NULL if it can't grow
+ */
+static char *
+tuple_unpacked_alloc(const struct tuple *tuple, uint32_t size)
+{
+	struct tuple_unpacked *entry = &tuple_unpacked[tuple_unpacked_next];
+	tuple_unpacked_next = (tuple_unpacked_next + 1) %
+		TUPLE_UNPACKED_CACHE_SIZE;
+	entry->tuple = NULL;
+	if (size > entry->capacity) {
+		char *data = (char *) realloc(entry->data, size);
+		if (data == NULL)
+			return NULL;
+		entry->data = data;
+		entry->capacity = size;
+	}
+	entry->tuple = tuple;
+	entry->size = size;
+	return entry->data;
+}
+
+/** Skip the uncompressed prefix of a compressed tuple. */
+static const char *
+tuple_compressed_tail(const struct tuple *tuple)
+{
+	struct tuple_format *format = tuple_format(tuple);
+	assert(format->is_compressed);
+	const char *pos = tuple->data;
+	(void) mp_decode_array(&pos);
+	for (uint32_t i = 0; i < format->field_count; i++)
+		mp_next(&pos);
+	return pos;
+}
+
+/** The size of the decompressed data of a compressed tuple. */
+static uint32_t
+tuple_decompressed_size(const struct tuple *tuple)
+{
+	const char *pos = tuple_compressed_tail(tuple);
+	uint32_t prefix_size = pos - tuple->data;
+	return prefix_size + mp_decode_uint(&pos);
+}
+
+/**
+ * Decompress a compressed tuple into @a buf of
+ * tuple_decompressed_size() bytes.
+ */
+static void
+tuple_decompress(const struct tuple *tuple, char *buf)
+{
+#if defined(HAVE_LZ4)
+	const char *pos = tuple_compressed_tail(tuple);
+	uint32_t prefix_size = pos - tuple->data;
+	uint32_t tail_size = mp_decode_uint(&pos);
+	uint32_t block_size = mp_decode_binl(&pos);
+	memcpy(buf, tuple->data, prefix_size);
+	if (LZ4_decompress_safe(pos, buf + prefix_size, block_size,
+				tail_size) != (int) tail_size)
+		panic("failed to decompress tuple %p", tuple);
+#else
+	(void) buf;
+	panic("failed to decompress tuple %p: no LZ4 support", tuple);
+#endif /* defined(HAVE_LZ4) */
+}
+
+const char *
+tuple_field_cached(const struct tuple_format *format,
+		   const struct tuple *tuple, uint32_t i)
+{
+	const uint32_t *field_map = (const uint32_t *) tuple;
+	uint32_t step = format->offset_step;
+	/* Start from the closest cached offset. */
+	uint32_t k = MIN(i / step, format->offset_slots);
+	const char *pos = tuple->data;
+	if (k > 0) {
+		/* The field exists, so the slot has been filled. */
+		assert(field_map[format->offset_slot_base - k] != 0);
+		pos += field_map[format->offset_slot_base - k];
+	} else {
+		(void) mp_decode_array(&pos);
+	}
+	for (uint32_t fieldno = k * step; fieldno < i; fieldno++)
+		mp_next(&pos);
+	assert(pos <= tuple->data + tuple->bsize);
+	return pos;
+}
+
+const char *
+tuple_field_compressed(const struct tuple *tuple, uint32_t i)
+{
+	uint32_t size;
+	const char *pos = tuple_unpack(tuple, &size);
+	uint32_t field_count = mp_decode_array(&pos);
+	if (i >= field_count)
+		return NULL;
+	for (uint32_t k = 0; k < i; k++)
+		mp_next(&pos);
+	return pos;
+}
+
+/**
+ * Replace values of dictionary-encoded fields with ids of
+ * the interned values, @sa tuple_format::dict.
+ * @return the encoded data in the fiber region
+ */
+static const char *
+tuple_encode(struct tuple_format *format, const char *data,
+	     const char **end)
+{
+	assert(format->dict != NULL);
+	/* Ids are never bigger than the values they replace. */
+	char *buf = (char *) region_alloc(&fiber()->gc, *end - data);
+	const char *pos = data;
+	uint32_t field_count = mp_decode_array(&pos);
+	char *w = buf;
+	memcpy(w, data, pos - data);
+	w += pos - data;
+	uint32_t last = TUPLE_DICT_FIELD_MAX -
+		__builtin_clzll(format->dict_fields);
+	for (uint32_t i = 0; i < MIN(field_count, last); i++) {
+		const char *field = pos;
+		mp_next(&pos);
+		if (tuple_format_is_encoded(format, i)) {
+			if (mp_typeof(*field) != MP_STR) {
+				tnt_raise(ClientError, ER_FIELD_TYPE, i,
+					  field_type_strs[STRING]);
+			}
+			uint32_t id = tuple_dict_put(format->dict, field, pos);
+			if (id != TUPLE_DICT_ID_NIL) {
+				w = mp_encode_uint(w, id);
+				continue;
+			}
+		}
+		memcpy(w, field, pos - field);
+		w += pos - field;
+	}
+	memcpy(w, pos, *end - pos);
+	w += *end - pos;
+	*end = w;
+	return buf;
+}
+
+/**
+ * The size of the data of a dictionary-encoded tuple with ids
+ * replaced by the values, @sa tuple_decode().
+ */
+static uint32_t
+tuple_decoded_size(const struct tuple_format *format, const char *data,
+		   uint32_t size)
+{
+	const char *field = data;
+	uint32_t field_count = mp_decode_array(&field);
+	uint32_t last = MIN(field_count, TUPLE_DICT_FIELD_MAX -
+			    __builtin_clzll(format->dict_fields));
+	for (uint32_t i = 0; i < last; i++) {
+		const char *field_end = field;
+		mp_next(&field_end);
+		const char *value = tuple_field_decode(format, field, i);
+		if (value != field) {
+			const char *value_end = value;
+			mp_next(&value_end);
+			size += (value_end - value) - (field_end - field);
+		}
+		field = field_end;
+	}
+	return size;
+}
+
+/**
+ * Replace ids in dictionary-encoded fields with the values.
+ * @param buf the output buffer of tuple_decoded_size() bytes
+ */
+static void
+tuple_decode(const struct tuple_format *format, const char *data,
+	     uint32_t size, char *buf)
+{
+	const char *end = data + size;
+	const char *pos = data;
+	uint32_t field_count = mp_decode_array(&pos);
+	uint32_t last = MIN(field_count, TUPLE_DICT_FIELD_MAX -
+			    __builtin_clzll(format->dict_fields));
+	char *w = buf;
+	memcpy(w, data, pos - data);
+	w += pos - data;
+	for (uint32_t i = 0; i < last; i++) {
+		const char *field = pos;
+		mp_next(&pos);
+		const char *value = tuple_field_decode(format, field, i);
+		const char *value_end = pos;
+		if (value != field) {
+			value_end = value;
+			mp_next(&value_end);
+		}
+		memcpy(w, value, value_end - value);
+		w += value_end - value;
+	}
+	memcpy(w, pos, end - pos);
+}
+
+const char *
+tuple_unpack(const struct tuple *tuple, uint32_t *p_size)
+{
+	struct tuple_format *format = tuple_format(tuple);
+	assert(tuple_format_is_packed(format));
+	for (uint32_t i = 0; i < TUPLE_UNPACKED_CACHE_SIZE; i++) {
+		if (tuple_unpacked[i].tuple == tuple) {
+			*p_size = tuple_unpacked[i].size;
+			return tuple_unpacked[i].data;
+		}
+	}
+	struct region *gc = &fiber()->gc;
+	size_t used = region_used(gc);
+	const char *data = tuple->data;
+	uint32_t size = tuple->bsize;
+	if (format->is_compressed && format->dict != NULL) {
+		/* Decode a temporary decompressed copy. */
+		size = tuple_decompressed_size(tuple);
+		char *buf = (char *) region_alloc(gc, size);
+		tuple_decompress(tuple, buf);
+		data = buf;
+	}
+	uint32_t unpacked_size = format->dict != NULL ?
+		tuple_decoded_size(format, data, size) :
+		tuple_decompressed_size(tuple);
+	char *buf = tuple_unpacked_alloc(tuple, unpacked_size);
+	bool is_cached = buf != NULL;
+	if (!is_cached) {
+		/* Out of memory: don't cache the data. */
+		buf = (char *) region_alloc(gc, unpacked_size);
+	}
+	if (format->dict != NULL)
+		tuple_decode(format, data, size, buf);
+	else
+		tuple_decompress(tuple, buf);
+	if (is_cached)
+		region_truncate(gc, used);
+	*p_size = unpacked_size;
+	return buf;
+}
+
+/** Create a tuple of already encoded data. */
+static struct tuple *
+tuple_new_encoded(struct tuple_format *format, const char *data,
+		  const char *end)
 {
 	size_t tuple_len = end - data;
-	assert(mp_typeof(*data) == MP_ARRAY);
+	if (format->compressed != NULL &&
+	    tuple_len > format->compress_threshold) {
+		struct tuple *tuple = tuple_compress(format->compressed,
+						     data, end);
+		if (tuple != NULL)
+			return tuple;
+	}
 	struct tuple *new_tuple = tuple_alloc(format, tuple_len);
 	memcpy(new_tuple->data, data, tuple_len);
 	try {
@@ -425,6 +953,17 @@ tuple_new(struct tuple_format *format, const char *data, const char *end)
 	return new_tuple;
 }
 
+struct tuple *
+tuple_new(struct tuple_format *format, const char *data, const char *end)
+{
+	assert(mp_typeof(*data) == MP_ARRAY);
+	if (likely(format->dict == NULL))
+		return tuple_new_encoded(format, data, end);
+	RegionGuard region_guard(&fiber()->gc);
+	data = tuple_encode(format, data, &end);
+	return tuple_new_encoded(format, data, end);
+}
+
 /*
  * Compare two tuple fields.
  * Separate version exists since compare is a very
@@ -444,6 +983,9 @@ tuple_compare_field(const char *field_a, const char *field_b,
 		return mp_compare_uint(field_a, field_b);
 	case STRING:
 	{
+		/* Values interned in a dictionary are compared by id. */
+		if (field_a == field_b)
+			return 0;
 		uint32_t size_a = mp_decode_strl(&field_a);
 		uint32_t size_b = mp_decode_strl(&field_b);
 		const char *a = field_a;
@@ -532,7 +1074,8 @@ tuple_compare_with_key(const struct tuple *tuple, const char *key,
 
 void
 tuple_init(float tuple_arena_max_size, uint32_t objsize_min,
-	   uint32_t objsize_max, float alloc_factor)
+	   uint32_t objsize_max, float alloc_factor,
+	   const struct slab_placement *placement)
 {
 	tuple_format_ber = tuple_format_new(&rlist_nil);
 	/* Make sure this one stays around. */
@@ -564,8 +1107,9 @@ tuple_init(float tuple_arena_max_size, uint32_t objsize_min,
 		flags = MAP_SHARED;
 	}
 
-	if (slab_arena_create(&memtx_arena, &memtx_quota,
-			      prealloc, slab_size, flags)) {
+	if (slab_arena_create_with_placement(&memtx_arena, &memtx_quota,
+					     prealloc, slab_size, flags,
+					     placement)) {
 		if (ENOMEM == errno) {
 			panic("failed to preallocate %zu bytes: "
 			      "Cannot allocate memory, check option "
@@ -576,9 +1120,19 @@ tuple_init(float tuple_arena_max_size, uint32_t objsize_min,
 				       prealloc);
 		}
 	}
+	if (memtx_arena.placement_errors > 0) {
+		say_warn("failed to apply slab_alloc_hugepages/"
+			 "slab_alloc_numa to the arena, "
+			 "using regular pages");
+	}
 	slab_cache_create(&memtx_slab_cache, &memtx_arena);
-	small_alloc_create(&memtx_alloc, &memtx_slab_cache,
-			   objsize_min, alloc_factor);
+	/*
+	 * A tuple needs only 4-byte alignment for its header and
+	 * field map, so use finer size classes for tuples.
+	 */
+	small_alloc_create_with_step(&memtx_alloc, &memtx_slab_cache,
+				     objsize_min, alloc_factor,
+				     TUPLE_ALLOC_STEP);
 }
 
 void
@@ -596,12 +1150,16 @@ tuple_free()
 	     format++)
 		free(*format); /* ignore the reference count. */
 	free(tuple_formats);
+	for (uint32_t i = 0; i < TUPLE_UNPACKED_CACHE_SIZE; i++) {
+		free(tuple_unpacked[i].data);
+		memset(&tuple_unpacked[i], 0, sizeof(tuple_unpacked[i]));
+	}
 }
 
 void
 tuple_begin_snapshot()
 {
-	snapshot_version++;
+	assert(snapshot_garbage_size == 0);
 	small_alloc_setopt(&memtx_alloc, SMALL_DELAYED_FREE_MODE, true);
 }
 
@@ -609,6 +1167,13 @@ void
 tuple_end_snapshot()
 {
 	small_alloc_setopt(&memtx_alloc, SMALL_DELAYED_FREE_MODE, false);
+	for (size_t i = 0; i < snapshot_garbage_size; i++) {
+		smfree(&memtx_alloc, snapshot_garbage[i].ptr,
+		       snapshot_garbage[i].size);
+	}
+	free(snapshot_garbage);
+	snapshot_garbage = NULL;
+	snapshot_garbage_size = snapshot_garbage_capacity = 0;
 }
 
 double mp_decode_num(const char **data, uint32_t i)
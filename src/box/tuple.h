@@ -30,6 +30,7 @@
  */
 #include "trivia/util.h"
 #include "key_def.h" /* for enum field_type */
+#include "tuple_dict.h"
 
 enum { FORMAT_ID_MAX = UINT16_MAX - 1, FORMAT_ID_NIL = UINT16_MAX };
 enum { FORMAT_REF_MAX = INT32_MAX, TUPLE_REF_MAX = UINT16_MAX };
@@ -76,6 +77,48 @@ struct tuple_format {
 	 * tuple, *in bytes*.
 	 */
 	uint32_t field_map_size;
+	/**
+	 * The format of compressed tuples, NULL if tuples of
+	 * this format are never compressed. A compressed tuple
+	 * keeps the array header and the first field_count
+	 * fields as is, so that indexed fields remain directly
+	 * addressable through the field map, which has the same
+	 * layout in both formats. The rest of the fields is
+	 * stored as a single LZ4 block:
+	 * <array header> <fields 0..field_count-1>
+	 * <MP_UINT tail size> <MP_BIN compressed tail>.
+	 */
+	struct tuple_format *compressed;
+	/** Tuples bigger than this many bytes are compressed. */
+	uint32_t compress_threshold;
+	/** True if this is the format of compressed tuples. */
+	bool is_compressed;
+	/**
+	 * Offsets of every offset_step-th field which is not
+	 * indexed are cached in the field map, 0 if the cache
+	 * is off, @sa tuple_format_set_field_offsets().
+	 */
+	uint32_t offset_step;
+	/**
+	 * The number of cached offsets. Offset of field
+	 * k * offset_step is stored in
+	 * field_map[offset_slot_base - k], k = 1..offset_slots.
+	 * The slots are filled when a tuple is created and are
+	 * read-only afterwards; a slot is 0 if the tuple has no
+	 * such field.
+	 */
+	uint32_t offset_slots;
+	int32_t offset_slot_base;
+	/**
+	 * The dictionary of dictionary-encoded fields, NULL if
+	 * there are none. A value of such a field which is worth
+	 * interning is stored as MP_UINT id in the dictionary,
+	 * other values are stored as is. Shared with the format
+	 * of compressed tuples.
+	 */
+	struct tuple_dict *dict;
+	/** Bit i is set if field i is dictionary-encoded. */
+	uint64_t dict_fields;
 	/**
 	 * For each field participating in an index, the format
 	 * may either store the fixed offset of the field
@@ -117,6 +160,51 @@ tuple_format_id(struct tuple_format *format)
 struct tuple_format *
 tuple_format_new(struct rlist *key_list);
 
+/**
+ * Make tuples of the format which are bigger than @a threshold
+ * bytes compressed, @sa tuple_format::compressed.
+ * @param key_list  the key list @a format was created from
+ */
+void
+tuple_format_set_compression(struct tuple_format *format,
+			     struct rlist *key_list, uint32_t threshold);
+
+/**
+ * Cache offsets of fields 0..field_count-1 with the given step
+ * in the field map of tuples of the format. Offsets are filled
+ * when a tuple is created, so a lookup of a field of a wide
+ * tuple walks at most step - 1 fields. Compressed tuples
+ * don't use the cache.
+ */
+void
+tuple_format_set_field_offsets(struct tuple_format *format, uint32_t step,
+			       uint32_t field_count);
+
+/**
+ * Make fields of the format dictionary-encoded.
+ * @param fields a bit mask of field numbers,
+ * @sa tuple_format::dict_fields.
+ */
+void
+tuple_format_set_dict(struct tuple_format *format, uint64_t fields);
+
+/** Check if field @a i of tuples of the format is dictionary-encoded. */
+static inline bool
+tuple_format_is_encoded(const struct tuple_format *format, uint32_t i)
+{
+	return i < TUPLE_DICT_FIELD_MAX && (format->dict_fields >> i) & 1;
+}
+
+/**
+ * Check if tuples of the format store their data compressed
+ * or dictionary-encoded rather than as is.
+ */
+static inline bool
+tuple_format_is_packed(const struct tuple_format *format)
+{
+	return format->is_compressed || format->dict != NULL;
+}
+
 /** Delete a format with zero ref count. */
 void
 tuple_format_delete(struct tuple_format *format);
@@ -140,13 +228,11 @@ tuple_format_ref(struct tuple_format *format, int count)
 struct tuple
 {
 	/*
-	 * sic: the header of the tuple is used
-	 * to store a free list pointer in smfree_delayed.
-	 * Please don't change it without understanding
-	 * how smfree_delayed and snapshotting COW works.
+	 * sic: the header of the tuple may be read by the
+	 * snapshot process after the tuple is deleted, so
+	 * a deleted tuple is never linked into a free list
+	 * until the snapshot ends, @sa tuple_delete().
 	 */
-	/** snapshot generation version */
-	uint32_t version;
 	/** reference counter */
 	uint16_t refs;
 	/** format identifier */
@@ -187,6 +273,21 @@ tuple_new(struct tuple_format *format, const char *data, const char *end);
 void
 tuple_delete(struct tuple *tuple);
 
+/**
+ * Allocate a copy of the tuple, including its field map.
+ * tuple->refs of the copy is 0.
+ */
+struct tuple *
+tuple_dup(struct tuple *tuple);
+
+/**
+ * Check if the tuple resides in a sparsely populated slab and
+ * is worth moving to a new place to reduce fragmentation of
+ * the tuple arena, @sa small_should_relocate().
+ */
+bool
+tuple_should_relocate(struct tuple *tuple);
+
 /**
  * Throw and exception about tuple reference counter overflow.
  */
@@ -246,6 +347,66 @@ tuple_format(const struct tuple *tuple)
 	return format;
 }
 
+/**
+ * Memory allocated for the tuple: the header, the field map
+ * and the data.
+ */
+static inline size_t
+tuple_size(const struct tuple *tuple)
+{
+	return sizeof(struct tuple) + tuple->bsize +
+		tuple_format(tuple)->field_map_size;
+}
+
+enum {
+	/** How many unpacked tuples are kept around. */
+	TUPLE_UNPACKED_CACHE_SIZE = 4
+};
+
+/**
+ * Restore the data of a compressed or dictionary-encoded tuple.
+ * The data of the last TUPLE_UNPACKED_CACHE_SIZE unpacked tuples
+ * is cached, so it stays valid until that many other tuples are
+ * unpacked or the tuple is deleted.
+ * @sa tuple_data_range()
+ */
+const char *
+tuple_unpack(const struct tuple *tuple, uint32_t *p_size);
+
+/**
+ * Get the MsgPack data of the tuple. The data of a compressed
+ * or dictionary-encoded tuple is restored in a small cache,
+ * @sa tuple_unpack(). Copy the data if it is needed for longer.
+ *
+ * @param tuple tuple
+ * @param[out] p_size the size of the data
+ * @return the tuple data, an array of fields
+ */
+extern "C" inline const char *
+tuple_data_range(const struct tuple *tuple, uint32_t *p_size)
+{
+	if (unlikely(tuple_format_is_packed(tuple_format(tuple))))
+		return tuple_unpack(tuple, p_size);
+	*p_size = tuple->bsize;
+	return tuple->data;
+}
+
+/**
+ * Get a field using the offset cache of the format,
+ * @sa tuple_format::offset_step.
+ */
+const char *
+tuple_field_cached(const struct tuple_format *format,
+		   const struct tuple *tuple, uint32_t i);
+
+/**
+ * Get a field of a compressed tuple which is not covered
+ * by the field map. The field points to the unpacked data,
+ * @sa tuple_unpack() for how long it stays valid.
+ */
+const char *
+tuple_field_compressed(const struct tuple *tuple, uint32_t i);
+
 /**
  * @brief Return the number of fields in tuple
  * @param tuple
@@ -259,14 +420,11 @@ tuple_field_count(const struct tuple *tuple)
 }
 
 /**
- * Get a field from tuple by index.
- * Returns a pointer to BER-length prefixed field.
- *
- * @pre field < tuple->field_count.
- * @returns field data if field exists or NULL
+ * Get a field from tuple by index as it is stored, i.e.
+ * without looking up a dictionary-encoded value.
  */
 inline const char *
-tuple_field_old(const struct tuple_format *format,
+tuple_field_raw(const struct tuple_format *format,
 		const struct tuple *tuple, uint32_t i)
 {
 	if (likely(i < format->field_count)) {
@@ -289,6 +447,10 @@ tuple_field_old(const struct tuple_format *format,
 	uint32_t size = mp_decode_array(&pos);
 	if (unlikely(i >= size))
 		return NULL;
+	if (unlikely(format->is_compressed && i >= format->field_count))
+		return tuple_field_compressed(tuple, i);
+	if (format->offset_step != 0 && i >= format->offset_step)
+		return tuple_field_cached(format, tuple, i);
 
 	for (uint32_t k = 0; k < i; k++) {
 		mp_next(&pos);
@@ -298,6 +460,36 @@ tuple_field_old(const struct tuple_format *format,
 	return pos;
 }
 
+/**
+ * Get the value of a field which may be dictionary-encoded,
+ * @sa tuple_format::dict.
+ */
+static inline const char *
+tuple_field_decode(const struct tuple_format *format, const char *field,
+		   uint32_t i)
+{
+	if (!tuple_format_is_encoded(format, i) || mp_typeof(*field) != MP_UINT)
+		return field;
+	return tuple_dict_get(format->dict, mp_decode_uint(&field));
+}
+
+/**
+ * Get a field from tuple by index.
+ * Returns a pointer to BER-length prefixed field.
+ *
+ * @pre field < tuple->field_count.
+ * @returns field data if field exists or NULL
+ */
+inline const char *
+tuple_field_old(const struct tuple_format *format,
+		const struct tuple *tuple, uint32_t i)
+{
+	const char *field = tuple_field_raw(format, tuple, i);
+	if (unlikely(format->dict != NULL) && field != NULL)
+		return tuple_field_decode(format, field, i);
+	return field;
+}
+
 /**
  * @brief Return field data of the field
  * @param tuple tuple
@@ -366,6 +558,8 @@ struct tuple_iterator {
 	const struct tuple *tuple;
 	/** Always points to the beginning of the next field. */
 	const char *pos;
+	/** The end of the tuple data, @sa tuple_data_range(). */
+	const char *end;
 	/** @endcond **/
 	/** field no of the next field. */
 	int fieldno;
@@ -391,8 +585,10 @@ struct tuple_iterator {
 extern "C" inline void
 tuple_rewind(struct tuple_iterator *it, const struct tuple *tuple)
 {
+	uint32_t bsize;
 	it->tuple = tuple;
-	it->pos = tuple->data;
+	it->pos = tuple_data_range(tuple, &bsize);
+	it->end = it->pos + bsize;
 	(void) mp_decode_array(&it->pos); /* Skip array header */
 	it->fieldno = 0;
 }
@@ -515,17 +711,18 @@ tuple_compare_with_key(const struct tuple *tuple_a, const char *key,
 void
 tuple_to_obuf(struct tuple *tuple, struct obuf *buf);
 
+
+struct slab_placement;
+
 /**
- * Store tuple fields in the memory buffer. Buffer must have at least
- * tuple->bsize bytes.
+ * Initialize tuple library
+ * @param placement huge page and NUMA placement of the tuple
+ * arena, also used for the index arena
  */
-extern "C" void
-tuple_to_buf(struct tuple *tuple, char *buf);
-
-/** Initialize tuple library */
 void
 tuple_init(float alloc_arena_max_size, uint32_t slab_alloc_minimal,
-	   uint32_t slab_alloc_maximal, float alloc_factor);
+	   uint32_t slab_alloc_maximal, float alloc_factor,
+	   const struct slab_placement *placement);
 
 /** Cleanup tuple library */
 void
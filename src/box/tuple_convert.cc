@@ -28,15 +28,13 @@
  */
 #include "tuple.h"
 #include "iobuf.h"
+#include "fiber.h"
 
 void
 tuple_to_obuf(struct tuple *tuple, struct obuf *buf)
 {
-	obuf_dup(buf, tuple->data, tuple->bsize);
-}
-
-void
-tuple_to_buf(struct tuple *tuple, char *buf)
-{
-	memcpy(buf, tuple->data, tuple->bsize);
+	RegionGuard region_guard(&fiber()->gc);
+	uint32_t bsize;
+	const char *data = tuple_data_range(tuple, &bsize);
+	obuf_dup(buf, data, bsize);
 }
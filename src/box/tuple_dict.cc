@@ -0,0 +1,133 @@
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "tuple_dict.h"
+#include <stdlib.h>
+#include <string.h>
+#include "error.h"
+#include "msgpuck/msgpuck.h"
+#include "third_party/PMurHash.h"
+
+enum { TUPLE_DICT_HASH_SEED = 13U };
+
+/** A value looked up in the dictionary. */
+struct tuple_dict_key {
+	const char *data;
+	uint32_t size;
+	uint32_t hash;
+};
+
+#define MH_SOURCE 1
+#define mh_name _tuple_dict
+#define mh_key_t const struct tuple_dict_key *
+#define mh_node_t uint32_t
+#define mh_arg_t struct tuple_dict *
+#define mh_hash(a, arg) ((arg)->values[*(a)]->hash)
+#define mh_hash_key(a, arg) ((a)->hash)
+#define mh_eq(a, b, arg) (*(a) == *(b))
+#define mh_eq_key(a, b, arg) ({						\
+	const struct tuple_dict_value *v = (arg)->values[*(b)];		\
+	(a)->size == v->size && memcmp((a)->data, v->data, v->size) == 0;\
+})
+#include "salad/mhash.h"
+
+struct tuple_dict *
+tuple_dict_new()
+{
+	struct tuple_dict *dict = (struct tuple_dict *)
+		calloc(1, sizeof(*dict));
+	if (dict == NULL) {
+		tnt_raise(LoggedError, ER_MEMORY_ISSUE, sizeof(*dict),
+			  "tuple dictionary", "malloc");
+	}
+	dict->hash = mh_tuple_dict_new();
+	if (dict->hash == NULL) {
+		free(dict);
+		tnt_raise(LoggedError, ER_MEMORY_ISSUE, sizeof(*dict),
+			  "tuple dictionary", "hash");
+	}
+	return dict;
+}
+
+void
+tuple_dict_delete(struct tuple_dict *dict)
+{
+	for (uint32_t id = 0; id < dict->size; id++)
+		free(dict->values[id]);
+	free(dict->values);
+	mh_tuple_dict_delete(dict->hash);
+	free(dict);
+}
+
+uint32_t
+tuple_dict_put(struct tuple_dict *dict, const char *field,
+	       const char *field_end)
+{
+	struct tuple_dict_key key;
+	key.data = field;
+	key.size = field_end - field;
+	key.hash = PMurHash32(TUPLE_DICT_HASH_SEED, key.data, key.size);
+	mh_int_t k = mh_tuple_dict_find(dict->hash, &key, dict);
+	if (k != mh_end(dict->hash))
+		return *mh_tuple_dict_node(dict->hash, k);
+
+	uint32_t id = dict->size;
+	if (id >= TUPLE_DICT_SIZE_MAX || mp_sizeof_uint(id) >= key.size)
+		return TUPLE_DICT_ID_NIL;
+	/*
+	 * Running out of memory is not an error: the value
+	 * is stored in the tuple as is.
+	 */
+	if (id == dict->capacity) {
+		uint32_t capacity = dict->capacity ? dict->capacity * 2 : 64;
+		struct tuple_dict_value **values =
+			(struct tuple_dict_value **)
+			realloc(dict->values, capacity * sizeof(*values));
+		if (values == NULL)
+			return TUPLE_DICT_ID_NIL;
+		dict->bsize += (capacity - dict->capacity) * sizeof(*values);
+		dict->values = values;
+		dict->capacity = capacity;
+	}
+	struct tuple_dict_value *value = (struct tuple_dict_value *)
+		malloc(sizeof(*value) + key.size);
+	if (value == NULL)
+		return TUPLE_DICT_ID_NIL;
+	value->hash = key.hash;
+	value->size = key.size;
+	memcpy(value->data, key.data, key.size);
+	dict->values[id] = value;
+	if (mh_tuple_dict_put(dict->hash, &id, NULL, dict) ==
+	    mh_end(dict->hash)) {
+		free(value);
+		return TUPLE_DICT_ID_NIL;
+	}
+	dict->size++;
+	dict->bsize += sizeof(*value) + key.size;
+	return id;
+}
@@ -0,0 +1,129 @@
+#ifndef TARANTOOL_BOX_TUPLE_DICT_H_INCLUDED
+#define TARANTOOL_BOX_TUPLE_DICT_H_INCLUDED
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+
+enum {
+	/**
+	 * Field numbers of dictionary-encoded fields must be
+	 * less than this, @sa tuple_format::dict_fields.
+	 */
+	TUPLE_DICT_FIELD_MAX = 64,
+	/**
+	 * Max number of values in a dictionary. Ids of the
+	 * values take at most 3 bytes of MsgPack.
+	 */
+	TUPLE_DICT_SIZE_MAX = UINT16_MAX + 1,
+	/** Returned by tuple_dict_put() for a value not interned. */
+	TUPLE_DICT_ID_NIL = UINT32_MAX
+};
+
+struct mh_tuple_dict_t;
+
+/** An interned value. */
+struct tuple_dict_value {
+	/** Hash of the value. */
+	uint32_t hash;
+	/** Size of data. */
+	uint32_t size;
+	/** The value, a MsgPack string. */
+	char data[0];
+};
+
+/**
+ * A dictionary of string values shared by tuples of a format
+ * and its compressed twin. Tuples store ids of interned
+ * values in dictionary-encoded fields, @sa tuple_format::dict.
+ * Values are never removed: the dictionary is freed with
+ * the last format referencing it.
+ */
+struct tuple_dict {
+	/** Reference counter. */
+	int refs;
+	/** The number of interned values. */
+	uint32_t size;
+	/** Allocated length of the values array. */
+	uint32_t capacity;
+	/** Interned values, indexed by id. */
+	struct tuple_dict_value **values;
+	/** Value -> id map. */
+	struct mh_tuple_dict_t *hash;
+	/** Memory used by the dictionary, in bytes. */
+	size_t bsize;
+};
+
+/**
+ * Create an empty dictionary with a zero reference counter.
+ * Throws an exception on allocation error.
+ */
+struct tuple_dict *
+tuple_dict_new();
+
+/** Free a dictionary. */
+void
+tuple_dict_delete(struct tuple_dict *dict);
+
+static inline void
+tuple_dict_ref(struct tuple_dict *dict)
+{
+	dict->refs++;
+}
+
+static inline void
+tuple_dict_unref(struct tuple_dict *dict)
+{
+	assert(dict->refs > 0);
+	if (--dict->refs == 0)
+		tuple_dict_delete(dict);
+}
+
+/**
+ * Intern a value.
+ * @param field a MsgPack string
+ * @param field_end the end of the string
+ * @return the id of the value, or TUPLE_DICT_ID_NIL if
+ * the value is not worth encoding (its id would take as
+ * much space) or the dictionary is full
+ */
+uint32_t
+tuple_dict_put(struct tuple_dict *dict, const char *field,
+	       const char *field_end);
+
+/** Get an interned value, a MsgPack string, by id. */
+static inline const char *
+tuple_dict_get(const struct tuple_dict *dict, uint32_t id)
+{
+	assert(id < dict->size);
+	return dict->values[id]->data;
+}
+
+#endif /* TARANTOOL_BOX_TUPLE_DICT_H_INCLUDED */
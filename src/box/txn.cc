@@ -39,8 +39,10 @@
 #include "session.h"
 #include "port.h"
 #include "iproto_constants.h"
+#include "scoped_guard.h"
 
 double too_long_threshold;
+RLIST_HEAD(txn_wal_queue);
 
 static inline void
 fiber_set_txn(struct fiber *fiber, struct txn *txn)
@@ -144,20 +146,26 @@ txn_commit(struct txn *txn)
 	if (txn->engine)
 		txn->engine->prepare(txn);
 
-	rlist_foreach_entry(stmt, &txn->stmts, next) {
-		if (stmt->row == NULL)
-			continue;
-		ev_tstamp start = ev_now(loop()), stop;
-		int64_t res = wal_write(recovery, stmt->row);
-		stop = ev_now(loop());
-		if (stop - start > too_long_threshold && stmt->row != NULL) {
-			say_warn("too long %s: %.3f sec",
-				 iproto_type_name(stmt->row->type),
-				 stop - start);
+	rlist_add_tail_entry(&txn_wal_queue, txn, in_wal_queue);
+	{
+		auto wal_guard = make_scoped_guard([=] {
+			rlist_del_entry(txn, in_wal_queue);
+		});
+		rlist_foreach_entry(stmt, &txn->stmts, next) {
+			if (stmt->row == NULL)
+				continue;
+			ev_tstamp start = ev_now(loop()), stop;
+			int64_t res = wal_write(recovery, stmt->row);
+			stop = ev_now(loop());
+			if (stop - start > too_long_threshold && stmt->row != NULL) {
+				say_warn("too long %s: %.3f sec",
+					 iproto_type_name(stmt->row->type),
+					 stop - start);
+			}
+			if (res < 0)
+				tnt_raise(LoggedError, ER_WAL_IO);
+			txn->signature = res;
 		}
-		if (res < 0)
-			tnt_raise(LoggedError, ER_WAL_IO);
-		txn->signature = res;
 	}
 
 	/*
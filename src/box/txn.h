@@ -76,8 +76,17 @@ struct txn {
 	 * for in-memory engine.
 	 */
 	struct trigger fiber_on_yield, fiber_on_stop;
+	/** Link in txn_wal_queue. */
+	struct rlist in_wal_queue;
 };
 
+/**
+ * Transactions waiting for completion of their WAL write.
+ * Statements of these transactions refer to tuples which are
+ * already in the indexes, but may still be rolled back.
+ */
+extern struct rlist txn_wal_queue;
+
 /* Pointer to the current transaction (if any) */
 static inline struct txn *
 in_txn()
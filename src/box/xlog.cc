@@ -723,7 +723,8 @@ xlog_sync(struct xlog *l)
 			say_syserror("%s: dup() failed", l->filename);
 			return -1;
 		}
-		eio_fsync(fd, 0, sync_cb, (void *) (intptr_t) fd);
+		/* Ahead of user I/O queued in libeio. */
+		eio_fsync(fd, EIO_PRI_MAX, sync_cb, (void *) (intptr_t) fd);
 	} else if (fsync(fileno(l->f)) < 0) {
 		say_syserror("%s: fsync failed", l->filename);
 		return -1;
@@ -0,0 +1,206 @@
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "cbus.h"
+#include "say.h"
+
+/** Run the next hop of the message and send it further. */
+static inline void
+cmsg_deliver(struct cmsg *msg)
+{
+	const struct cmsg_hop *hop = msg->hop;
+	msg->hop = hop + 1;
+	/* The last hop may free the message. */
+	struct cpipe *pipe = hop->pipe;
+	if (hop->f != NULL)
+		hop->f(msg);
+	if (pipe != NULL)
+		cpipe_push(pipe, msg);
+}
+
+static void
+cbus_endpoint_cb(ev_loop * /* loop */, ev_async *watcher, int /* events */)
+{
+	struct cbus_endpoint *endpoint = (struct cbus_endpoint *) watcher->data;
+	/*
+	 * Take the whole queue at once: there is a single
+	 * consumer, so the ABA problem of a lock-free pop
+	 * does not arise.
+	 */
+	struct cmsg *queue = __sync_lock_test_and_set(&endpoint->queue,
+						      NULL);
+	/* The queue is the newest first, restore the order. */
+	struct cmsg *msg = NULL;
+	while (queue != NULL) {
+		struct cmsg *next = queue->next;
+		queue->next = msg;
+		msg = queue;
+		queue = next;
+	}
+	while (msg != NULL) {
+		struct cmsg *next = msg->next;
+		cmsg_deliver(msg);
+		endpoint->n_delivered++;
+		msg = next;
+	}
+}
+
+void
+cbus_endpoint_create(struct cbus_endpoint *endpoint)
+{
+	endpoint->queue = NULL;
+	endpoint->consumer = loop();
+	endpoint->n_delivered = 0;
+	ev_async_init(&endpoint->async, cbus_endpoint_cb);
+	endpoint->async.data = endpoint;
+	ev_async_start(endpoint->consumer, &endpoint->async);
+}
+
+void
+cbus_endpoint_destroy(struct cbus_endpoint *endpoint)
+{
+	assert(endpoint->consumer == loop());
+	ev_async_stop(endpoint->consumer, &endpoint->async);
+	/* Deliver what the producers managed to send. */
+	cbus_endpoint_cb(endpoint->consumer, &endpoint->async, 0);
+}
+
+static void
+cpipe_flush_cb(ev_loop * /* loop */, ev_async *watcher, int /* events */)
+{
+	cpipe_flush_input((struct cpipe *) watcher->data);
+}
+
+void
+cpipe_create(struct cpipe *pipe, struct cbus_endpoint *endpoint)
+{
+	pipe->endpoint = endpoint;
+	pipe->input = pipe->input_last = NULL;
+	pipe->n_input = 0;
+	pipe->max_input = CPIPE_MAX_INPUT;
+	pipe->producer = loop();
+	ev_async_init(&pipe->flush_input, cpipe_flush_cb);
+	pipe->flush_input.data = pipe;
+}
+
+void
+cpipe_destroy(struct cpipe *pipe)
+{
+	assert(pipe->producer == loop());
+	cpipe_flush_input(pipe);
+	ev_clear_pending(pipe->producer, &pipe->flush_input);
+}
+
+void
+cpipe_flush_input(struct cpipe *pipe)
+{
+	if (pipe->n_input == 0)
+		return;
+	struct cbus_endpoint *endpoint = pipe->endpoint;
+	struct cmsg *queue;
+	do {
+		queue = __atomic_load_n(&endpoint->queue, __ATOMIC_RELAXED);
+		pipe->input_last->next = queue;
+	} while (__sync_val_compare_and_swap(&endpoint->queue, queue,
+					     pipe->input) != queue);
+	/*
+	 * Whoever makes the queue non-empty wakes the consumer
+	 * up, the rest of the producers don't need to.
+	 */
+	if (queue == NULL)
+		ev_async_send(endpoint->consumer, &endpoint->async);
+	pipe->input = pipe->input_last = NULL;
+	pipe->n_input = 0;
+}
+
+static void
+cbus_call_fiber_f(va_list ap)
+{
+	struct cbus_call_msg *msg = va_arg(ap, struct cbus_call_msg *);
+	try {
+		msg->rc = msg->func(msg);
+	} catch (Exception *e) {
+		e->log();
+		msg->rc = -1;
+	}
+	cpipe_push(msg->caller_pipe, &msg->msg);
+}
+
+/**
+ * Run the function of cbus_call() in a new fiber of the
+ * callee cord: unlike the hop functions, it may yield.
+ */
+static void
+cbus_call_perform(struct cmsg *m)
+{
+	struct cbus_call_msg *msg = (struct cbus_call_msg *) m;
+	struct fiber *f;
+	try {
+		f = fiber_new("cbus_call", cbus_call_fiber_f);
+	} catch (Exception *e) {
+		e->log();
+		msg->rc = -1;
+		cpipe_push(msg->caller_pipe, &msg->msg);
+		return;
+	}
+	fiber_start(f, msg);
+}
+
+/** Wake up the caller of cbus_call() in its cord. */
+static void
+cbus_call_done(struct cmsg *m)
+{
+	struct cbus_call_msg *msg = (struct cbus_call_msg *) m;
+	msg->complete = true;
+	fiber_wakeup(msg->caller);
+}
+
+int
+cbus_call(struct cpipe *callee, struct cpipe *caller,
+	  struct cbus_call_msg *msg, cbus_call_f func)
+{
+	/* The callee fiber sends the message back itself. */
+	msg->route[0].f = cbus_call_perform;
+	msg->route[0].pipe = NULL;
+	msg->route[1].f = cbus_call_done;
+	msg->route[1].pipe = NULL;
+	cmsg_init(&msg->msg, msg->route);
+	msg->caller_pipe = caller;
+	msg->func = func;
+	msg->caller = fiber();
+	msg->complete = false;
+	msg->rc = 0;
+
+	cpipe_push(callee, &msg->msg);
+	/* The message lives on the stack, wait for it anyway. */
+	bool cancellable = fiber_set_cancellable(false);
+	while (! msg->complete)
+		fiber_yield();
+	fiber_set_cancellable(cancellable);
+	return msg->rc;
+}
@@ -0,0 +1,214 @@
+#ifndef TARANTOOL_CBUS_H_INCLUDED
+#define TARANTOOL_CBUS_H_INCLUDED
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdbool.h>
+#include "fiber.h"
+
+/**
+ * @brief CBUS - a message bus between cords.
+ *
+ * A message (struct cmsg) travels from cord to cord along a
+ * route: a static array of hops. Each hop is a function which
+ * is run by the cord the message is delivered to, and a pipe
+ * to the cord of the next hop.
+ *
+ * A cord receives messages through a cbus_endpoint: a lock-free
+ * queue with many producers and a single consumer. Another cord
+ * sends messages to the endpoint through its own cpipe. A pipe
+ * accumulates messages pushed during one event loop iteration,
+ * and passes them to the endpoint at once; the consumer cord
+ * is woken up with ev_async_send() only if its queue was empty.
+ * The consumer takes the whole queue at once as well, and runs
+ * the messages in the order they were pushed to each pipe.
+ */
+
+struct cmsg;
+struct cpipe;
+
+typedef void (*cmsg_f)(struct cmsg *);
+
+/** A step of a message route. */
+struct cmsg_hop {
+	/**
+	 * A function to run in the cord the message is
+	 * delivered to, may be NULL. Is run by the event loop,
+	 * so it must not yield: start a fiber to do anything
+	 * blocking. Must not free or reuse the message unless
+	 * this is the last hop.
+	 */
+	cmsg_f f;
+	/**
+	 * A pipe to the cord of the next hop, created in the
+	 * cord of this hop. NULL for the last hop.
+	 */
+	struct cpipe *pipe;
+};
+
+/** A message to send over the bus. */
+struct cmsg {
+	/** Link in a pipe or an endpoint queue. */
+	struct cmsg *next;
+	/** The next hop of the route. */
+	const struct cmsg_hop *hop;
+};
+
+/**
+ * Initialize a message to travel along the route. The first
+ * hop is run by the cord of the pipe the message is pushed to.
+ */
+static inline void
+cmsg_init(struct cmsg *msg, const struct cmsg_hop *route)
+{
+	msg->next = NULL;
+	msg->hop = route;
+}
+
+/** The receiving end of the bus in a cord. */
+struct cbus_endpoint {
+	/**
+	 * Messages passed by producers and not yet taken
+	 * by the consumer, the newest first.
+	 */
+	struct cmsg *queue;
+	/** The event loop of the consumer cord. */
+	struct ev_loop *consumer;
+	/** Wakes the consumer up when the queue gets non-empty. */
+	struct ev_async async;
+	/** The number of messages delivered, for statistics. */
+	uint64_t n_delivered;
+};
+
+/**
+ * Create an endpoint for the current cord. Messages pushed
+ * to pipes of this endpoint are delivered to the current cord
+ * from its event loop.
+ */
+void
+cbus_endpoint_create(struct cbus_endpoint *endpoint);
+
+/**
+ * Destroy an endpoint. Must be called by the cord which
+ * created it, after all pipes to it are destroyed.
+ */
+void
+cbus_endpoint_destroy(struct cbus_endpoint *endpoint);
+
+/** The sending end of the bus, from one cord to one endpoint. */
+struct cpipe {
+	/** The endpoint of the destination cord. */
+	struct cbus_endpoint *endpoint;
+	/** Messages not yet passed to the endpoint, the newest first. */
+	struct cmsg *input;
+	/** The oldest message in the input. */
+	struct cmsg *input_last;
+	/** The number of messages in the input. */
+	unsigned n_input;
+	/**
+	 * Pass the input to the endpoint as soon as it has this
+	 * many messages, not waiting for the end of the event
+	 * loop iteration.
+	 */
+	unsigned max_input;
+	/** The event loop of the producer cord. */
+	struct ev_loop *producer;
+	/** Flushes the input at the end of the loop iteration. */
+	struct ev_async flush_input;
+};
+
+enum { CPIPE_MAX_INPUT = 256 };
+
+/** Create a pipe from the current cord to an endpoint. */
+void
+cpipe_create(struct cpipe *pipe, struct cbus_endpoint *endpoint);
+
+/** Flush the input and destroy the pipe. */
+void
+cpipe_destroy(struct cpipe *pipe);
+
+/** Pass all messages of the input to the endpoint. */
+void
+cpipe_flush_input(struct cpipe *pipe);
+
+/**
+ * Send a message over the pipe. The message is passed to the
+ * endpoint at the end of the current event loop iteration, or
+ * once the pipe has max_input messages.
+ */
+static inline void
+cpipe_push(struct cpipe *pipe, struct cmsg *msg)
+{
+	msg->next = pipe->input;
+	if (pipe->input == NULL) {
+		pipe->input_last = msg;
+		ev_feed_event(pipe->producer, &pipe->flush_input,
+			      EV_CUSTOM);
+	}
+	pipe->input = msg;
+	if (++pipe->n_input >= pipe->max_input)
+		cpipe_flush_input(pipe);
+}
+
+struct cbus_call_msg;
+typedef int (*cbus_call_f)(struct cbus_call_msg *);
+
+/**
+ * A message of cbus_call(). Usually is a member of
+ * a struct with the arguments and the result of the call.
+ */
+struct cbus_call_msg {
+	struct cmsg msg;
+	/** There and back again. */
+	struct cmsg_hop route[2];
+	/** The pipe from the callee cord back to the caller. */
+	struct cpipe *caller_pipe;
+	/** The function to run in the callee cord, may yield. */
+	cbus_call_f func;
+	/** The fiber waiting for the result. */
+	struct fiber *caller;
+	bool complete;
+	/** The return value of func, -1 if it raised. */
+	int rc;
+};
+
+/**
+ * Run a function in another cord and wait for it to return,
+ * without blocking other fibers of the current cord.
+ *
+ * @param callee a pipe to the cord to run func in
+ * @param caller a pipe back to the current cord, created
+ *        in the callee cord
+ * @return the return value of func, -1 if func raised an
+ *         exception, which is logged by the callee cord
+ */
+int
+cbus_call(struct cpipe *callee, struct cpipe *caller,
+	  struct cbus_call_msg *msg, cbus_call_f func);
+
+#endif /* TARANTOOL_CBUS_H_INCLUDED */
@@ -38,6 +38,8 @@
 
 #include "fiber.h"
 #include "exception.h"
+#include "say.h"
+#include "tt_pthread.h"
 #include "third_party/tarantool_ev.h"
 
 /*
@@ -96,6 +98,185 @@ coeio_want_poll_cb(void)
 	ev_async_send(coeio_manager.loop, &coeio_manager.coeio_async);
 }
 
+struct coio_pool {
+	char name[COIO_POOL_NAME_MAX];
+	/** The number of threads, and of started threads. */
+	int threads;
+	int started;
+	pthread_t thread[COIO_POOL_THREADS_MAX];
+	/** Protects the queue of calls and is_stopped. */
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	struct rlist queue;
+	bool is_stopped;
+	/** Calls complete by the threads. */
+	pthread_mutex_t done_mutex;
+	struct rlist done;
+	/** Wakes up the tx loop when a batch is complete. */
+	ev_async done_event;
+	/** Link in coio_pools. */
+	struct rlist link;
+};
+
+/** A call of coio_pool_call(), on the stack of the fiber. */
+struct coio_pool_task {
+	/** Link in the queue, then in the done list of the pool. */
+	struct rlist link;
+	struct fiber *fiber;
+	ssize_t (*func)(va_list ap);
+	va_list ap;
+	ssize_t result;
+	int errorno;
+	bool complete;
+};
+
+static RLIST_HEAD(coio_pools);
+struct coio_pool *coio_system_pool;
+
+static void *
+coio_pool_thread_f(void *arg)
+{
+	struct coio_pool *pool = (struct coio_pool *) arg;
+	tt_pthread_mutex_lock(&pool->mutex);
+	while (true) {
+		while (rlist_empty(&pool->queue) && ! pool->is_stopped)
+			tt_pthread_cond_wait(&pool->cond, &pool->mutex);
+		if (pool->is_stopped)
+			break;
+		struct coio_pool_task *task =
+			rlist_shift_entry(&pool->queue,
+					  struct coio_pool_task, link);
+		tt_pthread_mutex_unlock(&pool->mutex);
+
+		task->result = task->func(task->ap);
+		task->errorno = errno;
+
+		tt_pthread_mutex_lock(&pool->done_mutex);
+		bool is_first = rlist_empty(&pool->done);
+		rlist_add_tail(&pool->done, &task->link);
+		tt_pthread_mutex_unlock(&pool->done_mutex);
+		/* The rest of the batch rides on the same event. */
+		if (is_first)
+			ev_async_send(coeio_manager.loop, &pool->done_event);
+
+		tt_pthread_mutex_lock(&pool->mutex);
+	}
+	tt_pthread_mutex_unlock(&pool->mutex);
+	return NULL;
+}
+
+static void
+coio_pool_done_cb(ev_loop * /* loop */, struct ev_async *w,
+		  int /* events */)
+{
+	struct coio_pool *pool = (struct coio_pool *) w->data;
+	RLIST_HEAD(done);
+	tt_pthread_mutex_lock(&pool->done_mutex);
+	rlist_swap(&done, &pool->done);
+	tt_pthread_mutex_unlock(&pool->done_mutex);
+	struct coio_pool_task *task;
+	rlist_foreach_entry(task, &done, link) {
+		task->complete = true;
+		fiber_wakeup(task->fiber);
+	}
+}
+
+struct coio_pool *
+coio_pool_new(const char *name, int threads)
+{
+	assert(threads > 0 && threads <= COIO_POOL_THREADS_MAX);
+	struct coio_pool *pool =
+		(struct coio_pool *) calloc(1, sizeof(*pool));
+	if (pool == NULL)
+		return NULL; /* errno = ENOMEM */
+	snprintf(pool->name, sizeof(pool->name), "%s", name);
+	pool->threads = threads;
+	tt_pthread_mutex_init(&pool->mutex, NULL);
+	tt_pthread_cond_init(&pool->cond, NULL);
+	rlist_create(&pool->queue);
+	tt_pthread_mutex_init(&pool->done_mutex, NULL);
+	rlist_create(&pool->done);
+	ev_async_init(&pool->done_event, coio_pool_done_cb);
+	pool->done_event.data = pool;
+	ev_async_start(coeio_manager.loop, &pool->done_event);
+	rlist_add_tail_entry(&coio_pools, pool, link);
+	return pool;
+}
+
+/** Start the threads of the pool, if not started yet. */
+static int
+coio_pool_start(struct coio_pool *pool)
+{
+	while (pool->started < pool->threads) {
+		if (tt_pthread_create(&pool->thread[pool->started], NULL,
+				      coio_pool_thread_f, pool) != 0) {
+			if (pool->started > 0)
+				break; /* Make do with fewer threads. */
+			errno = ENOMEM;
+			return -1;
+		}
+		pool->started++;
+	}
+	return 0;
+}
+
+void
+coio_pool_delete(struct coio_pool *pool)
+{
+	tt_pthread_mutex_lock(&pool->mutex);
+	pool->is_stopped = true;
+	pthread_cond_broadcast(&pool->cond);
+	tt_pthread_mutex_unlock(&pool->mutex);
+	for (int i = 0; i < pool->started; i++)
+		tt_pthread_join(pool->thread[i], NULL);
+	ev_async_stop(coeio_manager.loop, &pool->done_event);
+	tt_pthread_mutex_destroy(&pool->done_mutex);
+	tt_pthread_cond_destroy(&pool->cond);
+	tt_pthread_mutex_destroy(&pool->mutex);
+	rlist_del_entry(pool, link);
+	free(pool);
+}
+
+struct coio_pool *
+coio_pool_by_name(const char *name)
+{
+	struct coio_pool *pool;
+	rlist_foreach_entry(pool, &coio_pools, link) {
+		if (strcmp(pool->name, name) == 0)
+			return pool;
+	}
+	return NULL;
+}
+
+ssize_t
+coio_pool_call(struct coio_pool *pool, ssize_t (*func)(va_list ap), ...)
+{
+	if (coio_pool_start(pool) != 0)
+		return -1;
+
+	struct coio_pool_task task;
+	task.fiber = fiber();
+	task.func = func;
+	task.complete = false;
+
+	bool cancellable = fiber_set_cancellable(false);
+
+	va_start(task.ap, func);
+	tt_pthread_mutex_lock(&pool->mutex);
+	rlist_add_tail(&pool->queue, &task.link);
+	tt_pthread_cond_signal(&pool->cond);
+	tt_pthread_mutex_unlock(&pool->mutex);
+
+	while (! task.complete)
+		fiber_yield();
+	va_end(task.ap);
+
+	fiber_set_cancellable(cancellable);
+
+	errno = task.errorno;
+	return task.result;
+}
+
 /**
  * Init coeio subsystem.
  *
@@ -111,6 +292,10 @@ coeio_init(void)
 	ev_async_init(&coeio_manager.coeio_async, coeio_async_cb);
 
 	ev_async_start(loop(), &coeio_manager.coeio_async);
+
+	coio_system_pool = coio_pool_new("system", COIO_SYSTEM_POOL_THREADS);
+	if (coio_system_pool == NULL)
+		panic("failed to create the system coio pool");
 }
 
 /**
@@ -120,6 +305,20 @@ void
 coeio_reinit(void)
 {
 	eio_init(coeio_want_poll_cb, NULL);
+	/*
+	 * The threads of the pools don't survive fork, they
+	 * are started again on the next call. Calls in
+	 * progress are lost with the fibers of the parent.
+	 */
+	struct coio_pool *pool;
+	rlist_foreach_entry(pool, &coio_pools, link) {
+		pool->started = 0;
+		rlist_create(&pool->queue);
+		rlist_create(&pool->done);
+		tt_pthread_mutex_init(&pool->mutex, NULL);
+		tt_pthread_cond_init(&pool->cond, NULL);
+		tt_pthread_mutex_init(&pool->done_mutex, NULL);
+	}
 }
 
 static void
@@ -93,6 +93,56 @@ coio_getaddrinfo(const char *host, const char *port,
 		 double timeout);
 /** \endcond public */
 
+/**
+ * A named pool of threads for blocking calls, separate from
+ * libeio. A slow call in the libeio threads, such as a DNS
+ * lookup or a large file copy from Lua, doesn't delay calls
+ * of another pool, so file operations of checkpoints use a
+ * pool of their own, coio_system_pool.
+ *
+ * The threads are started on the first call. The threads put
+ * complete calls to a list and notify the tx loop only when
+ * the list was empty, so the loop wakes up once for a batch
+ * of calls.
+ */
+struct coio_pool;
+
+enum {
+	COIO_POOL_NAME_MAX = 32,
+	COIO_POOL_THREADS_MAX = 64,
+	/** The number of threads of coio_system_pool. */
+	COIO_SYSTEM_POOL_THREADS = 2,
+};
+
+/** The pool for file operations of checkpoints. */
+extern struct coio_pool *coio_system_pool;
+
+/**
+ * Create a pool with the given name and number of threads.
+ * @retval NULL and errno = ENOMEM if out of memory
+ */
+struct coio_pool *
+coio_pool_new(const char *name, int threads);
+
+/** Stop the threads of the pool and free it. */
+void
+coio_pool_delete(struct coio_pool *pool);
+
+/** Find a pool by name. */
+struct coio_pool *
+coio_pool_by_name(const char *name);
+
+/**
+ * Like coio_call(), but run the function in a thread of the
+ * pool. Not cancellable, errno set by the function is
+ * preserved.
+ *
+ * @retval -1 and errno = ENOMEM if failed to start the threads
+ * @retval the function return value
+ */
+ssize_t
+coio_pool_call(struct coio_pool *pool, ssize_t (*func)(va_list ap), ...);
+
 #if defined(__cplusplus)
 }
 #endif
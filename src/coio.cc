@@ -630,7 +630,8 @@ coio_service_on_accept(struct evio_service *evio_service,
 		f = fiber_new(fiber_name, service->handler);
 	} catch (Exception *e) {
 		e->log();
-		say_error("can't create a handler fiber, dropping client connection");
+		say_error_ratelimited("can't create a handler fiber, "
+				      "dropping client connection");
 		evio_close(loop(), &coio);
 		if (iobuf)
 			iobuf_delete(iobuf);
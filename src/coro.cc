@@ -31,30 +31,140 @@
 #include "trivia/config.h"
 #include "exception.h"
 #include <unistd.h>
+#include <errno.h>
 #include <string.h>
+#include <stdlib.h>
 #include <sys/mman.h>
 
 #include "third_party/valgrind/memcheck.h"
 #include "fiber.h"
 
+static inline size_t
+coro_page_size()
+{
+	static size_t page_size = 0;
+	if (page_size == 0)
+		page_size = sysconf(_SC_PAGESIZE);
+	return page_size;
+}
+
+static inline bool
+coro_stack_chunk_is_full(struct coro_stack_chunk *chunk)
+{
+	return chunk->carved == CORO_STACK_CHUNK && chunk->free_mask == 0;
+}
+
+/** Map a chunk for stacks of slot_size bytes with their guards. */
+static struct coro_stack_chunk *
+coro_stack_chunk_new(struct coro_stack_cache *cache, size_t slot_size)
+{
+	struct coro_stack_chunk *chunk = (struct coro_stack_chunk *)
+		malloc(sizeof(*chunk));
+	if (chunk == NULL) {
+		tnt_raise(OutOfMemory, sizeof(*chunk),
+			  "malloc", "coro stack chunk");
+	}
+	/*
+	 * Slots are carved and their guard pages are protected
+	 * on demand, the rest of the mapping costs nothing
+	 * until it is touched.
+	 */
+	size_t size = slot_size * CORO_STACK_CHUNK;
+	chunk->map = (char *) mmap(NULL, size, PROT_READ | PROT_WRITE,
+				   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (chunk->map == MAP_FAILED) {
+		free(chunk);
+		tnt_raise(OutOfMemory, size, "mmap", "coro stack chunk");
+	}
+	chunk->cache = cache;
+	chunk->slot_size = slot_size;
+	chunk->carved = 0;
+	chunk->free_mask = 0;
+	rlist_add_entry(&cache->chunks, chunk, link);
+	return chunk;
+}
+
+static void
+coro_stack_chunk_delete(struct coro_stack_chunk *chunk)
+{
+	rlist_del_entry(chunk, link);
+	munmap(chunk->map, chunk->slot_size * CORO_STACK_CHUNK);
+	free(chunk);
+}
+
+/**
+ * Take a slot of a stack with its guard page from the cache.
+ * @return the lowest address of the slot, the guard page.
+ */
+static char *
+coro_stack_alloc(struct coro_stack_cache *cache, size_t slot_size,
+		 struct coro_stack_chunk **chunk_ptr)
+{
+	const size_t page = coro_page_size();
+	struct coro_stack_chunk *chunk = NULL, *c;
+	rlist_foreach_entry(c, &cache->chunks, link) {
+		if (c->slot_size == slot_size) {
+			chunk = c;
+			break;
+		}
+	}
+	if (chunk == NULL)
+		chunk = coro_stack_chunk_new(cache, slot_size);
+	uint32_t slot;
+	if (chunk->free_mask != 0) {
+		slot = __builtin_ctz(chunk->free_mask);
+		chunk->free_mask &= ~(1U << slot);
+	} else {
+		slot = chunk->carved;
+		/* The stack grows down, the guard page is the lowest. */
+		if (mprotect(chunk->map + slot * slot_size, page,
+			     PROT_NONE) != 0) {
+			if (chunk->carved == 0)
+				coro_stack_chunk_delete(chunk);
+			tnt_raise(SystemError, "failed to protect coro stack");
+		}
+		chunk->carved++;
+	}
+	if (coro_stack_chunk_is_full(chunk))
+		rlist_del_entry(chunk, link);
+	*chunk_ptr = chunk;
+	return chunk->map + slot * slot_size;
+}
+
+/** Return a slot to its chunk and release its memory. */
+static void
+coro_stack_free(struct coro_stack_chunk *chunk, char *slot_ptr)
+{
+	const size_t page = coro_page_size();
+	uint32_t slot = (slot_ptr - chunk->map) / chunk->slot_size;
+	assert(slot < chunk->carved);
+	assert((chunk->free_mask & (1U << slot)) == 0);
+	if (coro_stack_chunk_is_full(chunk))
+		rlist_add_entry(&chunk->cache->chunks, chunk, link);
+	chunk->free_mask |= 1U << slot;
+	if (chunk->free_mask == (1U << chunk->carved) - 1) {
+		/* No stacks in use. */
+		coro_stack_chunk_delete(chunk);
+		return;
+	}
+	(void) madvise(slot_ptr + page, chunk->slot_size - page,
+		       MADV_DONTNEED);
+}
+
 void
 tarantool_coro_create(struct tarantool_coro *coro,
-		      struct slab_cache *slabc,
+		      struct coro_stack_cache *cache, size_t stack_size,
 		      void (*f) (void *), void *data)
 {
-	const int page = sysconf(_SC_PAGESIZE);
+	const size_t page = coro_page_size();
 
 	memset(coro, 0, sizeof(*coro));
 
-	/* TODO: guard pages */
-	coro->stack_size = page * 16 - slab_sizeof();
-	coro->stack = (char *) slab_get(slabc, coro->stack_size)
-					+ slab_sizeof();
-
-	if (coro->stack == NULL) {
-		tnt_raise(OutOfMemory, sizeof(coro->stack_size),
-			  "mmap", "coro stack");
-	}
+	stack_size = (stack_size + page - 1) & ~(page - 1);
+	char *slot = coro_stack_alloc(cache, stack_size + page,
+				      &coro->chunk);
+	coro->stack = slot + page;
+	coro->stack_size = stack_size;
 
 	(void) VALGRIND_STACK_REGISTER(coro->stack, (char *)
 				       coro->stack + coro->stack_size);
@@ -63,10 +173,22 @@ tarantool_coro_create(struct tarantool_coro *coro,
 }
 
 void
-tarantool_coro_destroy(struct tarantool_coro *coro, struct slab_cache *slabc)
+tarantool_coro_destroy(struct tarantool_coro *coro)
 {
 	if (coro->stack != NULL) {
-		slab_put(slabc, (struct slab *)
-			 ((char *) coro->stack - slab_sizeof()));
+		const size_t page = coro_page_size();
+		coro_stack_free(coro->chunk, (char *) coro->stack - page);
+		coro->stack = NULL;
 	}
 }
+
+void
+tarantool_coro_release(struct tarantool_coro *coro, size_t keep)
+{
+	if (coro->stack == NULL || keep >= coro->stack_size)
+		return;
+	const size_t page = coro_page_size();
+	size_t size = (coro->stack_size - keep) & ~(page - 1);
+	if (size > 0)
+		(void) madvise(coro->stack, size, MADV_DONTNEED);
+}
@@ -29,21 +29,89 @@
  * SUCH DAMAGE.
  */
 #include <stddef.h> /* size_t */
+#include <stdint.h>
 
 #include <third_party/coro/coro.h>
+#include "salad/rlist.h"
+
+enum {
+	/**
+	 * How many stacks are carved from one mapping, not
+	 * more than the bits in coro_stack_chunk::free_mask.
+	 */
+	CORO_STACK_CHUNK = 16,
+};
+
+/**
+ * A mapping for CORO_STACK_CHUNK stacks of the same size,
+ * each with a guard page right below it.
+ */
+struct coro_stack_chunk {
+	/** A link in coro_stack_cache::chunks. */
+	struct rlist link;
+	struct coro_stack_cache *cache;
+	char *map;
+	/** The size of a stack with its guard page. */
+	size_t slot_size;
+	/** The number of slots carved so far. */
+	uint32_t carved;
+	/** A bit per carved slot which is not in use. */
+	uint32_t free_mask;
+};
+
+/**
+ * Stacks of the coroutines of a thread. Chunks are mapped
+ * on demand and unmapped once all their stacks are
+ * destroyed.
+ */
+struct coro_stack_cache {
+	/** Chunks which have free or not yet carved slots. */
+	struct rlist chunks;
+};
+
+static inline void
+coro_stack_cache_create(struct coro_stack_cache *cache)
+{
+	rlist_create(&cache->chunks);
+}
 
 struct tarantool_coro {
 	coro_context ctx;
+	/**
+	 * The lowest address of the stack. The stack grows
+	 * down to it, and a guard page is mapped right below.
+	 */
 	void *stack;
 	size_t stack_size;
+	/** The chunk the stack is carved from. */
+	struct coro_stack_chunk *chunk;
 };
 
+/**
+ * Create a coroutine with a stack of stack_size bytes,
+ * rounded up to the page size, taken from the cache.
+ * A stack overflow hits the guard page and crashes the
+ * process instead of corrupting the neighbouring memory.
+ */
 void
 tarantool_coro_create(struct tarantool_coro *ctx,
-		      struct slab_cache *cache,
+		      struct coro_stack_cache *cache, size_t stack_size,
 		      void (*f) (void *), void *data);
+
+/**
+ * Return the stack to its chunk. Its memory is released
+ * right away, and the chunk is unmapped when it has no
+ * stacks in use.
+ */
+void
+tarantool_coro_destroy(struct tarantool_coro *ctx);
+
+/**
+ * Return the memory of the stack to the operating system,
+ * except for the top keep bytes, which the coroutine may still
+ * use. The released pages are zero-filled on the next access.
+ */
 void
-tarantool_coro_destroy(struct tarantool_coro *ctx,
-		       struct slab_cache *cache);
+tarantool_coro_release(struct tarantool_coro *ctx, size_t keep);
 
 #endif /* TARANTOOL_CORO_H_INCLUDED */
@@ -180,7 +180,12 @@ evio_service_accept_cb(ev_loop * /* loop */, ev_io *watcher,
 	} catch (Exception *e) {
 		if (fd >= 0)
 			close(fd);
-		e->log();
+		/*
+		 * E.g. EMFILE, which repeats for every
+		 * connection attempt until a descriptor
+		 * is freed.
+		 */
+		say_ratelimited_do(e->log());
 	}
 }
 
@@ -42,7 +42,9 @@ void *ffi_symbols[] = {
 	(void *) boxffi_index_count,
 	(void *) boxffi_index_iterator,
 	(void *) boxffi_tuple_update,
+	(void *) boxffi_tuple_is_packed,
 	(void *) boxffi_iterator_next,
+	(void *) boxffi_iterator_next_batch,
 	(void *) port_ffi_create,
 	(void *) port_ffi_destroy,
 	(void *) boxffi_select,
@@ -56,6 +58,7 @@ void *ffi_symbols[] = {
 	(void *) box_set_io_collect_interval,
 	(void *) box_set_snap_io_rate_limit,
 	(void *) box_set_too_long_threshold,
+	(void *) box_set_loop_stall_threshold,
 	(void *) bsdsocket_local_resolve,
 	(void *) bsdsocket_nonblock,
 	(void *) base64_decode,
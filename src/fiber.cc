@@ -31,6 +31,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "say.h"
 #include "assoc.h"
@@ -38,7 +39,18 @@
 #include "trigger.h"
 #include <typeinfo>
 
+/** The resolution of the timer wheel, in seconds. */
+static const ev_tstamp TIMER_WHEEL_TICK = 0.01;
+/**
+ * Timeouts of at least this many seconds go to the timer
+ * wheel, where they may fire up to a tick late; shorter
+ * ones are served by the libev timer heap.
+ */
+static const ev_tstamp TIMER_WHEEL_DELAY_MIN = 1.0;
+
 static struct cord main_cord;
+/** The stack size of new fibers, @sa fiber_set_stack_size(). */
+static size_t fiber_stack_size = FIBER_STACK_SIZE_DEFAULT;
 __thread struct cord *cord_ptr = NULL;
 pthread_t main_thread_id;
 
@@ -53,6 +65,99 @@ update_last_stack_frame(struct fiber *fiber)
 
 }
 
+/**
+ * A cheap monotonic clock to account the time of fibers:
+ * the time stamp counter on x86, nanoseconds elsewhere.
+ */
+static inline uint64_t
+clock_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __builtin_ia32_rdtsc();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+static double
+clock_monotonic(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * The rate of clock_ticks() is measured against the monotonic
+ * clock since fiber_init(), and gets more precise over time.
+ */
+static uint64_t clock_start_ticks;
+static double clock_start_time;
+
+double
+fiber_ticks_to_sec(uint64_t ticks)
+{
+	uint64_t elapsed_ticks = clock_ticks() - clock_start_ticks;
+	if (elapsed_ticks == 0)
+		return 0;
+	return ticks * (clock_monotonic() - clock_start_time) /
+		elapsed_ticks;
+}
+
+/**
+ * Charge the fiber which is giving away the CPU for the time
+ * since the previous switch.
+ */
+static inline void
+fiber_account(struct cord *cord, struct fiber *fiber)
+{
+	uint64_t now = clock_ticks();
+	uint64_t slice = now - cord->switch_ticks;
+	cord->switch_ticks = now;
+	fiber->cpu_ticks += slice;
+	if (slice > cord->slice_max) {
+		cord->slice_max = slice;
+		cord->slice_fiber = fiber;
+		cord->slice_fid = fiber->fid;
+	}
+}
+
+double
+fiber_cpu_time(struct fiber *fiber)
+{
+	uint64_t ticks = fiber->cpu_ticks;
+	if (fiber == fiber())
+		ticks += clock_ticks() - cord()->switch_ticks;
+	return fiber_ticks_to_sec(ticks);
+}
+
+/**
+ * The event loop is about to poll: the time until the loop
+ * wakes up is not charged to any fiber.
+ */
+static void
+cord_prepare_cb(ev_loop * /* loop */, ev_prepare *watcher,
+		int /* revents */)
+{
+	struct cord *cord = (struct cord *) watcher->data;
+	fiber_account(cord, &cord->sched);
+	if (cord->loop_seq % 2 == 1)
+		__atomic_add_fetch(&cord->loop_seq, 1, __ATOMIC_RELAXED);
+}
+
+static void
+cord_check_cb(ev_loop * /* loop */, ev_check *watcher,
+	      int /* revents */)
+{
+	struct cord *cord = (struct cord *) watcher->data;
+	cord->switch_ticks = cord->loop_ticks = clock_ticks();
+	cord->slice_max = 0;
+	cord->slice_fiber = NULL;
+	__atomic_add_fetch(&cord->loop_seq, 1, __ATOMIC_RELAXED);
+}
+
 static void
 fiber_recycle(struct fiber *fiber);
 
@@ -70,6 +175,7 @@ fiber_call(struct fiber *callee)
 	callee->caller = caller;
 
 	update_last_stack_frame(caller);
+	fiber_account(cord, caller);
 
 	callee->csw++;
 	coro_transfer(&caller->coro.ctx, &callee->coro.ctx);
@@ -247,6 +353,7 @@ fiber_yield(void)
 
 	cord->fiber = callee;
 	update_last_stack_frame(caller);
+	fiber_account(cord, caller);
 
 	callee->csw++;
 	coro_transfer(&caller->coro.ctx, &callee->coro.ctx);
@@ -270,6 +377,179 @@ fiber_schedule_timeout(ev_loop * /* loop */,
 	fiber_call(state->f);
 }
 
+/** A timer of the timer wheel, lives on the stack of a fiber. */
+struct wheel_timer {
+	/** Link in a slot of the wheel. */
+	struct rlist link;
+	/** The tick at which the timer fires. */
+	uint64_t expires;
+	struct fiber_watcher_data state;
+};
+
+static inline uint64_t
+timer_wheel_tick(ev_tstamp t)
+{
+	return (uint64_t) (t / TIMER_WHEEL_TICK);
+}
+
+/** Put a timer to the slot its expiration tick belongs to. */
+static void
+timer_wheel_insert(struct timer_wheel *wheel, struct wheel_timer *timer)
+{
+	uint64_t expires = timer->expires;
+	uint64_t delta = expires > wheel->tick ? expires - wheel->tick : 0;
+	if (delta == 0) {
+		/* Already expired: fire on the next tick processed. */
+		rlist_add_tail(&wheel->slots[0][wheel->tick %
+			       TIMER_WHEEL_SLOTS], &timer->link);
+		return;
+	}
+	int level = 0;
+	while (level < TIMER_WHEEL_LEVELS - 1 &&
+	       delta >> (TIMER_WHEEL_BITS * (level + 1)) != 0)
+		level++;
+	const uint64_t delta_max =
+		(1ULL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1;
+	if (delta > delta_max) {
+		/*
+		 * Beyond the range of the wheel. The timer is
+		 * re-inserted with its true expiration tick when
+		 * the slot comes up.
+		 */
+		expires = wheel->tick + delta_max;
+	}
+	uint64_t slot = (expires >> (TIMER_WHEEL_BITS * level)) %
+		TIMER_WHEEL_SLOTS;
+	rlist_add_tail(&wheel->slots[level][slot], &timer->link);
+}
+
+/**
+ * Move the timers of a slot of a higher level down the wheel.
+ * @return the slot number.
+ */
+static uint64_t
+timer_wheel_cascade(struct timer_wheel *wheel, int level)
+{
+	uint64_t slot = (wheel->tick >> (TIMER_WHEEL_BITS * level)) %
+		TIMER_WHEEL_SLOTS;
+	RLIST_HEAD(timers);
+	rlist_swap(&timers, &wheel->slots[level][slot]);
+	while (! rlist_empty(&timers)) {
+		struct wheel_timer *timer =
+			rlist_shift_entry(&timers, struct wheel_timer, link);
+		timer_wheel_insert(wheel, timer);
+	}
+	return slot;
+}
+
+/**
+ * Find the first tick from wheel->tick on which has timers
+ * to fire or to cascade, so that the wheel doesn't step
+ * through empty slots one by one after a long stall.
+ * May return an earlier tick, but never a later one.
+ */
+static uint64_t
+timer_wheel_next_tick(struct timer_wheel *wheel)
+{
+	uint64_t next = wheel->tick;
+	for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+		/*
+		 * The lower levels are empty. A slot of this
+		 * level is processed at a multiple of its span,
+		 * find the first one from wheel->tick on.
+		 */
+		int shift = TIMER_WHEEL_BITS * level;
+		uint64_t span = 1ULL << shift;
+		uint64_t tick = (wheel->tick + span - 1) & ~(span - 1);
+		uint64_t pos = (tick >> shift) % TIMER_WHEEL_SLOTS;
+		uint64_t base = tick - (pos << shift);
+		for (uint64_t slot = pos; slot < TIMER_WHEEL_SLOTS; slot++) {
+			if (! rlist_empty(&wheel->slots[level][slot]))
+				return base + (slot << shift);
+		}
+		/* The rest of the slots is for the next revolution. */
+		next = base + ((uint64_t) TIMER_WHEEL_SLOTS << shift);
+		for (uint64_t slot = 0; slot < pos; slot++) {
+			if (! rlist_empty(&wheel->slots[level][slot]))
+				return next;
+		}
+	}
+	return next;
+}
+
+static void
+timer_wheel_cb(ev_loop *loop, ev_timer *watcher, int /* revents */)
+{
+	assert(fiber() == &cord()->sched);
+	struct timer_wheel *wheel = (struct timer_wheel *) watcher->data;
+	uint64_t now = timer_wheel_tick(clock_monotonic());
+	while (wheel->count > 0) {
+		uint64_t next = timer_wheel_next_tick(wheel);
+		if (next > now)
+			break;
+		wheel->tick = next;
+		uint64_t slot = wheel->tick % TIMER_WHEEL_SLOTS;
+		for (int level = 1; slot == 0 && level < TIMER_WHEEL_LEVELS;
+		     level++)
+			slot = timer_wheel_cascade(wheel, level);
+		RLIST_HEAD(expired);
+		rlist_swap(&expired,
+			   &wheel->slots[0][wheel->tick % TIMER_WHEEL_SLOTS]);
+		/* Timers armed by the woken fibers go to later slots. */
+		wheel->tick++;
+		while (! rlist_empty(&expired)) {
+			struct wheel_timer *timer =
+				rlist_shift_entry(&expired, struct wheel_timer,
+						  link);
+			timer->state.timed_out = true;
+			/* The fiber disarms the timer before it yields. */
+			fiber_call(timer->state.f);
+		}
+	}
+	if (wheel->count == 0)
+		ev_timer_stop(loop, watcher);
+}
+
+static void
+timer_wheel_create(struct timer_wheel *wheel)
+{
+	wheel->tick = 0;
+	wheel->count = 0;
+	ev_timer_init(&wheel->timer, timer_wheel_cb,
+		      TIMER_WHEEL_TICK, TIMER_WHEEL_TICK);
+	wheel->timer.data = wheel;
+	for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+		for (int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++)
+			rlist_create(&wheel->slots[level][slot]);
+	}
+}
+
+static void
+timer_wheel_arm(struct timer_wheel *wheel, struct wheel_timer *timer,
+		ev_tstamp delay)
+{
+	/*
+	 * The wheel counts ticks of the monotonic clock, a step
+	 * of the wall clock must not fire or delay its timers.
+	 */
+	ev_tstamp now = clock_monotonic();
+	if (wheel->count++ == 0) {
+		/* An empty wheel may be behind the clock. */
+		wheel->tick = timer_wheel_tick(now);
+		ev_timer_again(loop(), &wheel->timer);
+	}
+	/* Round up, so that the timer never fires early. */
+	timer->expires = timer_wheel_tick(now + delay) + 1;
+	timer_wheel_insert(wheel, timer);
+}
+
+static inline void
+timer_wheel_disarm(struct timer_wheel *wheel, struct wheel_timer *timer)
+{
+	rlist_del(&timer->link);
+	wheel->count--;
+}
+
 /**
  * @brief yield & check timeout
  * @return true if timeout exceeded
@@ -277,6 +557,24 @@ fiber_schedule_timeout(ev_loop * /* loop */,
 bool
 fiber_yield_timeout(ev_tstamp delay)
 {
+	if (delay >= TIMEOUT_INFINITY) {
+		fiber_yield();
+		return false;
+	}
+	if (delay >= TIMER_WHEEL_DELAY_MIN) {
+		/*
+		 * A coarse timeout, which usually doesn't fire:
+		 * avoid the heap maintenance of an ev_timer.
+		 */
+		struct timer_wheel *wheel = &cord()->wheel;
+		struct wheel_timer timer;
+		timer.state.f = fiber();
+		timer.state.timed_out = false;
+		timer_wheel_arm(wheel, &timer, delay);
+		fiber_yield();
+		timer_wheel_disarm(wheel, &timer);
+		return timer.state.timed_out;
+	}
 	struct ev_timer timer;
 	ev_timer_init(&timer, fiber_schedule_timeout, delay, 0);
 	struct fiber_watcher_data state = { fiber(), false };
@@ -359,6 +657,7 @@ unregister_fid(struct fiber *fiber)
 void
 fiber_gc(void)
 {
+	fiber()->gc_peak = fiber_gc_peak(fiber());
 	if (region_used(&fiber()->gc) < 128 * 1024) {
 		region_reset(&fiber()->gc);
 		return;
@@ -374,6 +673,8 @@ fiber_reset(struct fiber *fiber)
 	rlist_create(&fiber->on_yield);
 	rlist_create(&fiber->on_stop);
 	fiber->flags = FIBER_DEFAULT_FLAGS;
+	fiber->cpu_ticks = 0;
+	fiber->gc_peak = 0;
 }
 
 /** Destroy an active fiber and prepare it for reuse. */
@@ -388,7 +689,21 @@ fiber_recycle(struct fiber *fiber)
 	unregister_fid(fiber);
 	fiber->fid = 0;
 	region_free(&fiber->gc);
-	rlist_move_entry(&cord()->dead, fiber, link);
+	struct cord *cord = cord();
+	if (cord->warm_count < FIBER_POOL_WARM) {
+		rlist_move_entry(&cord->dead, fiber, link);
+		cord->warm_count++;
+	} else {
+		/*
+		 * Too many idle fibers, e.g. after a connection
+		 * storm: don't pin the memory of their stacks.
+		 * Sic: this can be called on the stack of the fiber
+		 * itself, but from a shallow frame.
+		 */
+		tarantool_coro_release(&fiber->coro, FIBER_STACK_WARM);
+		rlist_move_tail_entry(&cord->dead, fiber, link);
+	}
+	cord->dead_count++;
 }
 
 static void
@@ -471,12 +786,23 @@ fiber_new(const char *name, void (*f) (va_list))
 	if (! rlist_empty(&cord->dead)) {
 		fiber = rlist_first_entry(&cord->dead,
 					  struct fiber, link);
+		if (fiber->coro.stack_size != fiber_stack_size) {
+			/* The stack size has been changed. */
+			tarantool_coro_destroy(&fiber->coro);
+			tarantool_coro_create(&fiber->coro, &cord->stacks,
+					      fiber_stack_size, fiber_loop,
+					      NULL);
+		}
 		rlist_move_entry(&cord->alive, fiber, link);
+		cord->dead_count--;
+		/* Warm fibers are at the head of the list. */
+		if (cord->warm_count > 0)
+			cord->warm_count--;
 	} else {
 		fiber = (struct fiber *) mempool_alloc0(&cord->fiber_pool);
 
-		tarantool_coro_create(&fiber->coro, &cord->slabc,
-				      fiber_loop, NULL);
+		tarantool_coro_create(&fiber->coro, &cord->stacks,
+				      fiber_stack_size, fiber_loop, NULL);
 
 		region_create(&fiber->gc, &cord->slabc);
 
@@ -498,6 +824,14 @@ fiber_new(const char *name, void (*f) (va_list))
 	return fiber;
 }
 
+void
+fiber_set_stack_size(size_t size)
+{
+	assert(size >= FIBER_STACK_SIZE_MIN);
+	const size_t page = sysconf(_SC_PAGESIZE);
+	fiber_stack_size = (size + page - 1) & ~(page - 1);
+}
+
 /**
  * Free as much memory as possible taken by the fiber.
  *
@@ -518,7 +852,7 @@ fiber_destroy(struct cord *cord, struct fiber *f)
 	trigger_destroy(&f->on_stop);
 	rlist_del(&f->state);
 	region_destroy(&f->gc);
-	tarantool_coro_destroy(&f->coro, &cord->slabc);
+	tarantool_coro_destroy(&f->coro);
 	Exception::clear(&f->exception);
 }
 
@@ -544,6 +878,9 @@ cord_create(struct cord *cord, const char *name)
 	rlist_create(&cord->alive);
 	rlist_create(&cord->ready);
 	rlist_create(&cord->dead);
+	cord->dead_count = 0;
+	cord->warm_count = 0;
+	coro_stack_cache_create(&cord->stacks);
 	cord->fiber_registry = mh_i32ptr_new();
 
 	/* sched fiber is not present in alive/ready/dead list. */
@@ -559,6 +896,25 @@ cord_create(struct cord *cord, const char *name)
 
 	ev_async_init(&cord->wakeup_event, fiber_schedule_wakeup);
 	ev_async_start(cord->loop, &cord->wakeup_event);
+	timer_wheel_create(&cord->wheel);
+
+	/* The cord is running till the loop polls. */
+	cord->loop_seq = 1;
+	cord->switch_ticks = cord->loop_ticks = clock_ticks();
+	cord->slice_max = 0;
+	cord->slice_fiber = NULL;
+	ev_prepare_init(&cord->prepare_event, cord_prepare_cb);
+	cord->prepare_event.data = cord;
+	/* Runs before the prepare watchers of other modules. */
+	ev_set_priority(&cord->prepare_event, EV_MAXPRI);
+	ev_prepare_start(cord->loop, &cord->prepare_event);
+	ev_check_init(&cord->check_event, cord_check_cb);
+	cord->check_event.data = cord;
+	ev_set_priority(&cord->check_event, EV_MAXPRI);
+	ev_check_start(cord->loop, &cord->check_event);
+	/* Accounting alone doesn't keep the loop running. */
+	ev_unref(cord->loop);
+	ev_unref(cord->loop);
 	snprintf(cord->name, sizeof(cord->name), "%s", name);
 }
 
@@ -567,6 +923,11 @@ cord_destroy(struct cord *cord)
 {
 	slab_cache_set_thread(&cord->slabc);
 	ev_async_stop(cord->loop, &cord->wakeup_event);
+	ev_timer_stop(cord->loop, &cord->wheel.timer);
+	ev_ref(cord->loop);
+	ev_ref(cord->loop);
+	ev_prepare_stop(cord->loop, &cord->prepare_event);
+	ev_check_stop(cord->loop, &cord->check_event);
 	/* Only clean up if initialized. */
 	if (cord->fiber_registry) {
 		fiber_destroy_all(cord);
@@ -732,6 +1093,8 @@ void
 fiber_init(void)
 {
 	main_thread_id = pthread_self();
+	clock_start_ticks = clock_ticks();
+	clock_start_time = clock_monotonic();
 	cord() = &main_cord;
 	cord_create(cord(), "main");
 }
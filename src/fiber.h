@@ -129,6 +129,10 @@ struct fiber {
 	struct fiber *caller;
 	/** Number of context switches. */
 	int csw;
+	/** The time the fiber has been running, in clock ticks. */
+	uint64_t cpu_ticks;
+	/** The peak memory usage of the fiber region. */
+	size_t gc_peak;
 	/** Fiber id. */
 	uint32_t fid;
 	/** Fiber flags */
@@ -163,6 +167,48 @@ struct fiber {
 
 enum { FIBER_CALL_STACK = 16 };
 
+enum {
+	/** The default size of a fiber stack. */
+	FIBER_STACK_SIZE_DEFAULT = 65536,
+	FIBER_STACK_SIZE_MIN = 16384,
+	/**
+	 * How many top bytes of the stack of a dead fiber are
+	 * kept in memory, if the fiber is not in the warm pool.
+	 */
+	FIBER_STACK_WARM = 16384,
+	/**
+	 * How many dead fibers of a cord keep their stacks
+	 * intact for reuse.
+	 */
+	FIBER_POOL_WARM = 128,
+};
+
+enum {
+	/** log2 of the number of slots on a level of a timer wheel. */
+	TIMER_WHEEL_BITS = 6,
+	TIMER_WHEEL_SLOTS = 1 << TIMER_WHEEL_BITS,
+	TIMER_WHEEL_LEVELS = 4,
+};
+
+/**
+ * A hierarchical timer wheel for coarse fiber timeouts.
+ * Level 0 has a slot per tick, every next level has a slot
+ * per whole revolution of the previous one. Timers of a
+ * higher level are moved down a level when their slot comes
+ * up. Arming and disarming a timer are O(1), and all timers
+ * of a cord are driven by a single libev timer, which runs
+ * only while there are armed timers.
+ */
+struct timer_wheel {
+	/** The next tick of the monotonic clock to process. */
+	uint64_t tick;
+	/** The number of armed timers. */
+	uint32_t count;
+	/** Ticks the wheel. */
+	struct ev_timer timer;
+	struct rlist slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+};
+
 /**
  * @brief An independent execution unit that can be managed by a separate OS
  * thread. Each cord consists of fibers to implement cooperative multitasking
@@ -186,8 +232,22 @@ struct cord {
 	struct rlist alive;
 	/** Fibers, ready for execution */
 	struct rlist ready;
-	/** A cache of dead fibers for reuse */
+	/**
+	 * A cache of dead fibers for reuse. The first
+	 * warm_count of them have warm stacks, the rest
+	 * only keep FIBER_STACK_WARM top bytes of the
+	 * stack in memory.
+	 */
 	struct rlist dead;
+	/** The number of fibers in the dead list. */
+	uint32_t dead_count;
+	/**
+	 * The number of fibers with warm stacks in the dead
+	 * list, not more than FIBER_POOL_WARM.
+	 */
+	uint32_t warm_count;
+	/** Stacks of the fibers of this cord. */
+	struct coro_stack_cache stacks;
 	/** A watcher to have a single async event for all ready fibers.
 	 * This technique is necessary to be able to suspend
 	 * a single fiber on a few watchers (for example,
@@ -195,6 +255,28 @@ struct cord {
 	 * first).
 	 * */
 	ev_async wakeup_event;
+	/** Coarse timeouts of fibers of this cord. */
+	struct timer_wheel wheel;
+	/** Clock ticks when the current fiber got the CPU. */
+	uint64_t switch_ticks;
+	/**
+	 * Odd while the event loop runs callbacks and fibers,
+	 * even while it polls for events. Read by the stall
+	 * watchdog from another thread.
+	 */
+	uint32_t loop_seq;
+	/** Clock ticks when the current loop iteration began. */
+	uint64_t loop_ticks;
+	/**
+	 * The longest time a fiber held the CPU in the current
+	 * loop iteration, and the fiber.
+	 */
+	uint64_t slice_max;
+	struct fiber *slice_fiber;
+	uint32_t slice_fid;
+	/** Account the time of loop iterations. */
+	ev_prepare prepare_event;
+	ev_check check_event;
 	/** A memory cache for (struct fiber) */
 	struct mempool fiber_pool;
 	/** A runtime slab cache for general use in this cord. */
@@ -267,6 +349,14 @@ void fiber_free(void);
 struct fiber *
 fiber_new(const char *name, fiber_func f);
 
+/**
+ * Set the stack size of new fibers. Fibers which already have
+ * a stack of another size are not affected, dead fibers get
+ * a new stack on reuse.
+ */
+void
+fiber_set_stack_size(size_t size);
+
 void
 fiber_set_name(struct fiber *fiber, const char *name);
 
@@ -276,6 +366,22 @@ fiber_name(struct fiber *f)
 	return region_name(&f->gc);
 }
 
+/** The time the fiber has been running, in seconds. */
+double
+fiber_cpu_time(struct fiber *fiber);
+
+/** Convert a time in clock ticks of the fiber accounting to seconds. */
+double
+fiber_ticks_to_sec(uint64_t ticks);
+
+/** The peak memory usage of the fiber region, in bytes. */
+static inline size_t
+fiber_gc_peak(struct fiber *fiber)
+{
+	size_t used = region_used(&fiber->gc);
+	return used > fiber->gc_peak ? used : fiber->gc_peak;
+}
+
 bool
 fiber_checkstack();
 
@@ -29,6 +29,7 @@
 #include "ipc.h"
 #include "fiber.h"
 #include <stdlib.h>
+#include <string.h>
 
 struct ipc_channel *
 ipc_channel_new(unsigned size)
@@ -343,3 +344,348 @@ ipc_channel_broadcast(struct ipc_channel *ch, void *data)
 
 	return cnt;
 }
+
+/************** latches, rwlocks, conditions, semaphores *************/
+
+/** A fiber waiting for a primitive, lives on the fiber stack. */
+struct ipc_waiter {
+	/** Link in the queue of the primitive. */
+	struct rlist link;
+	struct fiber *fiber;
+	/** For rwlocks: waits for reading. */
+	bool is_reader;
+	/** Set by the fiber which has handed over the primitive. */
+	bool is_granted;
+};
+
+/**
+ * Wait in the queue till the primitive is handed over to the
+ * fiber. On timeout or cancellation, leave the queue and return
+ * -1: the caller must fix up the primitive state, if a waiter
+ * leaving may let others through, and call fiber_testcancel().
+ */
+static int
+ipc_wait(struct rlist *queue, struct ipc_waiter *waiter,
+	 ev_tstamp timeout, struct ipc_stat *stat)
+{
+	ev_tstamp deadline = ev_now(loop()) + timeout;
+	waiter->fiber = fiber();
+	waiter->is_granted = false;
+	rlist_add_tail(queue, &waiter->link);
+	stat->waited++;
+	while (timeout > 0) {
+		fiber_yield_timeout(timeout);
+		if (waiter->is_granted)
+			return 0;
+		if (fiber_is_cancelled() &&
+		    (fiber()->flags & FIBER_IS_CANCELLABLE))
+			break;
+		/* A spurious wakeup, or the deadline. */
+		timeout = deadline - ev_now(loop());
+	}
+	rlist_del(&waiter->link);
+	stat->timedout++;
+	errno = ETIMEDOUT;
+	return -1;
+}
+
+/** Hand over the primitive to the first waiter. */
+static struct ipc_waiter *
+ipc_wakeup_first(struct rlist *queue)
+{
+	struct ipc_waiter *waiter =
+		rlist_shift_entry(queue, struct ipc_waiter, link);
+	waiter->is_granted = true;
+	fiber_wakeup(waiter->fiber);
+	return waiter;
+}
+
+void
+ipc_latch_create(struct ipc_latch *latch)
+{
+	latch->owner = NULL;
+	rlist_create(&latch->queue);
+	memset(&latch->stat, 0, sizeof(latch->stat));
+}
+
+void
+ipc_latch_destroy(struct ipc_latch *latch)
+{
+	assert(rlist_empty(&latch->queue));
+	(void) latch;
+}
+
+bool
+ipc_latch_trylock(struct ipc_latch *latch)
+{
+	if (latch->owner != NULL)
+		return false;
+	assert(rlist_empty(&latch->queue));
+	latch->owner = fiber();
+	latch->stat.acquired++;
+	return true;
+}
+
+int
+ipc_latch_lock_timeout(struct ipc_latch *latch, ev_tstamp timeout)
+{
+	assert(latch->owner != fiber());
+	if (ipc_latch_trylock(latch))
+		return 0;
+	struct ipc_waiter waiter;
+	if (ipc_wait(&latch->queue, &waiter, timeout, &latch->stat) != 0) {
+		fiber_testcancel();
+		return -1;
+	}
+	assert(latch->owner == fiber());
+	return 0;
+}
+
+void
+ipc_latch_lock(struct ipc_latch *latch)
+{
+	(void) ipc_latch_lock_timeout(latch, TIMEOUT_INFINITY);
+}
+
+void
+ipc_latch_unlock(struct ipc_latch *latch)
+{
+	assert(latch->owner == fiber());
+	if (rlist_empty(&latch->queue)) {
+		latch->owner = NULL;
+		return;
+	}
+	latch->owner = ipc_wakeup_first(&latch->queue)->fiber;
+	latch->stat.acquired++;
+}
+
+void
+ipc_rwlock_create(struct ipc_rwlock *rwlock)
+{
+	rwlock->writer = NULL;
+	rwlock->readers = 0;
+	rlist_create(&rwlock->queue);
+	memset(&rwlock->stat, 0, sizeof(rwlock->stat));
+}
+
+void
+ipc_rwlock_destroy(struct ipc_rwlock *rwlock)
+{
+	assert(rlist_empty(&rwlock->queue));
+	(void) rwlock;
+}
+
+/**
+ * Hand over the lock to the waiters at the head of the queue
+ * which can have it: a writer, if the lock is free, or all
+ * readers up to the first writer.
+ */
+static void
+ipc_rwlock_grant(struct ipc_rwlock *rwlock)
+{
+	while (rwlock->writer == NULL && ! rlist_empty(&rwlock->queue)) {
+		struct ipc_waiter *waiter =
+			rlist_first_entry(&rwlock->queue,
+					  struct ipc_waiter, link);
+		if (waiter->is_reader) {
+			ipc_wakeup_first(&rwlock->queue);
+			rwlock->readers++;
+		} else if (rwlock->readers == 0) {
+			ipc_wakeup_first(&rwlock->queue);
+			rwlock->writer = waiter->fiber;
+		} else {
+			break;
+		}
+		rwlock->stat.acquired++;
+	}
+}
+
+bool
+ipc_rwlock_tryrdlock(struct ipc_rwlock *rwlock)
+{
+	if (rwlock->writer != NULL || ! rlist_empty(&rwlock->queue))
+		return false;
+	rwlock->readers++;
+	rwlock->stat.acquired++;
+	return true;
+}
+
+bool
+ipc_rwlock_trywrlock(struct ipc_rwlock *rwlock)
+{
+	if (rwlock->writer != NULL || rwlock->readers > 0)
+		return false;
+	assert(rlist_empty(&rwlock->queue));
+	rwlock->writer = fiber();
+	rwlock->stat.acquired++;
+	return true;
+}
+
+static int
+ipc_rwlock_lock_timeout(struct ipc_rwlock *rwlock, bool is_reader,
+			ev_tstamp timeout)
+{
+	struct ipc_waiter waiter;
+	waiter.is_reader = is_reader;
+	if (ipc_wait(&rwlock->queue, &waiter, timeout,
+		     &rwlock->stat) != 0) {
+		/* A writer leaving the head lets readers through. */
+		ipc_rwlock_grant(rwlock);
+		fiber_testcancel();
+		return -1;
+	}
+	return 0;
+}
+
+int
+ipc_rwlock_rdlock_timeout(struct ipc_rwlock *rwlock, ev_tstamp timeout)
+{
+	if (ipc_rwlock_tryrdlock(rwlock))
+		return 0;
+	return ipc_rwlock_lock_timeout(rwlock, true, timeout);
+}
+
+int
+ipc_rwlock_wrlock_timeout(struct ipc_rwlock *rwlock, ev_tstamp timeout)
+{
+	assert(rwlock->writer != fiber());
+	if (ipc_rwlock_trywrlock(rwlock))
+		return 0;
+	return ipc_rwlock_lock_timeout(rwlock, false, timeout);
+}
+
+void
+ipc_rwlock_rdlock(struct ipc_rwlock *rwlock)
+{
+	(void) ipc_rwlock_rdlock_timeout(rwlock, TIMEOUT_INFINITY);
+}
+
+void
+ipc_rwlock_wrlock(struct ipc_rwlock *rwlock)
+{
+	(void) ipc_rwlock_wrlock_timeout(rwlock, TIMEOUT_INFINITY);
+}
+
+void
+ipc_rwlock_unlock(struct ipc_rwlock *rwlock)
+{
+	if (rwlock->writer != NULL) {
+		assert(rwlock->writer == fiber());
+		rwlock->writer = NULL;
+	} else {
+		assert(rwlock->readers > 0);
+		rwlock->readers--;
+	}
+	ipc_rwlock_grant(rwlock);
+}
+
+void
+ipc_cond_create(struct ipc_cond *cond)
+{
+	rlist_create(&cond->queue);
+	memset(&cond->stat, 0, sizeof(cond->stat));
+}
+
+void
+ipc_cond_destroy(struct ipc_cond *cond)
+{
+	assert(rlist_empty(&cond->queue));
+	(void) cond;
+}
+
+int
+ipc_cond_wait_timeout(struct ipc_cond *cond, struct ipc_latch *latch,
+		      ev_tstamp timeout)
+{
+	if (latch != NULL)
+		ipc_latch_unlock(latch);
+	struct ipc_waiter waiter;
+	int rc = ipc_wait(&cond->queue, &waiter, timeout, &cond->stat);
+	if (rc == 0)
+		cond->stat.acquired++;
+	if (latch != NULL) {
+		/* Not cancellable, the latch must be held on return. */
+		bool cancellable = fiber_set_cancellable(false);
+		ipc_latch_lock(latch);
+		fiber_set_cancellable(cancellable);
+	}
+	if (rc != 0)
+		fiber_testcancel();
+	return rc;
+}
+
+void
+ipc_cond_wait(struct ipc_cond *cond, struct ipc_latch *latch)
+{
+	(void) ipc_cond_wait_timeout(cond, latch, TIMEOUT_INFINITY);
+}
+
+void
+ipc_cond_signal(struct ipc_cond *cond)
+{
+	if (! rlist_empty(&cond->queue))
+		ipc_wakeup_first(&cond->queue);
+}
+
+void
+ipc_cond_broadcast(struct ipc_cond *cond)
+{
+	while (! rlist_empty(&cond->queue))
+		ipc_wakeup_first(&cond->queue);
+}
+
+void
+ipc_sem_create(struct ipc_sem *sem, unsigned count)
+{
+	sem->count = count;
+	rlist_create(&sem->queue);
+	memset(&sem->stat, 0, sizeof(sem->stat));
+}
+
+void
+ipc_sem_destroy(struct ipc_sem *sem)
+{
+	assert(rlist_empty(&sem->queue));
+	(void) sem;
+}
+
+bool
+ipc_sem_tryacquire(struct ipc_sem *sem)
+{
+	if (sem->count == 0)
+		return false;
+	assert(rlist_empty(&sem->queue));
+	sem->count--;
+	sem->stat.acquired++;
+	return true;
+}
+
+int
+ipc_sem_acquire_timeout(struct ipc_sem *sem, ev_tstamp timeout)
+{
+	if (ipc_sem_tryacquire(sem))
+		return 0;
+	struct ipc_waiter waiter;
+	if (ipc_wait(&sem->queue, &waiter, timeout, &sem->stat) != 0) {
+		fiber_testcancel();
+		return -1;
+	}
+	return 0;
+}
+
+void
+ipc_sem_acquire(struct ipc_sem *sem)
+{
+	(void) ipc_sem_acquire_timeout(sem, TIMEOUT_INFINITY);
+}
+
+void
+ipc_sem_release(struct ipc_sem *sem)
+{
+	if (rlist_empty(&sem->queue)) {
+		sem->count++;
+		return;
+	}
+	ipc_wakeup_first(&sem->queue);
+	sem->stat.acquired++;
+}
@@ -29,6 +29,7 @@
  * SUCH DAMAGE.
  */
 #include <stdbool.h>
+#include <stdint.h>
 #include <tarantool_ev.h>
 #include "salad/rlist.h"
 
@@ -261,4 +262,201 @@ ipc_channel_is_closed(struct ipc_channel *ch)
 	return ch->closed;
 }
 
+/**
+ * @brief LATCHES, READ-WRITE LOCKS, CONDITIONS AND SEMAPHORES
+ *
+ * Fiber-level synchronization primitives. Waiters are queued
+ * and woken up in FIFO order, and a released primitive is
+ * handed over to the first waiter directly, so a fiber which
+ * comes later can't barge in. All waits accept a timeout and
+ * are cancellation points: a cancelled fiber which hasn't got
+ * the primitive leaves the queue and gets FiberCancelException.
+ */
+
+/** Contention statistics of a synchronization primitive. */
+struct ipc_stat {
+	/** The number of successful acquisitions. */
+	uint64_t acquired;
+	/** ... of which had to wait. */
+	uint64_t waited;
+	/** The number of waits which timed out or were cancelled. */
+	uint64_t timedout;
+};
+
+/**
+ * A latch: a mutex of fibers. Unlike a mutex, may be unlocked
+ * only by the fiber which has locked it.
+ */
+struct ipc_latch {
+	/** The fiber which holds the latch. */
+	struct fiber *owner;
+	/** Waiting fibers, struct ipc_waiter. */
+	struct rlist queue;
+	struct ipc_stat stat;
+};
+
+#define IPC_LATCH_INITIALIZER(name) \
+	{ NULL, RLIST_INITIALIZER(name.queue), { 0, 0, 0 } }
+
+void
+ipc_latch_create(struct ipc_latch *latch);
+
+/** @pre there are no waiters. */
+void
+ipc_latch_destroy(struct ipc_latch *latch);
+
+/**
+ * @brief Lock a latch, waiting at most timeout seconds.
+ * @retval 0 the latch is locked by the current fiber
+ * @retval -1, errno = ETIMEDOUT if timeout exceeded
+ */
+int
+ipc_latch_lock_timeout(struct ipc_latch *latch, ev_tstamp timeout);
+
+void
+ipc_latch_lock(struct ipc_latch *latch);
+
+/**
+ * @brief Lock a latch if it is free and has no waiters.
+ * @retval true if locked
+ */
+bool
+ipc_latch_trylock(struct ipc_latch *latch);
+
+/** Unlock a latch, hand it over to the first waiter. */
+void
+ipc_latch_unlock(struct ipc_latch *latch);
+
+static inline struct fiber *
+ipc_latch_owner(struct ipc_latch *latch)
+{
+	return latch->owner;
+}
+
+/**
+ * A read-write lock. A writer which waits for the lock blocks
+ * readers which come after it, so writers don't starve.
+ */
+struct ipc_rwlock {
+	/** The fiber which holds the lock for writing. */
+	struct fiber *writer;
+	/** The number of fibers which hold the lock for reading. */
+	unsigned readers;
+	/** Waiting fibers, struct ipc_waiter. */
+	struct rlist queue;
+	struct ipc_stat stat;
+};
+
+void
+ipc_rwlock_create(struct ipc_rwlock *rwlock);
+
+/** @pre there are no waiters. */
+void
+ipc_rwlock_destroy(struct ipc_rwlock *rwlock);
+
+/**
+ * @brief Lock for reading, waiting at most timeout seconds.
+ * @retval 0 success
+ * @retval -1, errno = ETIMEDOUT if timeout exceeded
+ */
+int
+ipc_rwlock_rdlock_timeout(struct ipc_rwlock *rwlock, ev_tstamp timeout);
+
+/**
+ * @brief Lock for writing, waiting at most timeout seconds.
+ * @retval 0 success
+ * @retval -1, errno = ETIMEDOUT if timeout exceeded
+ */
+int
+ipc_rwlock_wrlock_timeout(struct ipc_rwlock *rwlock, ev_tstamp timeout);
+
+void
+ipc_rwlock_rdlock(struct ipc_rwlock *rwlock);
+
+void
+ipc_rwlock_wrlock(struct ipc_rwlock *rwlock);
+
+bool
+ipc_rwlock_tryrdlock(struct ipc_rwlock *rwlock);
+
+bool
+ipc_rwlock_trywrlock(struct ipc_rwlock *rwlock);
+
+/**
+ * Unlock a lock held for writing by the current fiber, or
+ * held for reading otherwise.
+ */
+void
+ipc_rwlock_unlock(struct ipc_rwlock *rwlock);
+
+/** A condition variable. */
+struct ipc_cond {
+	/** Waiting fibers, struct ipc_waiter. */
+	struct rlist queue;
+	struct ipc_stat stat;
+};
+
+void
+ipc_cond_create(struct ipc_cond *cond);
+
+/** @pre there are no waiters. */
+void
+ipc_cond_destroy(struct ipc_cond *cond);
+
+/**
+ * @brief Wait for a signal at most timeout seconds.
+ * @param latch if not NULL, is unlocked while waiting and
+ *        locked again before return, even on timeout
+ * @retval 0 signaled
+ * @retval -1, errno = ETIMEDOUT if timeout exceeded
+ */
+int
+ipc_cond_wait_timeout(struct ipc_cond *cond, struct ipc_latch *latch,
+		      ev_tstamp timeout);
+
+void
+ipc_cond_wait(struct ipc_cond *cond, struct ipc_latch *latch);
+
+/** Wake up the first waiter. */
+void
+ipc_cond_signal(struct ipc_cond *cond);
+
+/** Wake up all waiters. */
+void
+ipc_cond_broadcast(struct ipc_cond *cond);
+
+/** A counting semaphore. */
+struct ipc_sem {
+	/** The number of free units. */
+	unsigned count;
+	/** Waiting fibers, struct ipc_waiter. */
+	struct rlist queue;
+	struct ipc_stat stat;
+};
+
+void
+ipc_sem_create(struct ipc_sem *sem, unsigned count);
+
+/** @pre there are no waiters. */
+void
+ipc_sem_destroy(struct ipc_sem *sem);
+
+/**
+ * @brief Take a unit, waiting at most timeout seconds.
+ * @retval 0 success
+ * @retval -1, errno = ETIMEDOUT if timeout exceeded
+ */
+int
+ipc_sem_acquire_timeout(struct ipc_sem *sem, ev_tstamp timeout);
+
+void
+ipc_sem_acquire(struct ipc_sem *sem);
+
+bool
+ipc_sem_tryacquire(struct ipc_sem *sem);
+
+/** Return a unit, hand it over to the first waiter. */
+void
+ipc_sem_release(struct ipc_sem *sem);
+
 #endif /* TARANTOOL_IPC_H_INCLUDED */
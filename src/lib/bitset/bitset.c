@@ -34,6 +34,13 @@
 #include <string.h>
 #include <assert.h>
 
+enum {
+	/** Number of bits in one page */
+	BITSET_PAGE_BIT = BITSET_PAGE_DATA_SIZE * CHAR_BIT,
+	/** Array and run containers grow by this number of bytes */
+	BITSET_CONTAINER_GROW = 16
+};
+
 void
 bitset_create(struct bitset *bitset, void *(*realloc)(void *ptr, size_t size))
 {
@@ -44,21 +51,111 @@ bitset_create(struct bitset *bitset, void *(*realloc)(void *ptr, size_t size))
 	bitset_pages_new(&bitset->pages);
 }
 
+/**
+ * Return the number of bytes allocated for a page with
+ * \a container able to hold \a capacity elements.
+ */
+static inline size_t
+bitset_page_size(struct bitset *bitset, enum bitset_container container,
+		 size_t capacity)
+{
+	switch (container) {
+	case BITSET_CONTAINER_ARRAY:
+		return sizeof(struct bitset_page) + capacity * sizeof(uint16_t);
+	case BITSET_CONTAINER_RUN:
+		return sizeof(struct bitset_page) +
+			capacity * sizeof(struct bitset_run);
+	default:
+		return bitset_page_alloc_size(bitset->realloc);
+	}
+}
+
+/**
+ * Choose the most compact container for a page with the given
+ * number of set bits and runs of set bits.
+ */
+static inline enum bitset_container
+bitset_container_select(size_t cardinality, size_t runs)
+{
+	size_t array_size = cardinality * sizeof(uint16_t);
+	size_t run_size = runs * sizeof(struct bitset_run);
+	if (run_size < array_size && run_size < BITSET_PAGE_DATA_SIZE)
+		return BITSET_CONTAINER_RUN;
+	if (array_size < BITSET_PAGE_DATA_SIZE)
+		return BITSET_CONTAINER_ARRAY;
+	return BITSET_CONTAINER_BITMAP;
+}
+
+/**
+ * Return the number of elements to allocate in \a container to
+ * store \a size elements.
+ */
+static inline size_t
+bitset_container_capacity(enum bitset_container container, size_t size)
+{
+	size_t elem_size;
+	switch (container) {
+	case BITSET_CONTAINER_ARRAY:
+		elem_size = sizeof(uint16_t);
+		break;
+	case BITSET_CONTAINER_RUN:
+		elem_size = sizeof(struct bitset_run);
+		break;
+	default:
+		return 0;
+	}
+	size_t bytes = size * elem_size;
+	bytes = (bytes + BITSET_CONTAINER_GROW - 1) /
+		BITSET_CONTAINER_GROW * BITSET_CONTAINER_GROW;
+	return bytes / elem_size;
+}
+
+static struct bitset_page *
+bitset_page_new(struct bitset *bitset, enum bitset_container container,
+		size_t capacity)
+{
+	size_t size = bitset_page_size(bitset, container, capacity);
+	struct bitset_page *page = bitset->realloc(NULL, size);
+	if (page == NULL)
+		return NULL;
+
+	if (container == BITSET_CONTAINER_BITMAP) {
+		bitset_page_create(page);
+	} else {
+		memset(page, 0, sizeof(*page));
+	}
+	page->container = container;
+	page->capacity = capacity;
+	bitset->mem_size += size;
+	return page;
+}
+
+static void
+bitset_page_delete(struct bitset *bitset, struct bitset_page *page)
+{
+	bitset->mem_size -= bitset_page_size(bitset, page->container,
+					     page->capacity);
+	bitset_page_destroy(page);
+	bitset->realloc(page, 0);
+}
+
 static struct bitset_page *
 bitset_destroy_iter_cb(bitset_pages_t *t, struct bitset_page *page, void *arg)
 {
 	(void) t;
 	struct bitset *bitset = (struct bitset *) arg;
-	bitset_page_destroy(page);
-	bitset->realloc(page, 0);
+	bitset_page_delete(bitset, page);
 	return NULL;
 }
 
 void
 bitset_destroy(struct bitset *bitset)
 {
+	if (bitset->spare != NULL)
+		bitset_page_delete(bitset, bitset->spare);
 	bitset_pages_iter(&bitset->pages, NULL, bitset_destroy_iter_cb, bitset);
 	memset(&bitset->pages, 0, sizeof(bitset->pages));
+	bitset->mem_size = 0;
 }
 
 bool
@@ -73,13 +170,157 @@ bitset_test(struct bitset *bitset, size_t pos)
 		return false;
 
 	assert(page->first_pos <= pos && pos < page->first_pos +
-	       BITSET_PAGE_DATA_SIZE * CHAR_BIT);
-	return bit_test(bitset_page_data(page), pos - page->first_pos);
+	       BITSET_PAGE_BIT);
+	return bitset_page_test(page, pos - page->first_pos);
+}
+
+int
+bitset_reserve(struct bitset *bitset)
+{
+	if (bitset->spare != NULL)
+		return 0;
+	bitset->spare = bitset_page_new(bitset, BITSET_CONTAINER_BITMAP, 0);
+	return bitset->spare != NULL ? 0 : -1;
+}
+
+/**
+ * Find a page to store the contents of \a page after a bit
+ * is cleared, when there is no memory for the best container:
+ * \a page itself if the contents still fit into it, otherwise
+ * the spare page, which can hold any contents.
+ */
+static struct bitset_page *
+bitset_page_fallback(struct bitset *bitset, struct bitset_page *page,
+		     size_t cardinality, size_t runs)
+{
+	switch (page->container) {
+	case BITSET_CONTAINER_ARRAY:
+		if (cardinality <= page->capacity)
+			return page;
+		break;
+	case BITSET_CONTAINER_RUN:
+		if (runs <= page->capacity)
+			return page;
+		break;
+	default:
+		return page;
+	}
+	struct bitset_page *dst = bitset->spare;
+	if (dst != NULL) {
+		bitset->spare = NULL;
+		dst->first_pos = page->first_pos;
+	}
+	return dst;
+}
+
+/**
+ * Set or clear bit \a offset of \a page, which must currently
+ * have the opposite value, and move the page to the most compact
+ * container for its new contents. The page may be reallocated
+ * and replaced in the pages tree. Clearing a bit falls back to
+ * bitset_page_fallback() if the new container can't be allocated.
+ * @retval 0 on success
+ * @retval -1 on memory error, the page is left unchanged
+ */
+static int
+bitset_page_update(struct bitset *bitset, struct bitset_page *page,
+		   size_t offset, bool value)
+{
+	assert(bitset_page_test(page, offset) != value);
+
+	/* Neighbour bits decide how the number of runs changes */
+	int neighbours = 0;
+	if (offset > 0 && bitset_page_test(page, offset - 1))
+		neighbours++;
+	if (offset + 1 < BITSET_PAGE_BIT &&
+	    bitset_page_test(page, offset + 1))
+		neighbours++;
+
+	size_t cardinality, runs;
+	if (value) {
+		cardinality = page->cardinality + 1;
+		runs = page->runs + 1 - neighbours;
+	} else {
+		cardinality = page->cardinality - 1;
+		runs = page->runs - 1 + neighbours;
+	}
+	assert(cardinality > 0);
+
+	enum bitset_container container =
+		bitset_container_select(cardinality, runs);
+	size_t capacity = bitset_container_capacity(container,
+		container == BITSET_CONTAINER_RUN ? runs : cardinality);
+
+	if (container == page->container && capacity == page->capacity) {
+		/* Fast paths: update the container in place */
+		if (container == BITSET_CONTAINER_BITMAP) {
+			if (value)
+				bit_set(bitset_page_data(page), offset);
+			else
+				bit_clear(bitset_page_data(page), offset);
+			goto done;
+		}
+		if (container == BITSET_CONTAINER_ARRAY) {
+			uint16_t *array = bitset_page_array(page);
+			size_t i = 0;
+			while (i < page->cardinality && array[i] < offset)
+				i++;
+			if (value) {
+				memmove(array + i + 1, array + i,
+					(page->cardinality - i) *
+					sizeof(*array));
+				array[i] = offset;
+			} else {
+				assert(array[i] == offset);
+				memmove(array + i, array + i + 1,
+					(page->cardinality - i - 1) *
+					sizeof(*array));
+			}
+			goto done;
+		}
+	}
+
+	/* Generic path: repack the page contents */
+	uint64_t bitmap[BITSET_PAGE_DATA_SIZE / sizeof(uint64_t)];
+	bitset_page_unpack(page, bitmap);
+	if (value)
+		bit_set(bitmap, offset);
+	else
+		bit_clear(bitmap, offset);
+	assert(bitset_bitmap_runs(bitmap) == runs);
+
+	struct bitset_page *dst = page;
+	if (container != page->container || capacity != page->capacity) {
+		dst = bitset_page_new(bitset, container, capacity);
+		if (dst != NULL)
+			dst->first_pos = page->first_pos;
+		else if (!value)
+			dst = bitset_page_fallback(bitset, page,
+						   cardinality, runs);
+		if (dst == NULL)
+			return -1;
+	}
+	bitset_page_pack(dst, bitmap);
+	if (dst != page) {
+		bitset_pages_remove(&bitset->pages, page);
+		bitset_page_delete(bitset, page);
+		bitset_pages_insert(&bitset->pages, dst);
+		page = dst;
+	}
+
+done:
+	page->cardinality = cardinality;
+	page->runs = runs;
+	return 0;
 }
 
 int
 bitset_set(struct bitset *bitset, size_t pos)
 {
+	/* Keep clearing of the bits being set infallible */
+	if (bitset_reserve(bitset) != 0)
+		return -1;
+
 	struct bitset_page key;
 	key.first_pos = bitset_page_first_pos(pos);
 
@@ -87,28 +328,36 @@ bitset_set(struct bitset *bitset, size_t pos)
 	struct bitset_page *page = bitset_pages_search(&bitset->pages, &key);
 	if (page == NULL) {
 		/* Allocate a new page */
-		size_t size = bitset_page_alloc_size(bitset->realloc);
-		page = bitset->realloc(NULL, size);
+		size_t capacity =
+			bitset_container_capacity(BITSET_CONTAINER_ARRAY, 1);
+		page = bitset_page_new(bitset, BITSET_CONTAINER_ARRAY,
+				       capacity);
 		if (page == NULL)
 			return -1;
 
-		bitset_page_create(page);
 		page->first_pos = key.first_pos;
+		bitset_page_array(page)[0] = pos - key.first_pos;
+		page->cardinality = 1;
+		page->runs = 1;
 
 		/* Insert the page into pages tree */
 		bitset_pages_insert(&bitset->pages, page);
+		bitset->cardinality++;
+		return 0;
 	}
 
 	assert(page->first_pos <= pos && pos < page->first_pos +
-	       BITSET_PAGE_DATA_SIZE * CHAR_BIT);
-	bool prev = bit_set(bitset_page_data(page), pos - page->first_pos);
-	if (prev) {
+	       BITSET_PAGE_BIT);
+	size_t offset = pos - page->first_pos;
+	if (bitset_page_test(page, offset)) {
 		/* Value has not changed */
 		return 1;
 	}
 
+	if (bitset_page_update(bitset, page, offset, true) != 0)
+		return -1;
+
 	bitset->cardinality++;
-	page->cardinality++;
 
 	return 0;
 }
@@ -125,23 +374,29 @@ bitset_clear(struct bitset *bitset, size_t pos)
 		return 0;
 
 	assert(page->first_pos <= pos && pos < page->first_pos +
-	       BITSET_PAGE_DATA_SIZE * CHAR_BIT);
-	bool prev = bit_clear(bitset_page_data(page), pos - page->first_pos);
-	if (!prev) {
+	       BITSET_PAGE_BIT);
+	size_t offset = pos - page->first_pos;
+	if (!bitset_page_test(page, offset)) {
 		return 0;
 	}
 
 	assert(bitset->cardinality > 0);
 	assert(page->cardinality > 0);
-	bitset->cardinality--;
-	page->cardinality--;
 
-	if (page->cardinality == 0) {
+	if (page->cardinality == 1) {
 		/* Remove the page from the pages tree */
 		bitset_pages_remove(&bitset->pages, page);
 		/* Free the page */
-		bitset_page_destroy(page);
-		bitset->realloc(page, 0);
+		bitset_page_delete(bitset, page);
+	} else if (bitset_page_update(bitset, page, offset, false) != 0) {
+		return -1;
+	}
+
+	bitset->cardinality--;
+	if (bitset->cardinality == 0 && bitset->spare != NULL) {
+		/* Nothing left to clear */
+		bitset_page_delete(bitset, bitset->spare);
+		bitset->spare = NULL;
 	}
 
 	return 1;
@@ -150,6 +405,9 @@ bitset_clear(struct bitset *bitset, size_t pos)
 extern inline size_t
 bitset_cardinality(const struct bitset *bitset);
 
+extern inline size_t
+bitset_mem_size(const struct bitset *bitset);
+
 void
 bitset_info(struct bitset *bitset, struct bitset_info *info)
 {
@@ -162,11 +420,29 @@ bitset_info(struct bitset *bitset, struct bitset_info *info)
 	struct bitset_page *page = bitset_pages_first(&bitset->pages);
 	while (page != NULL) {
 		info->pages++;
+		switch (page->container) {
+		case BITSET_CONTAINER_BITMAP:
+			info->pages_bitmap++;
+			break;
+		case BITSET_CONTAINER_ARRAY:
+			info->pages_array++;
+			break;
+		case BITSET_CONTAINER_RUN:
+			info->pages_run++;
+			break;
+		}
+		info->mem_size += bitset_page_size(bitset, page->container,
+						   page->capacity);
 		cardinality_check += page->cardinality;
 		page = bitset_pages_next(&bitset->pages, page);
 	}
+	if (bitset->spare != NULL) {
+		info->mem_size += bitset_page_size(bitset,
+						   BITSET_CONTAINER_BITMAP, 0);
+	}
 
 	assert(bitset_cardinality(bitset) == cardinality_check);
+	assert(bitset_mem_size(bitset) == info->mem_size);
 }
 
 #if defined(DEBUG)
@@ -183,7 +459,9 @@ bitset_dump(struct bitset *bitset, int verbose, FILE *stream)
 	fprintf(stream, "    " "page_size   = %zu/%zu /* (data / total) */\n",
 		info.page_data_size, info.page_total_size);
 	fprintf(stream, "    " "page_bit    = %zu\n", PAGE_BIT);
-	fprintf(stream, "    " "pages       = %zu\n", info.pages);
+	fprintf(stream, "    " "pages       = %zu "
+		"/* bitmap %zu, array %zu, run %zu */\n", info.pages,
+		info.pages_bitmap, info.pages_array, info.pages_run);
 
 
 	size_t cardinality = bitset_cardinality(bitset);
@@ -202,10 +480,8 @@ bitset_dump(struct bitset *bitset, int verbose, FILE *stream)
 		fprintf(stream, "    "
 			"utilization = undefined\n");
 	}
-	size_t mem_data  = info.page_data_size * info.pages;
-	size_t mem_total = info.page_total_size * info.pages;
+	size_t mem_total = info.mem_size;
 
-	fprintf(stream, "    " "mem_data    = %zu bytes\n", mem_data);
 	fprintf(stream, "    " "mem_total   = %zu bytes "
 		"/* data + padding + tree */\n", mem_total);
 	if (cardinality > 0) {
@@ -232,9 +508,11 @@ bitset_dump(struct bitset *bitset, int verbose, FILE *stream)
 		fprintf(stream, "        " "[%zu, %zu) ",
 			page->first_pos, page_last_pos);
 
-		fprintf(stream, "utilization = %8.4f%% (%zu/%zu)",
+		static const char *containers[] = { "bitmap", "array", "run" };
+		fprintf(stream, "%s utilization = %8.4f%% (%zu/%zu)",
+			containers[page->container],
 			(float) page->cardinality * 1e2 / PAGE_BIT,
-			page->cardinality, PAGE_BIT);
+			(size_t) page->cardinality, PAGE_BIT);
 
 		if (verbose < 2) {
 			fprintf(stream, "\n");
@@ -245,9 +523,10 @@ bitset_dump(struct bitset *bitset, int verbose, FILE *stream)
 		fprintf(stream, "vals = {");
 
 		size_t pos = 0;
+		uint64_t bitmap[BITSET_PAGE_DATA_SIZE / sizeof(uint64_t)];
+		bitset_page_unpack(page, bitmap);
 		struct bit_iterator it;
-		bit_iterator_init(&it, bitset_page_data(page),
-			      BITSET_PAGE_DATA_SIZE, true);
+		bit_iterator_init(&it, bitmap, BITSET_PAGE_DATA_SIZE, true);
 		while ( (pos = bit_iterator_next(&it)) != SIZE_MAX) {
 			fprintf(stream, "%zu, ", page->first_pos + pos);
 		}
@@ -39,6 +39,12 @@
  * by \a size_t position number.  Initially all bits are set to
  * false. You can use any values in range [0,SIZE_MAX).  The
  * container grows automatically.
+ *
+ * Bits are grouped into fixed-size pages kept in a tree. Each
+ * page picks the most compact of three containers for its
+ * contents: a plain bitmap, a sorted array of set positions
+ * (sparse pages) or a sorted array of runs of set bits (dense
+ * pages with long stretches of ones).
  */
 
 #include "bit/bit.h"
@@ -66,7 +72,14 @@ extern "C" {
 struct bitset_page {
 	size_t first_pos;
 	rb_node(struct bitset_page) node;
-	size_t cardinality;
+	/** Number of bits set in the page */
+	uint16_t cardinality;
+	/** Number of runs of consecutive set bits in the page */
+	uint16_t runs;
+	/** Number of elements allocated for array and run containers */
+	uint16_t capacity;
+	/** Container type, enum bitset_container */
+	uint16_t container;
 	uint8_t data[0];
 };
 
@@ -80,6 +93,14 @@ struct bitset {
 	/** @cond false */
 	bitset_pages_t pages;
 	size_t cardinality;
+	/** Memory allocated for pages, in bytes */
+	size_t mem_size;
+	/**
+	 * A page with a bitmap container, taken by bitset_clear()
+	 * when a page has to change its container and there is
+	 * no memory for the new one.
+	 */
+	struct bitset_page *spare;
 	void *(*realloc)(void *ptr, size_t size);
 	/** @endcond */
 };
@@ -122,15 +143,26 @@ bitset_set(struct bitset *bitset, size_t pos);
 
 /**
  * @brief Clear bit \a pos in \a bitset
+ * Never fails after a successful bitset_reserve() or
+ * bitset_set() on the same bitset.
  * @param bitset bitset
  * @param pos bit number
  * @retval 1 on success if previous value of \a pos was true
  * @retval 0 on success if previous value of \a pos was false
- * @retval -1 on memory error
+ * @retval -1 on memory error if the bitset has not been reserved
  */
 int
 bitset_clear(struct bitset *bitset, size_t pos);
 
+/**
+ * @brief Make sure the next bitset_clear() can't fail
+ * @param bitset bitset
+ * @retval 0 on success
+ * @retval -1 on memory error
+ */
+int
+bitset_reserve(struct bitset *bitset);
+
 /**
  * @brief Return the number of bits set to \a true in \a bitset.
  * @param bitset bitset
@@ -141,6 +173,16 @@ bitset_cardinality(const struct bitset *bitset) {
 	return bitset->cardinality;
 }
 
+/**
+ * @brief Return the amount of memory used by pages of \a bitset.
+ * @param bitset bitset
+ * @return the number of bytes allocated for pages of \a bitset.
+ */
+inline size_t
+bitset_mem_size(const struct bitset *bitset) {
+	return bitset->mem_size;
+}
+
 /**
  * @brief Bitset Information structure
  * @see bitset_info
@@ -154,6 +196,14 @@ struct bitset_info {
 	size_t page_total_size;
 	/** A multiplier by which an address of page data is aligned **/
 	size_t page_data_alignment;
+	/** Number of pages stored as bitmaps */
+	size_t pages_bitmap;
+	/** Number of pages stored as sorted arrays of positions */
+	size_t pages_array;
+	/** Number of pages stored as sorted arrays of runs */
+	size_t pages_run;
+	/** Memory allocated for all pages (in bytes) */
+	size_t mem_size;
 };
 
 /**
@@ -221,6 +221,20 @@ rollback:
 	return -1;
 }
 
+int
+bitset_index_reserve_remove(struct bitset_index *index)
+{
+	assert(index != NULL);
+
+	for (size_t b = 0; b < index->capacity; b++) {
+		if (index->bitsets[b] == NULL)
+			continue;
+		if (bitset_reserve(index->bitsets[b]) != 0)
+			return -1;
+	}
+	return 0;
+}
+
 void
 bitset_index_remove_value(struct bitset_index *index, size_t value)
 {
@@ -233,10 +247,14 @@ bitset_index_remove_value(struct bitset_index *index, size_t value)
 		if (index->bitsets[b] == NULL)
 			continue;
 
-		/* Ignore all errors here */
-		bitset_clear(index->bitsets[b], value);
+		/* Can't fail after bitset_index_reserve_remove() */
+		int rc = bitset_clear(index->bitsets[b], value);
+		assert(rc >= 0);
+		(void) rc;
 	}
-	bitset_clear(index->bitsets[0], value);
+	int rc = bitset_clear(index->bitsets[0], value);
+	assert(rc >= 0);
+	(void) rc;
 }
 
 bool
@@ -382,6 +400,16 @@ bitset_index_init_iterator(struct bitset_index *index,
 	return bitset_iterator_init(it, expr, index->bitsets, index->capacity);
 }
 
+size_t
+bitset_index_bsize(const struct bitset_index *index)
+{
+	size_t result = 0;
+	for (size_t b = 0; b < index->capacity; b++) {
+		result += bitset_mem_size(index->bitsets[b]);
+	}
+	return result;
+}
+
 extern inline size_t
 bitset_index_size(const struct bitset_index *index);
 
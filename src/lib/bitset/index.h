@@ -169,8 +169,18 @@ int
 bitset_index_insert(struct bitset_index *index, const void *key, size_t key_size,
 		    size_t value);
 
+/**
+ * @brief Reserve memory for bitset_index_remove_value()
+ * @param index bitset index
+ * @retval 0 on success
+ * @retval -1 on memory error
+ */
+int
+bitset_index_reserve_remove(struct bitset_index *index);
+
 /**
  * @brief Remove a pair with \a value (*, \a value) from \a index.
+ * Never fails after a successful bitset_index_reserve_remove().
  * @param index bitset index
  * @param value value
  */
@@ -311,6 +321,14 @@ bitset_index_count(const struct bitset_index *index, size_t bit)
 	return bitset_cardinality(index->bitsets[bit + 1]);
 }
 
+/**
+ * @brief Return the amount of memory used by bitsets of \a index.
+ * @param index bitset index
+ * @return the number of bytes allocated for bitset pages
+ */
+size_t
+bitset_index_bsize(const struct bitset_index *index);
+
 #if defined(DEBUG)
 void
 bitset_index_dump(struct bitset_index *index, int verbose, FILE *stream);
@@ -294,7 +294,12 @@ bitset_iterator_conj_cmp(const void *p1, const void *p2)
 	}
 }
 
-static void
+/**
+ * Evaluate a conjunction on the current page.
+ * @retval true if the result page has at least one bit set
+ * @retval false if the result page is empty
+ */
+static bool
 bitset_iterator_conj_prepare_page(struct bitset_iterator_conj *conj,
 				  struct bitset_page *dst)
 {
@@ -308,7 +313,8 @@ bitset_iterator_conj_prepare_page(struct bitset_iterator_conj *conj,
 		if (!conj->pre_nots[b]) {
 			/* conj->pages[b] is rewinded to conj->page_first_pos */
 			assert(conj->pages[b]->first_pos == conj->page_first_pos);
-			bitset_page_and(dst, conj->pages[b]);
+			if (!bitset_page_and(dst, conj->pages[b]))
+				return false;
 		} else {
 			/*
 			 * If page is NULL or its position is not equal
@@ -322,12 +328,20 @@ bitset_iterator_conj_prepare_page(struct bitset_iterator_conj *conj,
 			    conj->pages[b]->first_pos != conj->page_first_pos)
 				continue;
 
-			bitset_page_nand(dst, conj->pages[b]);
+			if (!bitset_page_nand(dst, conj->pages[b]))
+				return false;
 		}
 	}
+	return true;
 }
 
-static void
+/**
+ * Evaluate the expression on the next page with data.
+ * @retval true if the result page has at least one bit set or
+ * there are no more pages
+ * @retval false if the result page is empty
+ */
+static bool
 bitset_iterator_prepare_page(struct bitset_iterator *it)
 {
 	qsort(it->conjs, it->size, sizeof(*it->conjs),
@@ -342,36 +356,49 @@ bitset_iterator_prepare_page(struct bitset_iterator *it)
 
 	/* There is no more conjunctions that can be ORed */
 	if (it->page->first_pos == SIZE_MAX)
-		return;
+		return true;
 
+	bool has_bits = false;
 	/* For each conj where conj->page_first_pos == pos */
 	for (size_t c = 0; c < it->size; c++) {
 		if (it->conjs[c].page_first_pos > it->page->first_pos)
 			break;
 
 		/* Get result from conj */
-		bitset_iterator_conj_prepare_page(&it->conjs[c], it->page_tmp);
+		if (!bitset_iterator_conj_prepare_page(&it->conjs[c],
+						       it->page_tmp))
+			continue;
 		/* OR page from conjunction with it->page */
 		bitset_page_or(it->page, it->page_tmp);
+		has_bits = true;
 	}
 
+	if (!has_bits)
+		return false;
+
 	/* Init the bit iterator on it->page */
 	bit_iterator_init(&it->page_it, bitset_page_data(it->page),
 		      BITSET_PAGE_DATA_SIZE, true);
+	return true;
 }
 
+/**
+ * Rewind all conjunctions that are at the current position
+ * to the next position.
+ */
 static void
-bitset_iterator_first_page(struct bitset_iterator *it)
+bitset_iterator_rewind_conjs(struct bitset_iterator *it)
 {
-	assert(it != NULL);
+	size_t PAGE_BIT = BITSET_PAGE_DATA_SIZE * CHAR_BIT;
+	size_t pos = it->page->first_pos;
 
-	/* Rewind all conjunctions to first positions */
 	for (size_t c = 0; c < it->size; c++) {
-		bitset_iterator_conj_rewind(&it->conjs[c], 0);
-	}
+		if (it->conjs[c].page_first_pos > pos)
+			break;
 
-	/* Prepare the result page */
-	bitset_iterator_prepare_page(it);
+		bitset_iterator_conj_rewind(&it->conjs[c], pos + PAGE_BIT);
+		assert(pos + PAGE_BIT <= it->conjs[c].page_first_pos);
+	}
 }
 
 static void
@@ -379,24 +406,28 @@ bitset_iterator_next_page(struct bitset_iterator *it)
 {
 	assert(it != NULL);
 
-	size_t PAGE_BIT = BITSET_PAGE_DATA_SIZE * CHAR_BIT;
-	size_t pos = it->page->first_pos;
+	/* Skip pages where the expression has no bits set */
+	do {
+		bitset_iterator_rewind_conjs(it);
+	} while (!bitset_iterator_prepare_page(it));
+}
 
-	/* Rewind all conjunctions that at the current position to the
-	 * next position */
-	for (size_t c = 0; c < it->size; c++) {
-		if (it->conjs[c].page_first_pos > pos)
-			break;
+static void
+bitset_iterator_first_page(struct bitset_iterator *it)
+{
+	assert(it != NULL);
 
-		bitset_iterator_conj_rewind(&it->conjs[c], pos + PAGE_BIT);
-		assert(pos + PAGE_BIT <= it->conjs[c].page_first_pos);
+	/* Rewind all conjunctions to first positions */
+	for (size_t c = 0; c < it->size; c++) {
+		it->conjs[c].page_first_pos = 0;
+		bitset_iterator_conj_rewind(&it->conjs[c], 0);
 	}
 
 	/* Prepare the result page */
-	bitset_iterator_prepare_page(it);
+	if (!bitset_iterator_prepare_page(it))
+		bitset_iterator_next_page(it);
 }
 
-
 void
 bitset_iterator_rewind(struct bitset_iterator *it)
 {
@@ -423,3 +454,17 @@ bitset_iterator_next(struct bitset_iterator *it)
 		bitset_iterator_next_page(it);
 	}
 }
+
+size_t
+bitset_iterator_count(struct bitset_iterator *it)
+{
+	assert(it != NULL);
+
+	bitset_iterator_rewind(it);
+	size_t count = 0;
+	while (it->page->first_pos != SIZE_MAX) {
+		count += bitset_page_popcount(it->page);
+		bitset_iterator_next_page(it);
+	}
+	return count;
+}
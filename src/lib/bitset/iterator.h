@@ -133,6 +133,17 @@ bitset_iterator_rewind(struct bitset_iterator *it);
 size_t
 bitset_iterator_next(struct bitset_iterator *it);
 
+/**
+ * @brief Count positions where the expression evaluates to true.
+ * Result pages are counted with popcount, without iterating over
+ * single bits. The iterator is exhausted after this call, use
+ * @link bitset_iterator_rewind @endlink to start over.
+ * @param it bitset iterator
+ * @return the number of bits in the result set
+ */
+size_t
+bitset_iterator_count(struct bitset_iterator *it);
+
 #if defined(__cplusplus)
 }
 #endif /* defined(__cplusplus) */
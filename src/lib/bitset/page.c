@@ -42,6 +42,15 @@ bitset_page_create(struct bitset_page *page);
 extern inline void
 bitset_page_destroy(struct bitset_page *page);
 
+extern inline uint16_t *
+bitset_page_array(struct bitset_page *page);
+
+extern inline struct bitset_run *
+bitset_page_runs(struct bitset_page *page);
+
+extern inline const bitset_word_t *
+bitset_page_words(struct bitset_page *page, bitset_word_t *buf);
+
 extern inline size_t
 bitset_page_first_pos(size_t pos);
 
@@ -51,24 +60,170 @@ bitset_page_set_zeros(struct bitset_page *page);
 extern inline void
 bitset_page_set_ones(struct bitset_page *page);
 
-extern inline void
+extern inline bool
+bitset_word_is_zero(bitset_word_t word);
+
+extern inline bool
 bitset_page_and(struct bitset_page *dst, struct bitset_page *src);
 
-extern inline void
+extern inline bool
 bitset_page_nand(struct bitset_page *dst, struct bitset_page *src);
 
-extern inline void
+extern inline bool
 bitset_page_or(struct bitset_page *dst, struct bitset_page *src);
 
+extern inline size_t
+bitset_page_popcount(struct bitset_page *page);
+
+/**
+ * Return the index of the first element of a sorted array which
+ * is not less than \a offset.
+ */
+static inline size_t
+bitset_array_lower_bound(const uint16_t *array, size_t size, size_t offset)
+{
+	size_t lo = 0, hi = size;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (array[mid] < offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+bool
+bitset_page_test(struct bitset_page *page, size_t offset)
+{
+	assert(offset < BITSET_PAGE_DATA_SIZE * CHAR_BIT);
+	switch (page->container) {
+	case BITSET_CONTAINER_BITMAP:
+		return bit_test(bitset_page_data(page), offset);
+	case BITSET_CONTAINER_ARRAY: {
+		const uint16_t *array = bitset_page_array(page);
+		size_t i = bitset_array_lower_bound(array, page->cardinality,
+						    offset);
+		return i < page->cardinality && array[i] == offset;
+	}
+	case BITSET_CONTAINER_RUN: {
+		const struct bitset_run *runs = bitset_page_runs(page);
+		/* Find the first run which ends at or after offset */
+		size_t lo = 0, hi = page->runs;
+		while (lo < hi) {
+			size_t mid = lo + (hi - lo) / 2;
+			if (runs[mid].last < offset)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return lo < page->runs && runs[lo].first <= offset;
+	}
+	default:
+		assert(false);
+		return false;
+	}
+}
+
+void
+bitset_page_unpack(struct bitset_page *page, void *bitmap)
+{
+	switch (page->container) {
+	case BITSET_CONTAINER_BITMAP:
+		memcpy(bitmap, bitset_page_data(page), BITSET_PAGE_DATA_SIZE);
+		break;
+	case BITSET_CONTAINER_ARRAY: {
+		memset(bitmap, 0, BITSET_PAGE_DATA_SIZE);
+		const uint16_t *array = bitset_page_array(page);
+		for (size_t i = 0; i < page->cardinality; i++)
+			bit_set(bitmap, array[i]);
+		break;
+	}
+	case BITSET_CONTAINER_RUN: {
+		memset(bitmap, 0, BITSET_PAGE_DATA_SIZE);
+		unsigned char *bytes = (unsigned char *) bitmap;
+		const struct bitset_run *runs = bitset_page_runs(page);
+		for (size_t r = 0; r < page->runs; r++) {
+			size_t pos = runs[r].first;
+			size_t end = (size_t) runs[r].last + 1;
+			/* Head bits up to a byte boundary */
+			for (; pos < end && pos % CHAR_BIT != 0; pos++)
+				bit_set(bitmap, pos);
+			/* Whole bytes */
+			size_t n = (end - pos) / CHAR_BIT;
+			memset(bytes + pos / CHAR_BIT, 0xff, n);
+			pos += n * CHAR_BIT;
+			/* Tail bits */
+			for (; pos < end; pos++)
+				bit_set(bitmap, pos);
+		}
+		break;
+	}
+	default:
+		assert(false);
+	}
+}
+
+void
+bitset_page_pack(struct bitset_page *page, const void *bitmap)
+{
+	if (page->container == BITSET_CONTAINER_BITMAP) {
+		memcpy(bitset_page_data(page), bitmap, BITSET_PAGE_DATA_SIZE);
+		return;
+	}
+
+	struct bit_iterator it;
+	bit_iterator_init(&it, bitmap, BITSET_PAGE_DATA_SIZE, true);
+	size_t pos;
+	size_t size = 0;
+	if (page->container == BITSET_CONTAINER_ARRAY) {
+		uint16_t *array = bitset_page_array(page);
+		while ((pos = bit_iterator_next(&it)) != SIZE_MAX) {
+			assert(size < page->capacity);
+			array[size++] = pos;
+		}
+		return;
+	}
+
+	assert(page->container == BITSET_CONTAINER_RUN);
+	struct bitset_run *runs = bitset_page_runs(page);
+	while ((pos = bit_iterator_next(&it)) != SIZE_MAX) {
+		if (size > 0 && runs[size - 1].last + 1 == pos) {
+			runs[size - 1].last = pos;
+			continue;
+		}
+		assert(size < page->capacity);
+		runs[size].first = pos;
+		runs[size].last = pos;
+		size++;
+	}
+}
+
+size_t
+bitset_bitmap_runs(const void *bitmap)
+{
+	const unsigned char *bytes = (const unsigned char *) bitmap;
+	size_t runs = 0;
+	unsigned carry = 0;
+	for (size_t i = 0; i < BITSET_PAGE_DATA_SIZE; i++) {
+		/* Count bits which start a run: set bits with a clear
+		 * predecessor */
+		unsigned b = bytes[i];
+		runs += bit_count_u32(b & ~((b << 1) | carry) & 0xff);
+		carry = b >> (CHAR_BIT - 1);
+	}
+	return runs;
+}
+
 #if defined(DEBUG)
 void
 bitset_page_dump(struct bitset_page *page, FILE *stream)
 {
 	fprintf(stream, "Page %zu:\n", page->first_pos);
-	char *d = bitset_page_data(page);
+	char d[BITSET_PAGE_DATA_SIZE];
+	bitset_page_unpack(page, d);
 	for (int i = 0; i < BITSET_PAGE_DATA_SIZE; i++) {
-		fprintf(stream, "%x ", *d);
-		d++;
+		fprintf(stream, "%x ", d[i]);
 	}
 	fprintf(stream, "\n--\n");
 }
@@ -46,6 +46,9 @@
 #include <string.h>
 #include <limits.h>
 #include <assert.h>
+#if defined(ENABLE_AVX2) || defined(ENABLE_AVX) || defined(ENABLE_SSE2)
+#include <immintrin.h>
+#endif
 
 #if defined(__cplusplus)
 extern "C" {
@@ -56,7 +59,28 @@ enum {
 	BITSET_PAGE_DATA_SIZE = 160
 };
 
-#if defined(ENABLE_AVX)
+/**
+ * @brief Page container type
+ */
+enum bitset_container {
+	/** BITSET_PAGE_DATA_SIZE bytes of plain bits */
+	BITSET_CONTAINER_BITMAP = 0,
+	/** A sorted array of uint16_t offsets of set bits */
+	BITSET_CONTAINER_ARRAY = 1,
+	/** A sorted array of struct bitset_run */
+	BITSET_CONTAINER_RUN = 2
+};
+
+/**
+ * @brief A run of consecutive set bits, [first, last] offsets
+ * within a page
+ */
+struct bitset_run {
+	uint16_t first;
+	uint16_t last;
+};
+
+#if defined(ENABLE_AVX2) || defined(ENABLE_AVX)
 typedef __m256i bitset_word_t;
 #define BITSET_PAGE_DATA_ALIGNMENT 32
 #elif defined(ENABLE_SSE2)
@@ -126,6 +150,59 @@ bitset_page_destroy(struct bitset_page *page)
 	/* nothing */
 }
 
+inline uint16_t *
+bitset_page_array(struct bitset_page *page)
+{
+	assert(page->container == BITSET_CONTAINER_ARRAY);
+	return (uint16_t *) page->data;
+}
+
+inline struct bitset_run *
+bitset_page_runs(struct bitset_page *page)
+{
+	assert(page->container == BITSET_CONTAINER_RUN);
+	return (struct bitset_run *) page->data;
+}
+
+/**
+ * @brief Test bit \a offset of \a page regardless of its container
+ */
+bool
+bitset_page_test(struct bitset_page *page, size_t offset);
+
+/**
+ * @brief Expand contents of \a page to a plain bitmap of
+ * BITSET_PAGE_DATA_SIZE bytes
+ */
+void
+bitset_page_unpack(struct bitset_page *page, void *bitmap);
+
+/**
+ * @brief Store a plain bitmap into \a page using page->container.
+ * The page must have enough capacity for the contents.
+ */
+void
+bitset_page_pack(struct bitset_page *page, const void *bitmap);
+
+/**
+ * @brief Count runs of consecutive set bits in a plain bitmap
+ */
+size_t
+bitset_bitmap_runs(const void *bitmap);
+
+/**
+ * @brief Return words of \a page as a plain bitmap. Bitmap pages
+ * are returned as is, other containers are expanded to \a buf.
+ */
+inline const bitset_word_t *
+bitset_page_words(struct bitset_page *page, bitset_word_t *buf)
+{
+	if (page->container == BITSET_CONTAINER_BITMAP)
+		return (const bitset_word_t *) bitset_page_data(page);
+	bitset_page_unpack(page, buf);
+	return buf;
+}
+
 inline size_t
 bitset_page_first_pos(size_t pos) {
 	return pos - (pos % (BITSET_PAGE_DATA_SIZE * CHAR_BIT));
@@ -145,43 +222,99 @@ bitset_page_set_ones(struct bitset_page *page)
 	memset(data, -1, BITSET_PAGE_DATA_SIZE);
 }
 
-inline void
+/**
+ * @brief Check if a word accumulated by page operations is zero
+ */
+inline bool
+bitset_word_is_zero(bitset_word_t word)
+{
+#if defined(ENABLE_AVX2) || defined(ENABLE_AVX)
+	return _mm256_testz_si256(word, word);
+#elif defined(ENABLE_SSE2)
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(word,
+			_mm_setzero_si128())) == 0xFFFF;
+#else
+	return word == 0;
+#endif
+}
+
+/*
+ * Page operations below work a whole machine (or vector) word
+ * at a time and return true if the destination page has at
+ * least one bit set, so callers can stop evaluation of a
+ * conjunction early and skip empty result pages without
+ * scanning them bit by bit. The destination is always a bitmap
+ * page, the source may use any container.
+ */
+
+inline bool
 bitset_page_and(struct bitset_page *dst, struct bitset_page *src)
 {
+	assert(dst->container == BITSET_CONTAINER_BITMAP);
+	bitset_word_t buf[BITSET_PAGE_DATA_SIZE / sizeof(bitset_word_t)];
 	bitset_word_t *d = (bitset_word_t *) bitset_page_data(dst);
-	bitset_word_t *s = (bitset_word_t *) bitset_page_data(src);
+	const bitset_word_t *s = bitset_page_words(src, buf);
 
 	assert(BITSET_PAGE_DATA_SIZE % sizeof(bitset_word_t) == 0);
 	int cnt = BITSET_PAGE_DATA_SIZE / sizeof(bitset_word_t);
-	for (int i = 0; i < cnt; i++) {
-		*d++ &= *s++;
+	bitset_word_t acc = *d &= *s;
+	for (int i = 1; i < cnt; i++) {
+		acc |= d[i] &= s[i];
 	}
+	return !bitset_word_is_zero(acc);
 }
 
-inline void
+inline bool
 bitset_page_nand(struct bitset_page *dst, struct bitset_page *src)
 {
+	assert(dst->container == BITSET_CONTAINER_BITMAP);
+	bitset_word_t buf[BITSET_PAGE_DATA_SIZE / sizeof(bitset_word_t)];
 	bitset_word_t *d = (bitset_word_t *) bitset_page_data(dst);
-	bitset_word_t *s = (bitset_word_t *) bitset_page_data(src);
+	const bitset_word_t *s = bitset_page_words(src, buf);
 
 	assert(BITSET_PAGE_DATA_SIZE % sizeof(bitset_word_t) == 0);
 	int cnt = BITSET_PAGE_DATA_SIZE / sizeof(bitset_word_t);
-	for (int i = 0; i < cnt; i++) {
-		*d++ &= ~*s++;
+	bitset_word_t acc = *d &= ~*s;
+	for (int i = 1; i < cnt; i++) {
+		acc |= d[i] &= ~s[i];
 	}
+	return !bitset_word_is_zero(acc);
 }
 
-inline void
+inline bool
 bitset_page_or(struct bitset_page *dst, struct bitset_page *src)
 {
+	assert(dst->container == BITSET_CONTAINER_BITMAP);
+	bitset_word_t buf[BITSET_PAGE_DATA_SIZE / sizeof(bitset_word_t)];
 	bitset_word_t *d = (bitset_word_t *) bitset_page_data(dst);
-	bitset_word_t *s = (bitset_word_t *) bitset_page_data(src);
+	const bitset_word_t *s = bitset_page_words(src, buf);
 
 	assert(BITSET_PAGE_DATA_SIZE % sizeof(bitset_word_t) == 0);
 	int cnt = BITSET_PAGE_DATA_SIZE / sizeof(bitset_word_t);
+	bitset_word_t acc = *d |= *s;
+	for (int i = 1; i < cnt; i++) {
+		acc |= d[i] |= s[i];
+	}
+	return !bitset_word_is_zero(acc);
+}
+
+/**
+ * @brief Return the number of bits set in the page
+ */
+inline size_t
+bitset_page_popcount(struct bitset_page *page)
+{
+	if (page->container != BITSET_CONTAINER_BITMAP)
+		return page->cardinality;
+	const uint64_t *d = (const uint64_t *) bitset_page_data(page);
+
+	assert(BITSET_PAGE_DATA_SIZE % sizeof(uint64_t) == 0);
+	int cnt = BITSET_PAGE_DATA_SIZE / sizeof(uint64_t);
+	size_t result = 0;
 	for (int i = 0; i < cnt; i++) {
-		*d++ |= *s++;
+		result += bit_count_u64(d[i]);
 	}
+	return result;
 }
 
 #if defined(DEBUG)
@@ -170,6 +170,12 @@ typedef void (*LIGHT(extent_free_t))(void *);
  */
 static const uint32_t LIGHT(end) = 0xFFFFFFFF;
 
+/*
+ * The largest table LIGHT(reserve) can allocate: the cover
+ * (the next power of two) must fit into 32 bits.
+ */
+static const uint32_t LIGHT(max_size) = 1u << 31;
+
 /* Functions declaration */
 
 /**
@@ -193,6 +199,15 @@ LIGHT(create)(struct LIGHT(core) *ht, size_t extent_size,
 void
 LIGHT(destroy)(struct LIGHT(core) *ht);
 
+/**
+ * @brief Grow hash table to hold at least given number of records
+ * @param ht - pointer to a hash table struct
+ * @param size - desired number of records
+ * @return 0 on success, -1 on memory error
+ */
+int
+LIGHT(reserve)(struct LIGHT(core) *ht, uint32_t size);
+
 /**
  * @brief Find a record with given hash and value
  * @param ht - pointer to a hash table struct
@@ -734,6 +749,73 @@ LIGHT(grow)(struct LIGHT(core) *ht)
 	return 0;
 }
 
+/*
+ * Allocate memory for an empty hash table of the given size
+ * (a multiple of GROW_INCREMENT) and link all records into
+ * the list of empty records at once, without splitting.
+ */
+inline int
+LIGHT(prepare_size)(struct LIGHT(core) *ht, uint32_t size)
+{
+	assert(ht->count == 0);
+	assert(ht->table_size == 0);
+	assert(size % ht->GROW_INCREMENT == 0);
+
+	uint32_t slot;
+	for (uint32_t i = 0; i < size; i += ht->GROW_INCREMENT) {
+		struct LIGHT(record) *record = (struct LIGHT(record) *)
+			matras_alloc_range(&ht->mtable, &slot,
+					   ht->GROW_INCREMENT);
+		if (!record) {
+			for (; i > 0; i -= ht->GROW_INCREMENT)
+				matras_dealloc_range(&ht->mtable,
+						     ht->GROW_INCREMENT);
+			return -1;
+		}
+		assert(slot == i);
+		for (uint32_t j = 0; j < ht->GROW_INCREMENT; j++, slot++) {
+			record[j].next = slot;
+			LIGHT(set_empty_prev)(record + j, slot - 1);
+			LIGHT(set_empty_next)(record + j, slot + 1);
+		}
+	}
+	struct LIGHT(record) *record = (struct LIGHT(record) *)
+		matras_get(&ht->mtable, 0);
+	LIGHT(set_empty_prev)(record, LIGHT(end));
+	record = (struct LIGHT(record) *) matras_get(&ht->mtable, size - 1);
+	LIGHT(set_empty_next)(record, LIGHT(end));
+
+	assert(size <= LIGHT(max_size));
+	uint32_t cover = ht->GROW_INCREMENT;
+	while (cover < size)
+		cover <<= 1;
+	ht->table_size = size;
+	ht->cover_mask = cover - 1;
+	ht->empty_slot = 0;
+	return 0;
+}
+
+/**
+ * @brief Grow hash table to hold at least given number of records
+ * An empty table is allocated in one shot. A non-empty table
+ * is left as is and grows on demand, as insertions do.
+ * @param ht - pointer to a hash table struct
+ * @param size - desired number of records
+ * @return 0 on success, -1 on memory error or if the size
+ *         is above LIGHT(max_size)
+ */
+inline int
+LIGHT(reserve)(struct LIGHT(core) *ht, uint32_t size)
+{
+	if (ht->table_size != 0 || size == 0)
+		return 0;
+	if (size > LIGHT(max_size))
+		return -1;
+	size = (size + ht->GROW_INCREMENT - 1) &
+		~((uint32_t)ht->GROW_INCREMENT - 1);
+	return LIGHT(prepare_size)(ht, size);
+}
+
 /**
  * @brief Insert a record with given hash and value
  * @param ht - pointer to a hash table struct
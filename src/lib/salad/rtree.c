@@ -27,6 +27,7 @@
  * SUCH DAMAGE.
  */
 #include "rtree.h"
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 
@@ -807,6 +808,140 @@ rtree_insert(struct rtree *tree, struct rtree_rect *rect, record_t obj)
 }
 
 
+/*------------------------------------------------------------------------- */
+/* R-tree bulk loading */
+/*------------------------------------------------------------------------- */
+
+static int
+rtree_entry_cmp_dim(const struct rtree_entry *e1,
+		    const struct rtree_entry *e2, int dim)
+{
+	/* Compare doubled centers to avoid division */
+	coord_t c1 = e1->rect.lower_point.coords[dim] +
+		e1->rect.upper_point.coords[dim];
+	coord_t c2 = e2->rect.lower_point.coords[dim] +
+		e2->rect.upper_point.coords[dim];
+	return c1 < c2 ? -1 : c1 > c2;
+}
+
+static int
+rtree_entry_cmp_x(const void *e1, const void *e2)
+{
+	return rtree_entry_cmp_dim((const struct rtree_entry *)e1,
+				   (const struct rtree_entry *)e2, 0);
+}
+
+static int
+rtree_entry_cmp_y(const void *e1, const void *e2)
+{
+	return rtree_entry_cmp_dim((const struct rtree_entry *)e1,
+				   (const struct rtree_entry *)e2, 1);
+}
+
+/* Index of the first entry of page i of n_pages spread over count entries */
+static unsigned
+rtree_build_page_start(unsigned count, unsigned n_pages, unsigned i)
+{
+	return (unsigned)((unsigned long long)count * i / n_pages);
+}
+
+/*
+ * Pack one level of the tree with Sort-Tile-Recursive:
+ * sort entries by x, cut them into vertical slices of about
+ * sqrt(n_pages) pages each, sort every slice by y and fill
+ * pages from consecutive entries. The entries are distributed
+ * evenly, so every page except a single root has at least
+ * RTREE_MIN_FILL branches.
+ * Branches pointing to created pages are written back to the
+ * beginning of the array, the number of pages is returned.
+ * Entries of level 0 are records, entries of level l > 0 are
+ * pages of height l.
+ * On page allocation failure all pages referenced by the array,
+ * both of this level and of the level below, are freed and -1
+ * is returned.
+ */
+static int
+rtree_build_level(struct rtree *tree, struct rtree_entry *entries,
+		  unsigned count, int level)
+{
+	assert(RTREE_DIMENSION == 2);
+	unsigned n_pages = (count + RTREE_MAX_FILL - 1) / RTREE_MAX_FILL;
+	unsigned n_slices = 1;
+	while (n_slices * n_slices < n_pages)
+		n_slices++;
+
+	qsort(entries, count, sizeof(*entries), rtree_entry_cmp_x);
+	for (unsigned s = 0; s < n_slices; s++) {
+		unsigned first_page = rtree_build_page_start(n_pages,
+							     n_slices, s);
+		unsigned last_page = rtree_build_page_start(n_pages,
+							    n_slices, s + 1);
+		unsigned begin = rtree_build_page_start(count, n_pages,
+							first_page);
+		unsigned end = rtree_build_page_start(count, n_pages,
+						      last_page);
+		qsort(entries + begin, end - begin, sizeof(*entries),
+		      rtree_entry_cmp_y);
+	}
+
+	for (unsigned i = 0; i < n_pages; i++) {
+		unsigned begin = rtree_build_page_start(count, n_pages, i);
+		unsigned end = rtree_build_page_start(count, n_pages, i + 1);
+		assert(end - begin <= RTREE_MAX_FILL);
+		assert(n_pages == 1 || end - begin >= RTREE_MIN_FILL);
+
+		struct rtree_page *page = rtree_alloc_page(tree);
+		if (page == NULL) {
+			/* Pages of this level built so far */
+			for (unsigned j = 0; j < i; j++)
+				rtree_page_purge(tree, (struct rtree_page *)
+						 entries[j].record, level + 1);
+			/* Pages of the level below not packed yet */
+			for (unsigned j = begin; level > 0 && j < count; j++)
+				rtree_page_purge(tree, (struct rtree_page *)
+						 entries[j].record, level);
+			return -1;
+		}
+		tree->n_pages++;
+		page->n = end - begin;
+		for (unsigned j = begin; j < end; j++) {
+			page->b[j - begin].rect = entries[j].rect;
+			page->b[j - begin].data.record = entries[j].record;
+		}
+		/* Entries up to begin are already copied to pages */
+		assert(i <= begin);
+		entries[i].rect = rtree_page_cover(page);
+		entries[i].record = page;
+	}
+	return n_pages;
+}
+
+int
+rtree_build(struct rtree *tree, struct rtree_entry *entries, unsigned count)
+{
+	assert(tree->root == NULL);
+	if (count == 0)
+		return 0;
+
+	int height = 0;
+	int n = count;
+	do {
+		n = rtree_build_level(tree, entries, n, height);
+		if (n < 0) {
+			tree->n_pages = 0;
+			return -1;
+		}
+		height++;
+	} while (n > 1);
+	assert(height <= RTREE_MAX_HEIGHT);
+
+	tree->root = (struct rtree_page *)entries[0].record;
+	tree->height = height;
+	tree->n_records = count;
+	tree->version++;
+	return 0;
+}
+
 bool
 rtree_remove(struct rtree *tree, const struct rtree_rect *rect, record_t obj)
 {
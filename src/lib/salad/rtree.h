@@ -107,6 +107,15 @@ struct rtree_rect
 	struct rtree_point upper_point;
 };
 
+/* A record with its rectangle, used for bulk loading of a tree */
+struct rtree_entry
+{
+	/* rectangle of the record */
+	struct rtree_rect rect;
+	/* the record */
+	record_t record;
+};
+
 /* Type of function, comparing two rectangles */
 typedef bool (*rtree_comparator_t)(const struct rtree_rect *rt1,
 				   const struct rtree_rect *rt2);
@@ -239,6 +248,21 @@ rtree_search(const struct rtree *tree, const struct rtree_rect *rect,
 void
 rtree_insert(struct rtree *tree, struct rtree_rect *rect, record_t obj);
 
+/**
+ * @brief Bulk load records into an empty tree
+ * Records are packed into full pages in Sort-Tile-Recursive order,
+ * which is much faster than inserting them one by one and gives
+ * pages with less overlap.
+ * @param tree - pointer to an empty tree
+ * @param entries - records to load, the array is reordered and
+ *  used as a scratch space
+ * @param count - number of records
+ * @retval 0 - success
+ * @retval -1 - page allocation failed, the tree is left empty
+ */
+int
+rtree_build(struct rtree *tree, struct rtree_entry *entries, unsigned count);
+
 /**
  * @brief Remove the record from a tree
  * @return true if the record deleted (false otherwise)
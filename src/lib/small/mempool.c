@@ -74,7 +74,8 @@ mslab_alloc(struct mslab *slab)
 	if (slab->free_list) {
 		/* Recycle an object from the garbage pool. */
 		result = slab->free_list;
-		slab->free_list = *(void **)slab->free_list;
+		/* Objects may be aligned by 4 bytes only. */
+		memcpy(&slab->free_list, result, sizeof(void *));
 	} else {
 		/* Use an object from the "untouched" area of the slab. */
 		result = mslab_obj(slab, slab->free_idx++);
@@ -91,7 +92,7 @@ void
 mslab_free(struct mempool *pool, struct mslab *slab, void *ptr)
 {
 	/* put object to garbage list */
-	*(void **)ptr = slab->free_list;
+	memcpy(ptr, &slab->free_list, sizeof(void *));
 	slab->free_list = ptr;
 
 	slab->nfree++;
@@ -175,6 +176,32 @@ mempool_alloc_nothrow(struct mempool *pool)
 	return mslab_alloc(slab);
 }
 
+bool
+mempool_should_relocate(struct mempool *pool, void *ptr)
+{
+	struct mslab *slab = (struct mslab *)
+		slab_from_ptr(pool->cache, ptr, pool->slab_order);
+	assert(slab->pool == pool);
+	/* A full slab is not fragmented. */
+	if (slab->nfree == 0)
+		return false;
+	/*
+	 * New objects are allocated from the partially free
+	 * slab with the smallest address, moving an object
+	 * which lives in that slab won't free anything.
+	 */
+	if (mslab_tree_first(&pool->free_slabs) == slab)
+		return false;
+	/*
+	 * Only evacuate slabs which are populated worse than
+	 * an average slab of the pool.
+	 */
+	uint32_t slab_size = slab_order_size(pool->cache, pool->slab_order);
+	size_t slab_count = pool->slabs.stats.total / slab_size;
+	size_t slab_used = (pool->objcount - slab->nfree) * pool->objsize;
+	return slab_used * slab_count < pool->slabs.stats.used;
+}
+
 void
 mempool_stats(struct mempool *pool, struct mempool_stats *stats)
 {
@@ -247,6 +247,18 @@ mempool_free(struct mempool *pool, void *ptr)
 }
 
 
+/**
+ * Check if an object is worth moving to another place in the
+ * pool in order to reduce fragmentation: it resides in a slab
+ * which is populated worse than an average slab of the pool,
+ * and a new object would be allocated in a different slab.
+ * Once all objects are moved out of a slab, the slab is
+ * returned to the slab cache.
+ * @pre the object is allocated in this pool.
+ */
+bool
+mempool_should_relocate(struct mempool *pool, void *ptr);
+
 /** How much memory is used by this pool. */
 static inline size_t
 mempool_used(struct mempool *pool)
@@ -35,11 +35,19 @@
 #include <stdbool.h>
 #include <assert.h>
 #include <limits.h>
+#include <stdlib.h>
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
 
 #if !defined(MAP_ANONYMOUS)
 #define MAP_ANONYMOUS MAP_ANON
 #endif
 
+const char *slab_hugepages_strs[] = { "off", "madvise", "hugetlb", NULL };
+const char *slab_numa_strs[] = { "default", "interleave", "bind", NULL };
+
 void
 munmap_checked(void *addr, size_t size)
 {
@@ -99,6 +107,144 @@ mmap_checked(size_t size, size_t align, int flags)
 	return map;
 }
 
+int
+slab_numa_nodes_parse(const char *str, unsigned long *nodes)
+{
+	const unsigned max_node = sizeof(*nodes) * CHAR_BIT - 1;
+	*nodes = 0;
+	while (*str != '\0' && *str != '\n') {
+		char *end;
+		unsigned long first = strtoul(str, &end, 10);
+		if (end == str || first > max_node)
+			return -1;
+		unsigned long last = first;
+		str = end;
+		if (*str == '-') {
+			str++;
+			last = strtoul(str, &end, 10);
+			if (end == str || last > max_node || last < first)
+				return -1;
+			str = end;
+		}
+		for (unsigned long node = first; node <= last; node++)
+			*nodes |= 1UL << node;
+		if (*str == ',')
+			str++;
+		else if (*str != '\0' && *str != '\n')
+			return -1;
+	}
+	return *nodes != 0 ? 0 : -1;
+}
+
+/** Read the mask of online NUMA nodes. */
+static int
+slab_numa_nodes_online(unsigned long *nodes)
+{
+	FILE *f = fopen("/sys/devices/system/node/online", "r");
+	if (f == NULL)
+		return -1;
+	char buf[256];
+	int rc = -1;
+	if (fgets(buf, sizeof(buf), f) != NULL)
+		rc = slab_numa_nodes_parse(buf, nodes);
+	fclose(f);
+	return rc;
+}
+
+/** Apply the NUMA policy of the arena to a fresh mapping. */
+static void
+slab_mbind(struct slab_arena *arena, void *map, size_t size)
+{
+	if (arena->placement.numa == SLAB_NUMA_DEFAULT)
+		return;
+#if defined(__linux__) && defined(SYS_mbind)
+	/* Values of MPOL_BIND and MPOL_INTERLEAVE from linux/mempolicy.h */
+	int mode = arena->placement.numa == SLAB_NUMA_BIND ? 2 : 3;
+	unsigned long nodes = arena->placement.numa_nodes;
+	if (syscall(SYS_mbind, map, size, mode, &nodes,
+		    sizeof(nodes) * CHAR_BIT, 0) == 0) {
+		__sync_add_and_fetch(&arena->numa_size, size);
+		return;
+	}
+#else
+	(void) map;
+	(void) size;
+#endif
+	__sync_add_and_fetch(&arena->placement_errors, 1);
+}
+
+#if defined(MADV_HUGEPAGE)
+/**
+ * Check that MADV_HUGEPAGE has an effect on a mapping: the
+ * kernel uses transparent huge pages for private anonymous
+ * memory only if THP is enabled, and for shared memory and
+ * files only if it is enabled for shmem. madvise() succeeds
+ * either way, so the mode selected in sysfs is checked.
+ */
+static bool
+slab_thp_is_effective(bool is_shared)
+{
+	const char *path = is_shared ?
+		"/sys/kernel/mm/transparent_hugepage/shmem_enabled" :
+		"/sys/kernel/mm/transparent_hugepage/enabled";
+	FILE *f = fopen(path, "r");
+	if (f == NULL)
+		return false;
+	char buf[256];
+	bool rc = false;
+	if (fgets(buf, sizeof(buf), f) != NULL) {
+		/* The selected mode is in brackets: "always [madvise] never" */
+		char *mode = strchr(buf, '[');
+		rc = mode != NULL && strncmp(mode, "[never]", 7) != 0 &&
+		     strncmp(mode, "[deny]", 6) != 0;
+	}
+	fclose(f);
+	return rc;
+}
+#endif /* defined(MADV_HUGEPAGE) */
+
+/**
+ * Map memory for the arena according to its huge page
+ * and NUMA placement, falling back to regular pages.
+ */
+static void *
+slab_mmap(struct slab_arena *arena, size_t size)
+{
+	void *map = NULL;
+	bool is_hugetlb = false;
+	enum slab_hugepages hugepages = arena->placement.hugepages;
+#if defined(MAP_HUGETLB)
+	if (hugepages == SLAB_HUGEPAGES_HUGETLB &&
+	    size % SLAB_HUGE_PAGE_SIZE == 0) {
+		map = mmap_checked(size, arena->slab_size,
+				   arena->flags | MAP_HUGETLB);
+		if (map != NULL) {
+			__sync_add_and_fetch(&arena->hugetlb_size, size);
+			is_hugetlb = true;
+		} else {
+			__sync_add_and_fetch(&arena->placement_errors, 1);
+		}
+	}
+#endif
+	if (map == NULL) {
+		map = mmap_checked(size, arena->slab_size, arena->flags);
+		if (map == NULL)
+			return NULL;
+	}
+	if (!is_hugetlb && hugepages != SLAB_HUGEPAGES_OFF) {
+#if defined(MADV_HUGEPAGE)
+		/* Count only the advice which takes effect */
+		if (arena->is_thp_effective &&
+		    madvise(map, size, MADV_HUGEPAGE) == 0)
+			__sync_add_and_fetch(&arena->madvise_size, size);
+		else
+#endif
+			__sync_add_and_fetch(&arena->placement_errors, 1);
+	}
+	slab_mbind(arena, map, size);
+	return map;
+}
+
 #if 0
 /** This is a way to round things up without using a built-in. */
 static size_t
@@ -120,9 +266,22 @@ pow2round(size_t size)
 int
 slab_arena_create(struct slab_arena *arena, struct quota *quota,
 		  size_t prealloc, uint32_t slab_size, int flags)
+{
+	return slab_arena_create_with_placement(arena, quota, prealloc,
+						slab_size, flags, NULL);
+}
+
+int
+slab_arena_create_with_placement(struct slab_arena *arena,
+				 struct quota *quota, size_t prealloc,
+				 uint32_t slab_size, int flags,
+				 const struct slab_placement *placement)
 {
 	assert(flags & (MAP_PRIVATE | MAP_SHARED));
 	lf_lifo_init(&arena->cache);
+	lf_lifo_init(&arena->released);
+	arena->released_size = 0;
+	arena->release_errors = 0;
 	/*
 	 * Round up the user supplied data - it can come in
 	 * directly from the configuration file. Allow
@@ -142,26 +301,53 @@ slab_arena_create(struct slab_arena *arena, struct quota *quota,
 
 	arena->flags = flags;
 
+	memset(&arena->placement, 0, sizeof(arena->placement));
+	if (placement != NULL)
+		arena->placement = *placement;
+	arena->hugetlb_size = 0;
+	arena->madvise_size = 0;
+	arena->numa_size = 0;
+	arena->placement_errors = 0;
+	arena->is_thp_effective = false;
+#if defined(MADV_HUGEPAGE)
+	if (arena->placement.hugepages != SLAB_HUGEPAGES_OFF) {
+		arena->is_thp_effective =
+			slab_thp_is_effective(flags & MAP_SHARED);
+	}
+#endif
+	if (arena->placement.numa != SLAB_NUMA_DEFAULT &&
+	    arena->placement.numa_nodes == 0 &&
+	    slab_numa_nodes_online(&arena->placement.numa_nodes) != 0) {
+		/* Can't find out NUMA nodes, use the default policy */
+		arena->placement.numa = SLAB_NUMA_DEFAULT;
+		arena->placement_errors++;
+	}
+
 	if (arena->prealloc) {
-		arena->arena = mmap_checked(arena->prealloc,
-					    arena->slab_size,
-					    arena->flags);
+		arena->arena = slab_mmap(arena, arena->prealloc);
 	} else {
 		arena->arena = NULL;
 	}
 	return arena->prealloc && !arena->arena ? -1 : 0;
 }
 
+/** Check if a slab lies outside of the preallocated arena. */
+static inline bool
+slab_is_extra(struct slab_arena *arena, void *ptr)
+{
+	return arena->arena == NULL || ptr < arena->arena ||
+	       ptr >= arena->arena + arena->prealloc;
+}
+
 void
 slab_arena_destroy(struct slab_arena *arena)
 {
 	void *ptr;
 	size_t total = 0;
-	while ((ptr = lf_lifo_pop(&arena->cache))) {
-		if (arena->arena == NULL || ptr < arena->arena ||
-		    ptr >= arena->arena + arena->prealloc) {
+	while ((ptr = lf_lifo_pop(&arena->cache)) ||
+	       (ptr = lf_lifo_pop(&arena->released))) {
+		if (slab_is_extra(arena, ptr))
 			munmap_checked(ptr, arena->slab_size);
-		}
 		total += arena->slab_size;
 	}
 	if (arena->arena)
@@ -180,13 +366,19 @@ slab_map(struct slab_arena *arena)
 	if (quota_use(arena->quota, arena->slab_size) < 0)
 		return NULL;
 
+	/** Reuse the address range of a released slab. */
+	if ((ptr = lf_lifo_pop(&arena->released))) {
+		__sync_sub_and_fetch(&arena->released_size,
+				     arena->slab_size);
+		return ptr;
+	}
+
 	/** Need to allocate a new slab. */
 	size_t used = __sync_add_and_fetch(&arena->used, arena->slab_size);
 	if (used <= arena->prealloc)
 		return arena->arena + used - arena->slab_size;
 
-	return mmap_checked(arena->slab_size, arena->slab_size,
-			    arena->flags);
+	return slab_mmap(arena, arena->slab_size);
 }
 
 void
@@ -196,6 +388,28 @@ slab_unmap(struct slab_arena *arena, void *ptr)
 		lf_lifo_push(&arena->cache, ptr);
 }
 
+void
+slab_release(struct slab_arena *arena, void *ptr)
+{
+	if (ptr == NULL)
+		return;
+	/*
+	 * MADV_DONTNEED only drops the pages of a shared
+	 * mapping from the page table, while the memory stays
+	 * in shmem: punch a hole instead.
+	 */
+	int advice = MADV_DONTNEED;
+#if defined(MADV_REMOVE)
+	if (arena->flags & MAP_SHARED)
+		advice = MADV_REMOVE;
+#endif
+	if (madvise(ptr, arena->slab_size, advice) != 0)
+		__sync_add_and_fetch(&arena->release_errors, 1);
+	quota_release(arena->quota, arena->slab_size);
+	__sync_add_and_fetch(&arena->released_size, arena->slab_size);
+	lf_lifo_push(&arena->released, ptr);
+}
+
 void
 slab_arena_mprotect(struct slab_arena *arena)
 {
@@ -31,6 +31,7 @@
 #include "small/lf_lifo.h"
 #include <sys/mman.h>
 #include <limits.h>
+#include <stdbool.h>
 
 #if defined(__cplusplus)
 extern "C" {
@@ -40,7 +41,52 @@ enum {
 	/* Smallest possible slab size. */
 	SLAB_MIN_SIZE = ((size_t)USHRT_MAX) + 1,
 	/** The largest allowed amount of memory of a single arena. */
-	SMALL_UNLIMITED = SIZE_MAX/2 + 1
+	SMALL_UNLIMITED = SIZE_MAX/2 + 1,
+	/**
+	 * Size of an explicit huge page. Mappings which are
+	 * not a multiple of it are never backed with MAP_HUGETLB.
+	 */
+	SLAB_HUGE_PAGE_SIZE = 2 * 1024 * 1024
+};
+
+/** How arena memory is backed with huge pages. */
+enum slab_hugepages {
+	/** Use regular pages. */
+	SLAB_HUGEPAGES_OFF,
+	/** Ask for transparent huge pages with MADV_HUGEPAGE. */
+	SLAB_HUGEPAGES_MADVISE,
+	/**
+	 * Map explicit huge pages with MAP_HUGETLB, fall back
+	 * to MADV_HUGEPAGE if none are available.
+	 */
+	SLAB_HUGEPAGES_HUGETLB,
+	slab_hugepages_MAX
+};
+
+extern const char *slab_hugepages_strs[];
+
+/** NUMA memory policy of arena memory. */
+enum slab_numa {
+	/** Use the policy of the allocating thread. */
+	SLAB_NUMA_DEFAULT,
+	/** Interleave pages across nodes. */
+	SLAB_NUMA_INTERLEAVE,
+	/** Allocate pages only on the given nodes. */
+	SLAB_NUMA_BIND,
+	slab_numa_MAX
+};
+
+extern const char *slab_numa_strs[];
+
+/** Huge page and NUMA placement of arena memory. */
+struct slab_placement {
+	enum slab_hugepages hugepages;
+	enum slab_numa numa;
+	/**
+	 * A bitmask of NUMA nodes for the policy,
+	 * 0 means all online nodes.
+	 */
+	unsigned long numa_nodes;
 };
 
 /**
@@ -48,7 +94,8 @@ enum {
  * MT-safe.
  * Uses a lock-free LIFO to maintain a cache of used slabs.
  * Uses a lock-free quota to limit allocating memory.
- * Never returns memory to the operating system.
+ * Returns memory of slabs to the operating system only
+ * when asked to with slab_release().
  */
 struct slab_arena {
 	/**
@@ -58,6 +105,17 @@ struct slab_arena {
 	 * used to recycle them.
 	 */
 	struct lf_lifo cache;
+	/**
+	 * A lock free list of slabs which memory has been
+	 * returned to the operating system. Such slabs keep
+	 * their address range, but are not charged to the
+	 * quota until mapped again.
+	 */
+	struct lf_lifo released;
+	/** How much memory is in released slabs. */
+	size_t released_size;
+	/** How many times memory of a slab could not be released. */
+	size_t release_errors;
 	/** A preallocated arena of size = prealloc. */
 	void *arena;
 	/**
@@ -96,6 +154,27 @@ struct slab_arena {
 	 * mmap() flags: MAP_SHARED or MAP_PRIVATE
 	 */
 	int flags;
+	/** Requested huge page and NUMA placement. */
+	struct slab_placement placement;
+	/**
+	 * True if MADV_HUGEPAGE takes effect on the arena
+	 * mappings. Checked once when the arena is created.
+	 */
+	bool is_thp_effective;
+	/** How much memory is mapped with MAP_HUGETLB. */
+	size_t hugetlb_size;
+	/**
+	 * How much memory is advised with MADV_HUGEPAGE, where
+	 * transparent huge pages are enabled for the mapping.
+	 */
+	size_t madvise_size;
+	/** How much memory is bound with the NUMA policy. */
+	size_t numa_size;
+	/**
+	 * How many times the requested placement could not
+	 * be applied and a fallback was used.
+	 */
+	size_t placement_errors;
 };
 
 /** Initialize an arena.  */
@@ -103,6 +182,28 @@ int
 slab_arena_create(struct slab_arena *arena, struct quota *quota,
 		  size_t prealloc, uint32_t slab_size, int flags);
 
+/**
+ * Initialize an arena which memory is backed with huge pages
+ * and placed on NUMA nodes as requested in @a placement.
+ * A placement which can not be applied is not an error:
+ * regular mappings are used instead and
+ * arena->placement_errors is incremented.
+ */
+int
+slab_arena_create_with_placement(struct slab_arena *arena,
+				 struct quota *quota, size_t prealloc,
+				 uint32_t slab_size, int flags,
+				 const struct slab_placement *placement);
+
+/**
+ * Parse a list of NUMA nodes, such as "0-2,4", to a bitmask.
+ * @retval 0 on success
+ * @retval -1 if the list is malformed or contains a node
+ * which doesn't fit into the mask
+ */
+int
+slab_numa_nodes_parse(const char *str, unsigned long *nodes);
+
 /** Destroy an arena. */
 void
 slab_arena_destroy(struct slab_arena *arena);
@@ -115,6 +216,14 @@ slab_map(struct slab_arena *arena);
 void
 slab_unmap(struct slab_arena *arena, void *ptr);
 
+/**
+ * Give memory of a slab back to the operating system and
+ * release its quota. The address range stays reserved and
+ * is reused by slab_map(), which finds it zero-filled.
+ */
+void
+slab_release(struct slab_arena *arena, void *ptr);
+
 /** mprotect() the preallocated arena. */
 void
 slab_arena_mprotect(struct slab_arena *arena);
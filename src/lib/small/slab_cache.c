@@ -121,6 +121,14 @@ slab_create(struct slab *slab, uint8_t order, size_t size)
 	slab->size = size;
 }
 
+/** Memory in free slabs of the largest order. */
+static inline size_t
+slab_cache_free_size(struct slab_cache *cache)
+{
+	struct slab_list *list = &cache->orders[cache->order_max];
+	return list->stats.total - list->stats.used;
+}
+
 static inline struct slab *
 slab_buddy(struct slab_cache *cache, struct slab *slab)
 {
@@ -180,6 +188,7 @@ slab_cache_create(struct slab_cache *cache, struct slab_arena *arena)
 	slab_list_create(&cache->allocated);
 	for (uint8_t i = 0; i <= cache->order_max; i++)
 		slab_list_create(&cache->orders[i]);
+	cache->idle_size = 0;
 	slab_cache_set_thread(cache);
 }
 
@@ -247,6 +256,9 @@ slab_get_with_order(struct slab_cache *cache, uint8_t order)
 	}
 	slab_set_used(cache, slab);
 	slab_assert(cache, slab);
+	size_t free_size = slab_cache_free_size(cache);
+	if (cache->idle_size > free_size)
+		cache->idle_size = free_size;
 	return slab;
 }
 
@@ -320,6 +332,45 @@ slab_put(struct slab_cache *cache, struct slab *slab)
 			next_in_list);
 }
 
+/**
+ * Release up to @a size bytes of free slabs of the largest
+ * order, starting from the least recently used.
+ */
+static size_t
+slab_cache_release_tail(struct slab_cache *cache, size_t size)
+{
+	struct slab_list *list = &cache->orders[cache->order_max];
+	size_t released = 0;
+	while (released < size && !rlist_empty(&list->slabs)) {
+		struct slab *slab = rlist_last_entry(&list->slabs,
+						     struct slab,
+						     next_in_list);
+		slab_assert(cache, slab);
+		assert(slab_is_free(slab));
+		slab_list_del(list, slab, next_in_list);
+		slab_list_del(&cache->allocated, slab, next_in_cache);
+		released += slab->size;
+		slab_release(cache->arena, slab);
+	}
+	return released;
+}
+
+size_t
+slab_cache_trim(struct slab_cache *cache)
+{
+	size_t released = slab_cache_release_tail(cache, cache->idle_size);
+	cache->idle_size = slab_cache_free_size(cache);
+	return released;
+}
+
+size_t
+slab_cache_release(struct slab_cache *cache)
+{
+	size_t released = slab_cache_release_tail(cache, SIZE_MAX);
+	cache->idle_size = 0;
+	return released;
+}
+
 void
 slab_cache_check(struct slab_cache *cache)
 {
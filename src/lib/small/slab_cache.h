@@ -160,6 +160,13 @@ struct slab_cache {
 	 * next_in_list link may be reused for some other purpose.
          */
 	struct slab_list orders[ORDER_MAX+1];
+	/**
+	 * The least amount of memory in free slabs of the
+	 * largest order since the previous slab_cache_trim().
+	 * The free list is LIFO, so this many bytes at its
+	 * tail have stayed unused for the whole period.
+	 */
+	size_t idle_size;
 #ifndef _NDEBUG
 	pthread_t thread_id;
 #endif
@@ -183,6 +190,25 @@ slab_put(struct slab_cache *cache, struct slab *slab);
 struct slab *
 slab_from_ptr(struct slab_cache *cache, void *ptr, uint8_t order);
 
+/**
+ * Return free slabs of the largest order which have not been
+ * used since the previous call to the arena, which releases
+ * their memory to the operating system (@sa slab_release()).
+ * Calling this periodically releases slabs idle for at least
+ * a period.
+ * @return the amount of released memory
+ */
+size_t
+slab_cache_trim(struct slab_cache *cache);
+
+/**
+ * Release memory of all free slabs of the largest order
+ * to the operating system.
+ * @return the amount of released memory
+ */
+size_t
+slab_cache_release(struct slab_cache *cache);
+
 /* Aligned size of slab meta. */
 static inline uint32_t
 slab_sizeof()
@@ -32,14 +32,13 @@
 #include <string.h>
 
 enum {
-	/** Step size for stepped pools, in bytes */
-	STEP_SIZE = 8,
 	/**
-	 * LB stands for logarithm with binary base, this constant
-	 * is used for bit shifts, when we need to divide by
-	 * STEP_SIZE.
+	 * Default step size for stepped pools, in bytes,
+	 * keeps objects aligned by 8 bytes.
 	 */
-	STEP_SIZE_LB = 3,
+	STEP_SIZE = 8,
+	/** Stepped pools cover this many sizes. */
+	STEP_POOL_RANGE = 256,
 };
 
 rb_proto(, factor_tree_, factor_tree_t, struct factor_pool)
@@ -98,20 +97,35 @@ void
 small_alloc_create(struct small_alloc *alloc, struct slab_cache *cache,
 		   uint32_t objsize_min, float alloc_factor)
 {
+	small_alloc_create_with_step(alloc, cache, objsize_min,
+				     alloc_factor, STEP_SIZE);
+}
+
+void
+small_alloc_create_with_step(struct small_alloc *alloc,
+			     struct slab_cache *cache, uint32_t objsize_min,
+			     float alloc_factor, uint32_t step_size)
+{
+	assert(step_size >= sizeof(uint32_t) &&
+	       (step_size & (step_size - 1)) == 0);
 	alloc->cache = cache;
+	alloc->step_size = step_size;
+	alloc->step_size_lb = __builtin_ctz(step_size);
+	alloc->step_pool_count = STEP_POOL_RANGE / step_size;
+	assert(alloc->step_pool_count <= STEP_POOL_MAX);
 	/* Align sizes. */
-	objsize_min = small_align(objsize_min, STEP_SIZE);
+	objsize_min = small_align(objsize_min, step_size);
 	/* Make sure at least 4 largest objects can fit in a slab. */
 	alloc->objsize_max =
 		mempool_objsize_max(slab_order_size(cache, cache->order_max));
-	assert(alloc->objsize_max > objsize_min + STEP_POOL_MAX * STEP_SIZE);
+	assert(alloc->objsize_max > objsize_min + STEP_POOL_RANGE);
 
 	struct mempool *step_pool;
 	for (step_pool = alloc->step_pools;
-	     step_pool < alloc->step_pools + STEP_POOL_MAX;
+	     step_pool < alloc->step_pools + alloc->step_pool_count;
 	     step_pool++) {
 		mempool_create(step_pool, alloc->cache, objsize_min);
-		objsize_min += STEP_SIZE;
+		objsize_min += step_size;
 	}
 	alloc->step_pool_objsize_max = (step_pool - 1)->objsize;
 	if (alloc_factor > 2.0)
@@ -210,11 +224,11 @@ smalloc_nothrow(struct small_alloc *alloc, size_t size)
 			idx = 0;
 		else {
 			idx = (size - alloc->step_pools[0].objsize
-			       + STEP_SIZE - 1) >> STEP_SIZE_LB;
+			       + alloc->step_size - 1) >> alloc->step_size_lb;
 		}
 		pool = &alloc->step_pools[idx];
 		assert(size <= pool->objsize &&
-		       (size + STEP_SIZE > pool->objsize || idx == 0));
+		       (size + alloc->step_size > pool->objsize || idx == 0));
 	} else {
 		struct factor_pool pattern;
 		pattern.pool.objsize = size;
@@ -257,9 +271,9 @@ mempool_find(struct small_alloc *alloc, size_t size)
 			pool = &alloc->step_pools[0];
 		} else {
 			int idx = (size - alloc->step_pools[0].objsize
-				   + STEP_SIZE - 1) >> STEP_SIZE_LB;
+				   + alloc->step_size - 1) >> alloc->step_size_lb;
 			pool = &alloc->step_pools[idx];
-			assert(size + STEP_SIZE > pool->objsize);
+			assert(size + alloc->step_size > pool->objsize);
 		}
 	} else {
 		/* Allocated in a factor pool. */
@@ -314,6 +328,19 @@ smfree_delayed(struct small_alloc *alloc, void *ptr, size_t size)
 	}
 }
 
+bool
+small_should_relocate(struct small_alloc *alloc, void *ptr, size_t size)
+{
+	/*
+	 * During a snapshot the old copy of an object could
+	 * not be freed anyway, and writing a new copy would
+	 * only make the snapshot process touch more pages.
+	 */
+	if (alloc->is_delayed_free_mode)
+		return false;
+	return mempool_should_relocate(mempool_find(alloc, size), ptr);
+}
+
 /** Simplify iteration over small allocator mempools. */
 struct mempool_iterator
 {
@@ -334,7 +361,8 @@ mempool_iterator_create(struct mempool_iterator *it,
 struct mempool *
 mempool_iterator_next(struct mempool_iterator *it)
 {
-	if (it->step_pool < it->alloc->step_pools + STEP_POOL_MAX)
+	if (it->step_pool < it->alloc->step_pools +
+			    it->alloc->step_pool_count)
 		return it->step_pool++;
 
 	if (it->factor_pool) {
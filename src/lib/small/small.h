@@ -45,13 +45,13 @@ extern "C" {
  * There are two containers of pools:
  *
  * pools for objects of size 8-500 bytes are stored in an array,
- * where pool->objsize of each array member is a multiple of 8-16
- * (value defined in STEP_SIZE constant). These are
+ * where pool->objsize of each array member is a multiple of 8
+ * (the step size, 4 can be chosen at creation). These are
  * "stepped" pools, since pool->objsize of each next pool in the
  * array differs from the  previous size by a fixed step size.
  *
- * For example, there is a pool for size range 16-32,
- * another one for 32-48, 48-64, etc. This makes the look up
+ * For example, there is a pool for size range 16-24,
+ * another one for 24-32, 32-40, etc. This makes the look up
  * procedure for small allocations just a matter of getting an
  * array index via a bit shift. All stepped pools are initialized
  * when an instance of small_alloc is created.
@@ -84,8 +84,8 @@ extern "C" {
 
 /** Basic constants of small object allocator. */
 enum {
-	/** How many stepped pools there is. */
-	STEP_POOL_MAX = 32,
+	/** How many stepped pools there can be. */
+	STEP_POOL_MAX = 64,
 	/** How many factored pools there can be. */
 	FACTOR_POOL_MAX = 256,
 };
@@ -125,6 +125,15 @@ typedef rb_tree(struct factor_pool) factor_tree_t;
 struct small_alloc {
 	struct slab_cache *cache;
 	uint32_t step_pool_objsize_max;
+	/**
+	 * The difference between objsize of adjacent stepped
+	 * pools. Objects are aligned by it.
+	 */
+	uint32_t step_size;
+	/** log2(step_size), to divide by it with a shift. */
+	uint32_t step_size_lb;
+	/** The number of stepped pools in use. */
+	uint32_t step_pool_count;
 	/**
 	 * All slabs in all pools must be of the same order,
 	 * otherwise small_free() has no way to derive from
@@ -160,11 +169,27 @@ struct small_alloc {
 	bool is_delayed_free_mode;
 };
 
-/** Initialize a small memory allocator. */
+/**
+ * Initialize a small memory allocator. Objects are aligned
+ * by 8 bytes.
+ */
 void
 small_alloc_create(struct small_alloc *alloc, struct slab_cache *cache,
 		   uint32_t objsize_min, float alloc_factor);
 
+/**
+ * Initialize a small memory allocator which stepped pools
+ * differ by @a step_size bytes, a power of 2 not less than 4.
+ * A smaller step wastes less memory per object, but objects
+ * in stepped pools are only aligned by the step, so they
+ * must not hold pointers or 8-byte integers, nor be freed
+ * with smfree_delayed().
+ */
+void
+small_alloc_create_with_step(struct small_alloc *alloc,
+			     struct slab_cache *cache, uint32_t objsize_min,
+			     float alloc_factor, uint32_t step_size);
+
 /**
  * Enter or leave delayed mode - in delayed mode smfree_delayed()
  * doesn't free chunks but puts them into a pool.
@@ -206,6 +231,17 @@ smfree(struct small_alloc *alloc, void *ptr, size_t size);
 void
 smfree_delayed(struct small_alloc *alloc, void *ptr, size_t size);
 
+/**
+ * Check if a chunk allocated by the small allocator should be
+ * moved to a new place to let its slab be freed,
+ * @sa mempool_should_relocate(). Moving an object is up to the
+ * caller: allocate a new chunk, copy the data, update all
+ * references and free the old chunk.
+ * Always false in delayed free mode.
+ */
+bool
+small_should_relocate(struct small_alloc *alloc, void *ptr, size_t size);
+
 /**
  * @brief Return an unique index associated with a chunk allocated
  * by the allocator.
@@ -239,6 +239,20 @@ lbox_fiber_statof(struct fiber *f, void *cb_ctx)
 	lua_pushnumber(L, f->csw);
 	lua_settable(L, -3);
 
+	lua_pushstring(L, "cpu_time");
+	lua_pushnumber(L, fiber_cpu_time(f));
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "memory");
+	lua_createtable(L, 0, 3);
+	lua_pushnumber(L, region_used(&f->gc));
+	lua_setfield(L, -2, "used");
+	lua_pushnumber(L, region_total(&f->gc));
+	lua_setfield(L, -2, "total");
+	lua_pushnumber(L, fiber_gc_peak(f));
+	lua_setfield(L, -2, "peak");
+	lua_settable(L, -3);
+
 #ifdef ENABLE_BACKTRACE
 	lua_pushstring(L, "backtrace");
 	lua_newtable(L);
@@ -47,6 +47,7 @@ extern "C" {
 #include "coeio.h"
 #include "lua/fiber.h"
 #include "lua/ipc.h"
+#include "lua/offload.h"
 #include "lua/errno.h"
 #include "lua/bsdsocket.h"
 #include "lua/utils.h"
@@ -323,6 +324,7 @@ tarantool_lua_init(const char *tarantool_bin, int argc, char **argv)
 	tarantool_lua_utils_init(L);
 	tarantool_lua_fiber_init(L);
 	tarantool_lua_ipc_init(L);
+	tarantool_lua_offload_init(L);
 	tarantool_lua_errno_init(L);
 	tarantool_lua_fio_init(L);
 	tarantool_lua_bsdsocket_init(L);
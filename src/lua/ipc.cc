@@ -40,6 +40,10 @@ extern "C" {
 #include "lua/utils.h"
 
 static const char channel_lib[]   = "fiber.channel";
+static const char latch_lib[]     = "fiber.latch";
+static const char rwlock_lib[]    = "fiber.rwlock";
+static const char cond_lib[]      = "fiber.cond";
+static const char sem_lib[]       = "fiber.semaphore";
 
 #define BROADCAST_MASK	(((size_t)1) << (CHAR_BIT * sizeof(size_t) - 1))
 
@@ -287,6 +291,300 @@ lbox_ipc_channel_is_closed(struct lua_State *L)
 	return 1;
 }
 
+/************ latch, rwlock, cond, semaphore ***************/
+
+/** Get an optional timeout argument. */
+static ev_tstamp
+lbox_ipc_totimeout(struct lua_State *L, int idx)
+{
+	if (lua_isnoneornil(L, idx))
+		return TIMEOUT_INFINITY;
+	if (!lua_isnumber(L, idx))
+		luaL_error(L, "timeout must be a number");
+	ev_tstamp timeout = lua_tonumber(L, idx);
+	if (timeout < 0)
+		luaL_error(L, "wrong timeout");
+	return timeout;
+}
+
+static void
+lbox_ipc_pushstat(struct lua_State *L, struct ipc_stat *stat)
+{
+	lua_createtable(L, 0, 3);
+	luaL_pushuint64(L, stat->acquired);
+	lua_setfield(L, -2, "acquired");
+	luaL_pushuint64(L, stat->waited);
+	lua_setfield(L, -2, "waited");
+	luaL_pushuint64(L, stat->timedout);
+	lua_setfield(L, -2, "timedout");
+}
+
+static int
+lbox_ipc_latch(struct lua_State *L)
+{
+	struct ipc_latch *latch = (struct ipc_latch *)
+		lua_newuserdata(L, sizeof(*latch));
+	ipc_latch_create(latch);
+	luaL_getmetatable(L, latch_lib);
+	lua_setmetatable(L, -2);
+	return 1;
+}
+
+static inline struct ipc_latch *
+lbox_check_latch(struct lua_State *L, int narg)
+{
+	return (struct ipc_latch *) luaL_checkudata(L, narg, latch_lib);
+}
+
+static int
+lbox_ipc_latch_gc(struct lua_State *L)
+{
+	ipc_latch_destroy(lbox_check_latch(L, 1));
+	return 0;
+}
+
+static int
+lbox_ipc_latch_lock(struct lua_State *L)
+{
+	struct ipc_latch *latch = lbox_check_latch(L, 1);
+	ev_tstamp timeout = lbox_ipc_totimeout(L, 2);
+	if (ipc_latch_owner(latch) == fiber())
+		luaL_error(L, "latch is already locked by the current fiber");
+	lua_pushboolean(L, ipc_latch_lock_timeout(latch, timeout) == 0);
+	return 1;
+}
+
+static int
+lbox_ipc_latch_trylock(struct lua_State *L)
+{
+	struct ipc_latch *latch = lbox_check_latch(L, 1);
+	lua_pushboolean(L, ipc_latch_trylock(latch));
+	return 1;
+}
+
+static int
+lbox_ipc_latch_unlock(struct lua_State *L)
+{
+	struct ipc_latch *latch = lbox_check_latch(L, 1);
+	if (ipc_latch_owner(latch) != fiber())
+		luaL_error(L, "latch is not locked by the current fiber");
+	ipc_latch_unlock(latch);
+	return 0;
+}
+
+static int
+lbox_ipc_latch_stat(struct lua_State *L)
+{
+	lbox_ipc_pushstat(L, &lbox_check_latch(L, 1)->stat);
+	return 1;
+}
+
+static int
+lbox_ipc_rwlock(struct lua_State *L)
+{
+	struct ipc_rwlock *rwlock = (struct ipc_rwlock *)
+		lua_newuserdata(L, sizeof(*rwlock));
+	ipc_rwlock_create(rwlock);
+	luaL_getmetatable(L, rwlock_lib);
+	lua_setmetatable(L, -2);
+	return 1;
+}
+
+static inline struct ipc_rwlock *
+lbox_check_rwlock(struct lua_State *L, int narg)
+{
+	return (struct ipc_rwlock *) luaL_checkudata(L, narg, rwlock_lib);
+}
+
+static int
+lbox_ipc_rwlock_gc(struct lua_State *L)
+{
+	ipc_rwlock_destroy(lbox_check_rwlock(L, 1));
+	return 0;
+}
+
+static int
+lbox_ipc_rwlock_rdlock(struct lua_State *L)
+{
+	struct ipc_rwlock *rwlock = lbox_check_rwlock(L, 1);
+	ev_tstamp timeout = lbox_ipc_totimeout(L, 2);
+	lua_pushboolean(L, ipc_rwlock_rdlock_timeout(rwlock, timeout) == 0);
+	return 1;
+}
+
+static int
+lbox_ipc_rwlock_wrlock(struct lua_State *L)
+{
+	struct ipc_rwlock *rwlock = lbox_check_rwlock(L, 1);
+	ev_tstamp timeout = lbox_ipc_totimeout(L, 2);
+	if (rwlock->writer == fiber())
+		luaL_error(L, "rwlock is already locked by the current fiber");
+	lua_pushboolean(L, ipc_rwlock_wrlock_timeout(rwlock, timeout) == 0);
+	return 1;
+}
+
+static int
+lbox_ipc_rwlock_tryrdlock(struct lua_State *L)
+{
+	lua_pushboolean(L, ipc_rwlock_tryrdlock(lbox_check_rwlock(L, 1)));
+	return 1;
+}
+
+static int
+lbox_ipc_rwlock_trywrlock(struct lua_State *L)
+{
+	lua_pushboolean(L, ipc_rwlock_trywrlock(lbox_check_rwlock(L, 1)));
+	return 1;
+}
+
+static int
+lbox_ipc_rwlock_unlock(struct lua_State *L)
+{
+	struct ipc_rwlock *rwlock = lbox_check_rwlock(L, 1);
+	if (rwlock->writer != NULL ? rwlock->writer != fiber() :
+	    rwlock->readers == 0)
+		luaL_error(L, "rwlock is not locked by the current fiber");
+	ipc_rwlock_unlock(rwlock);
+	return 0;
+}
+
+static int
+lbox_ipc_rwlock_stat(struct lua_State *L)
+{
+	lbox_ipc_pushstat(L, &lbox_check_rwlock(L, 1)->stat);
+	return 1;
+}
+
+static int
+lbox_ipc_cond(struct lua_State *L)
+{
+	struct ipc_cond *cond = (struct ipc_cond *)
+		lua_newuserdata(L, sizeof(*cond));
+	ipc_cond_create(cond);
+	luaL_getmetatable(L, cond_lib);
+	lua_setmetatable(L, -2);
+	return 1;
+}
+
+static inline struct ipc_cond *
+lbox_check_cond(struct lua_State *L, int narg)
+{
+	return (struct ipc_cond *) luaL_checkudata(L, narg, cond_lib);
+}
+
+static int
+lbox_ipc_cond_gc(struct lua_State *L)
+{
+	ipc_cond_destroy(lbox_check_cond(L, 1));
+	return 0;
+}
+
+/** cond:wait([timeout [, latch]]) */
+static int
+lbox_ipc_cond_wait(struct lua_State *L)
+{
+	struct ipc_cond *cond = lbox_check_cond(L, 1);
+	ev_tstamp timeout = lbox_ipc_totimeout(L, 2);
+	struct ipc_latch *latch = NULL;
+	if (!lua_isnoneornil(L, 3)) {
+		latch = lbox_check_latch(L, 3);
+		if (ipc_latch_owner(latch) != fiber())
+			luaL_error(L, "latch is not locked by the current fiber");
+	}
+	lua_pushboolean(L, ipc_cond_wait_timeout(cond, latch, timeout) == 0);
+	return 1;
+}
+
+static int
+lbox_ipc_cond_signal(struct lua_State *L)
+{
+	ipc_cond_signal(lbox_check_cond(L, 1));
+	return 0;
+}
+
+static int
+lbox_ipc_cond_broadcast(struct lua_State *L)
+{
+	ipc_cond_broadcast(lbox_check_cond(L, 1));
+	return 0;
+}
+
+static int
+lbox_ipc_cond_stat(struct lua_State *L)
+{
+	lbox_ipc_pushstat(L, &lbox_check_cond(L, 1)->stat);
+	return 1;
+}
+
+static int
+lbox_ipc_sem(struct lua_State *L)
+{
+	lua_Integer count = 1;
+	if (lua_gettop(L) > 0) {
+		if (lua_gettop(L) != 1 || !lua_isnumber(L, 1))
+			luaL_error(L, "fiber.semaphore(count): bad arguments");
+		count = lua_tointeger(L, 1);
+		if (count < 0)
+			luaL_error(L, "fiber.semaphore(count): negative count");
+	}
+	struct ipc_sem *sem = (struct ipc_sem *)
+		lua_newuserdata(L, sizeof(*sem));
+	ipc_sem_create(sem, count);
+	luaL_getmetatable(L, sem_lib);
+	lua_setmetatable(L, -2);
+	return 1;
+}
+
+static inline struct ipc_sem *
+lbox_check_sem(struct lua_State *L, int narg)
+{
+	return (struct ipc_sem *) luaL_checkudata(L, narg, sem_lib);
+}
+
+static int
+lbox_ipc_sem_gc(struct lua_State *L)
+{
+	ipc_sem_destroy(lbox_check_sem(L, 1));
+	return 0;
+}
+
+static int
+lbox_ipc_sem_acquire(struct lua_State *L)
+{
+	struct ipc_sem *sem = lbox_check_sem(L, 1);
+	ev_tstamp timeout = lbox_ipc_totimeout(L, 2);
+	lua_pushboolean(L, ipc_sem_acquire_timeout(sem, timeout) == 0);
+	return 1;
+}
+
+static int
+lbox_ipc_sem_tryacquire(struct lua_State *L)
+{
+	lua_pushboolean(L, ipc_sem_tryacquire(lbox_check_sem(L, 1)));
+	return 1;
+}
+
+static int
+lbox_ipc_sem_release(struct lua_State *L)
+{
+	ipc_sem_release(lbox_check_sem(L, 1));
+	return 0;
+}
+
+static int
+lbox_ipc_sem_count(struct lua_State *L)
+{
+	lua_pushinteger(L, lbox_check_sem(L, 1)->count);
+	return 1;
+}
+
+static int
+lbox_ipc_sem_stat(struct lua_State *L)
+{
+	lbox_ipc_pushstat(L, &lbox_check_sem(L, 1)->stat);
+	return 1;
+}
+
 void
 tarantool_lua_ipc_init(struct lua_State *L)
 {
@@ -307,8 +605,55 @@ tarantool_lua_ipc_init(struct lua_State *L)
 	};
 	luaL_register_type(L, channel_lib, channel_meta);
 
+	static const struct luaL_reg latch_meta[] = {
+		{"__gc",	lbox_ipc_latch_gc},
+		{"lock",	lbox_ipc_latch_lock},
+		{"trylock",	lbox_ipc_latch_trylock},
+		{"unlock",	lbox_ipc_latch_unlock},
+		{"stat",	lbox_ipc_latch_stat},
+		{NULL, NULL}
+	};
+	luaL_register_type(L, latch_lib, latch_meta);
+
+	static const struct luaL_reg rwlock_meta[] = {
+		{"__gc",	lbox_ipc_rwlock_gc},
+		{"rdlock",	lbox_ipc_rwlock_rdlock},
+		{"wrlock",	lbox_ipc_rwlock_wrlock},
+		{"tryrdlock",	lbox_ipc_rwlock_tryrdlock},
+		{"trywrlock",	lbox_ipc_rwlock_trywrlock},
+		{"unlock",	lbox_ipc_rwlock_unlock},
+		{"stat",	lbox_ipc_rwlock_stat},
+		{NULL, NULL}
+	};
+	luaL_register_type(L, rwlock_lib, rwlock_meta);
+
+	static const struct luaL_reg cond_meta[] = {
+		{"__gc",	lbox_ipc_cond_gc},
+		{"wait",	lbox_ipc_cond_wait},
+		{"signal",	lbox_ipc_cond_signal},
+		{"broadcast",	lbox_ipc_cond_broadcast},
+		{"stat",	lbox_ipc_cond_stat},
+		{NULL, NULL}
+	};
+	luaL_register_type(L, cond_lib, cond_meta);
+
+	static const struct luaL_reg sem_meta[] = {
+		{"__gc",	lbox_ipc_sem_gc},
+		{"acquire",	lbox_ipc_sem_acquire},
+		{"tryacquire",	lbox_ipc_sem_tryacquire},
+		{"release",	lbox_ipc_sem_release},
+		{"count",	lbox_ipc_sem_count},
+		{"stat",	lbox_ipc_sem_stat},
+		{NULL, NULL}
+	};
+	luaL_register_type(L, sem_lib, sem_meta);
+
 	static const struct luaL_reg ipc_meta[] = {
 		{"channel",	lbox_ipc_channel},
+		{"latch",	lbox_ipc_latch},
+		{"rwlock",	lbox_ipc_rwlock},
+		{"cond",	lbox_ipc_cond},
+		{"semaphore",	lbox_ipc_sem},
 		{NULL, NULL}
 	};
 
@@ -0,0 +1,345 @@
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "lua/offload.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+extern "C" {
+#include <lua.h>
+#include <lauxlib.h>
+#include <lualib.h>
+} /* extern "C" */
+
+#include <offload.h>
+#include "lua/utils.h"
+#include "lua/digest.h"
+#include "third_party/base64.h"
+
+/*
+ * Lua bindings of the offload pool. The arguments are Lua
+ * strings, which are read by the workers in place: they are
+ * anchored on the Lua stack of the caller, which waits for
+ * the call to complete. The results are malloc()'ed by the
+ * workers and copied to Lua strings by the caller.
+ */
+
+/** {{{ offload.call() */
+
+static ssize_t
+offload_buf_cb(va_list ap)
+{
+	offload_buf_f func = va_arg(ap, offload_buf_f);
+	const char *data = va_arg(ap, const char *);
+	size_t size = va_arg(ap, size_t);
+	char **result = va_arg(ap, char **);
+	size_t *result_size = va_arg(ap, size_t *);
+	*result = func(data, size, result_size);
+	return *result == NULL ? -1 : 0;
+}
+
+static int
+lbox_offload_call(struct lua_State *L)
+{
+	if (lua_gettop(L) != 2 || lua_type(L, 1) != LUA_TSTRING ||
+	    lua_type(L, 2) != LUA_TSTRING)
+		luaL_error(L, "Usage: offload.call(name, data)");
+	const char *name = lua_tostring(L, 1);
+	offload_buf_f func = offload_find(name);
+	if (func == NULL)
+		luaL_error(L, "offload.call: no such function '%s'", name);
+	size_t size;
+	const char *data = lua_tolstring(L, 2, &size);
+	char *result = NULL;
+	size_t result_size = 0;
+	if (offload_call(offload_buf_cb, func, data, size, &result,
+			 &result_size) != 0) {
+		if (errno == 0) {
+			luaL_error(L, "offload.call: %s: the function "
+				   "returned NULL", name);
+		}
+		luaL_error(L, "offload.call: %s: %s", name, strerror(errno));
+	}
+	lua_pushlstring(L, result, result_size);
+	free(result);
+	return 1;
+}
+
+static int
+lbox_offload_register(struct lua_State *L)
+{
+	if (lua_gettop(L) != 2 || lua_type(L, 1) != LUA_TSTRING ||
+	    lua_type(L, 2) != LUA_TCDATA)
+		luaL_error(L, "Usage: offload.register(name, func)");
+	uint32_t ctypeid;
+	/* A function or a function pointer holds the address. */
+	void *cdata = luaL_checkcdata(L, 2, &ctypeid);
+	CTState *cts = ctype_cts(L);
+	CType *ct = ctype_raw(cts, ctypeid);
+	if (ctype_isptr(ct->info))
+		ct = ctype_rawchild(cts, ct);
+	if (! ctype_isfunc(ct->info))
+		luaL_error(L, "offload.register: func must be a C function");
+	offload_buf_f func = *(offload_buf_f *) cdata;
+	if (func == NULL)
+		luaL_error(L, "offload.register: a NULL function");
+	if (offload_register(lua_tostring(L, 1), func) != 0) {
+		luaL_error(L, "offload.register: the name is too long "
+			   "or too many functions");
+	}
+	return 0;
+}
+
+/** }}} */
+
+/** {{{ offload.eval() */
+
+enum { OFFLOAD_CHUNKS_MAX = 256 };
+
+/** The Lua state of a worker, created on the first eval. */
+static __thread struct lua_State *offload_L;
+/** The number of compiled chunks in the cache. */
+static __thread int offload_chunks_count;
+
+/** Close the Lua state of a worker when the pool stops. */
+static void
+offload_eval_cleanup()
+{
+	if (offload_L == NULL)
+		return;
+	lua_close(offload_L);
+	offload_L = NULL;
+	offload_chunks_count = 0;
+}
+
+static const char offload_chunks[] = "offload.chunks";
+
+static char *
+offload_strdup(const char *str, size_t size)
+{
+	char *copy = (char *) malloc(size > 0 ? size : 1);
+	if (copy != NULL)
+		memcpy(copy, str, size);
+	return copy;
+}
+
+/**
+ * Push the compiled chunk, from the cache if it has already
+ * been compiled by this worker.
+ * @retval non-zero with the error message on the stack
+ */
+static int
+offload_load_chunk(struct lua_State *L, const char *code, size_t code_size)
+{
+	lua_getfield(L, LUA_REGISTRYINDEX, offload_chunks);
+	lua_pushlstring(L, code, code_size);
+	lua_rawget(L, -2);
+	if (! lua_isnil(L, -1)) {
+		lua_remove(L, -2);
+		return 0;
+	}
+	lua_pop(L, 1);
+	if (offload_chunks_count == OFFLOAD_CHUNKS_MAX) {
+		/* Most likely, the code is generated: start over. */
+		lua_pop(L, 1);
+		lua_newtable(L);
+		lua_pushvalue(L, -1);
+		lua_setfield(L, LUA_REGISTRYINDEX, offload_chunks);
+		offload_chunks_count = 0;
+	}
+	int rc = luaL_loadbuffer(L, code, code_size, "=offload.eval");
+	if (rc != 0) {
+		lua_remove(L, -2);
+		return rc;
+	}
+	lua_pushlstring(L, code, code_size);
+	lua_pushvalue(L, -2);
+	lua_rawset(L, -4);
+	offload_chunks_count++;
+	lua_remove(L, -2);
+	return 0;
+}
+
+/**
+ * Run a chunk in the Lua state of the worker.
+ * @retval 0 the result is the chunk return value,
+ *         NULL for nil
+ * @retval -1 the result is the error message, NULL if
+ *         out of memory
+ */
+static ssize_t
+offload_eval_cb(va_list ap)
+{
+	const char *code = va_arg(ap, const char *);
+	size_t code_size = va_arg(ap, size_t);
+	const char *data = va_arg(ap, const char *);
+	size_t size = va_arg(ap, size_t);
+	char **result = va_arg(ap, char **);
+	size_t *result_size = va_arg(ap, size_t *);
+
+	struct lua_State *L = offload_L;
+	if (L == NULL) {
+		L = luaL_newstate();
+		if (L == NULL)
+			return -1;
+		luaL_openlibs(L);
+		lua_newtable(L);
+		lua_setfield(L, LUA_REGISTRYINDEX, offload_chunks);
+		offload_L = L;
+	}
+	int top = lua_gettop(L);
+	ssize_t rc = -1;
+	if (offload_load_chunk(L, code, code_size) == 0) {
+		lua_pushlstring(L, data, size);
+		if (lua_pcall(L, 1, 1, 0) == 0) {
+			if (lua_isnil(L, -1)) {
+				rc = 0;
+				goto out;
+			}
+			if (lua_type(L, -1) != LUA_TSTRING &&
+			    lua_type(L, -1) != LUA_TNUMBER) {
+				lua_pushstring(L, "the chunk must return "
+					       "a string or nil");
+			} else {
+				rc = 0;
+			}
+		}
+	}
+	const char *str;
+	str = lua_tolstring(L, -1, result_size);
+	if (str == NULL) {
+		/* An error object which is not a string. */
+		str = "unknown error";
+		*result_size = strlen(str);
+	}
+	*result = offload_strdup(str, *result_size);
+	if (*result == NULL)
+		rc = -1;
+out:
+	lua_settop(L, top);
+	return rc;
+}
+
+static int
+lbox_offload_eval(struct lua_State *L)
+{
+	if (lua_gettop(L) != 2 || lua_type(L, 1) != LUA_TSTRING ||
+	    lua_type(L, 2) != LUA_TSTRING)
+		luaL_error(L, "Usage: offload.eval(code, data)");
+	size_t code_size, size;
+	const char *code = lua_tolstring(L, 1, &code_size);
+	const char *data = lua_tolstring(L, 2, &size);
+	char *result = NULL;
+	size_t result_size = 0;
+	ssize_t rc = offload_call(offload_eval_cb, code, code_size, data,
+				  size, &result, &result_size);
+	if (result == NULL) {
+		if (rc == 0) {
+			lua_pushnil(L);
+			return 1;
+		}
+		luaL_error(L, "offload.eval: %s", strerror(ENOMEM));
+	}
+	if (rc != 0) {
+		lua_pushfstring(L, "offload.eval: %s", result);
+		free(result);
+		lua_error(L);
+	}
+	lua_pushlstring(L, result, result_size);
+	free(result);
+	return 1;
+}
+
+/** }}} */
+
+/** {{{ Built-in functions */
+
+static char *
+offload_sha1(const char *data, size_t size, size_t *result_size)
+{
+	enum { SHA1_SIZE = 20 };
+	char *result = (char *) malloc(SHA1_SIZE);
+	if (result == NULL)
+		return NULL;
+	SHA1internal((const unsigned char *) data, size,
+		     (unsigned char *) result);
+	*result_size = SHA1_SIZE;
+	return result;
+}
+
+static char *
+offload_base64_encode(const char *data, size_t size, size_t *result_size)
+{
+	if (size > INT32_MAX / 2) {
+		errno = EINVAL;
+		return NULL;
+	}
+	int len = base64_bufsize(size);
+	char *result = (char *) malloc(len);
+	if (result == NULL)
+		return NULL;
+	*result_size = base64_encode(data, size, result, len);
+	return result;
+}
+
+static char *
+offload_base64_decode(const char *data, size_t size, size_t *result_size)
+{
+	if (size > INT32_MAX / 2) {
+		errno = EINVAL;
+		return NULL;
+	}
+	int len = (size * 3 + 3) / 4 + 1;
+	char *result = (char *) malloc(len);
+	if (result == NULL)
+		return NULL;
+	*result_size = base64_decode(data, size, result, len);
+	return result;
+}
+
+/** }}} */
+
+void
+tarantool_lua_offload_init(struct lua_State *L)
+{
+	offload_register("sha1", offload_sha1);
+	offload_register("base64_encode", offload_base64_encode);
+	offload_register("base64_decode", offload_base64_decode);
+	offload_set_worker_cleanup(offload_eval_cleanup);
+
+	static const struct luaL_reg offload_meta[] = {
+		{"call",	lbox_offload_call},
+		{"register",	lbox_offload_register},
+		{"eval",	lbox_offload_eval},
+		{NULL, NULL}
+	};
+	luaL_register_module(L, "offload", offload_meta);
+	lua_pop(L, 1);
+}
@@ -48,6 +48,8 @@
 #endif
 #include <fiber.h>
 #include <coeio.h>
+#include "offload.h"
+#include "watchdog.h"
 #include <crc32.h>
 #include "memory.h"
 #include <say.h>
@@ -269,6 +271,7 @@ tarantool_atfork()
 {
 	signal_reset();
 	box_atfork();
+	say_atfork();
 }
 
 /**
@@ -478,6 +481,8 @@ load_cfg()
 	say_logger_init(cfg_gets("logger"),
 			cfg_geti("log_level"),
 			cfg_geti("logger_nonblock"),
+			cfg_gets("log_format"),
+			cfg_geti("logger_async"),
 			cfg_geti("background"));
 
 	say_crit("version %s", tarantool_version());
@@ -510,6 +515,9 @@ tarantool_free(void)
 		free(pid_file);
 	}
 
+	watchdog_free();
+	offload_free();
+	say_logger_free();
 	fiber_free();
 	memory_free();
 	random_free();
@@ -0,0 +1,261 @@
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "offload.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cbus.h"
+#include "say.h"
+
+struct offload_worker;
+
+struct offload_stop_msg {
+	struct cmsg base;
+	struct offload_worker *worker;
+};
+
+struct offload_worker {
+	struct cord cord;
+	/** Receives calls from tx. */
+	struct cbus_endpoint endpoint;
+	/** From tx to the worker, created in tx. */
+	struct cpipe to_worker;
+	/** From the worker back to tx, created in the worker. */
+	struct cpipe to_tx;
+	/** The fiber of the worker, waiting for the stop message. */
+	struct fiber *fiber;
+	struct offload_stop_msg stop_msg;
+	bool is_ready;
+	bool is_stopped;
+	/** Calls in progress, for load balancing. */
+	int n_calls;
+};
+
+enum offload_state { OFFLOAD_STOPPED, OFFLOAD_STARTING, OFFLOAD_STARTED };
+
+static struct {
+	enum offload_state state;
+	/** Receives the results in tx. */
+	struct cbus_endpoint tx_endpoint;
+	struct offload_worker workers[OFFLOAD_WORKERS_MAX];
+	int n_workers;
+	/** Called in a worker when it stops. */
+	void (*worker_cleanup)(void);
+} offload;
+
+static void
+offload_worker_f(va_list ap)
+{
+	struct offload_worker *worker = va_arg(ap, struct offload_worker *);
+	worker->fiber = fiber();
+	cbus_endpoint_create(&worker->endpoint);
+	cpipe_create(&worker->to_tx, &offload.tx_endpoint);
+	__atomic_store_n(&worker->is_ready, true, __ATOMIC_RELEASE);
+	while (! worker->is_stopped)
+		fiber_yield();
+	if (offload.worker_cleanup != NULL)
+		offload.worker_cleanup();
+	cpipe_destroy(&worker->to_tx);
+	cbus_endpoint_destroy(&worker->endpoint);
+}
+
+static void
+offload_worker_stop(struct cmsg *msg)
+{
+	struct offload_worker *worker =
+		((struct offload_stop_msg *) msg)->worker;
+	worker->is_stopped = true;
+	fiber_wakeup(worker->fiber);
+}
+
+static const struct cmsg_hop offload_stop_route[] = {
+	{ offload_worker_stop, NULL },
+};
+
+static int
+offload_start()
+{
+	long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int n_workers = n_cpus > 1 ? n_cpus - 1 : 1;
+	if (n_workers > OFFLOAD_WORKERS_MAX)
+		n_workers = OFFLOAD_WORKERS_MAX;
+
+	offload.state = OFFLOAD_STARTING;
+	cbus_endpoint_create(&offload.tx_endpoint);
+	offload.n_workers = 0;
+	for (int i = 0; i < n_workers; i++) {
+		struct offload_worker *worker = &offload.workers[i];
+		memset(worker, 0, sizeof(*worker));
+		char name[FIBER_NAME_MAX];
+		snprintf(name, sizeof(name), "offload_%d", i);
+		if (cord_costart(&worker->cord, name, offload_worker_f,
+				 worker) != 0) {
+			say_syserror("failed to start %s", name);
+			break;
+		}
+		offload.n_workers++;
+		/* The worker must create its endpoint first. */
+		while (! __atomic_load_n(&worker->is_ready, __ATOMIC_ACQUIRE))
+			fiber_sleep(0.001);
+		cpipe_create(&worker->to_worker, &worker->endpoint);
+	}
+	if (offload.n_workers == 0) {
+		cbus_endpoint_destroy(&offload.tx_endpoint);
+		offload.state = OFFLOAD_STOPPED;
+		errno = ENOMEM;
+		return -1;
+	}
+	say_info("started %d offload workers", offload.n_workers);
+	offload.state = OFFLOAD_STARTED;
+	return 0;
+}
+
+void
+offload_free()
+{
+	if (offload.state != OFFLOAD_STARTED)
+		return;
+	for (int i = 0; i < offload.n_workers; i++) {
+		struct offload_worker *worker = &offload.workers[i];
+		cmsg_init(&worker->stop_msg.base, offload_stop_route);
+		worker->stop_msg.worker = worker;
+		cpipe_push(&worker->to_worker, &worker->stop_msg.base);
+		cpipe_destroy(&worker->to_worker);
+	}
+	for (int i = 0; i < offload.n_workers; i++)
+		cord_join(&offload.workers[i].cord);
+	cbus_endpoint_destroy(&offload.tx_endpoint);
+	offload.state = OFFLOAD_STOPPED;
+}
+
+void
+offload_set_worker_cleanup(void (*cleanup)(void))
+{
+	offload.worker_cleanup = cleanup;
+}
+
+/** The worker with the fewest calls in progress. */
+static struct offload_worker *
+offload_worker_pick()
+{
+	struct offload_worker *worker = &offload.workers[0];
+	for (int i = 1; i < offload.n_workers; i++) {
+		if (offload.workers[i].n_calls < worker->n_calls)
+			worker = &offload.workers[i];
+	}
+	return worker;
+}
+
+struct offload_msg {
+	struct cbus_call_msg base;
+	offload_f func;
+	va_list ap;
+	ssize_t result;
+	int saved_errno;
+};
+
+static int
+offload_perform(struct cbus_call_msg *m)
+{
+	struct offload_msg *msg = (struct offload_msg *) m;
+	errno = 0;
+	msg->result = msg->func(msg->ap);
+	msg->saved_errno = errno;
+	return 0;
+}
+
+ssize_t
+offload_call(offload_f func, ...)
+{
+	while (offload.state == OFFLOAD_STARTING)
+		fiber_sleep(0.001);
+	if (offload.state == OFFLOAD_STOPPED && offload_start() != 0)
+		return -1;
+
+	struct offload_worker *worker = offload_worker_pick();
+	struct offload_msg msg;
+	msg.func = func;
+	msg.result = -1;
+	msg.saved_errno = 0;
+	worker->n_calls++;
+	va_start(msg.ap, func);
+	int rc = cbus_call(&worker->to_worker, &worker->to_tx, &msg.base,
+			   offload_perform);
+	va_end(msg.ap);
+	worker->n_calls--;
+	if (rc != 0) {
+		/* Failed to start a fiber in the worker. */
+		errno = ENOMEM;
+		return -1;
+	}
+	errno = msg.saved_errno;
+	return msg.result;
+}
+
+enum { OFFLOAD_FUNCS_MAX = 64, OFFLOAD_NAME_MAX = 32 };
+
+/** Functions callable from Lua, registered in tx. */
+static struct {
+	char name[OFFLOAD_NAME_MAX];
+	offload_buf_f func;
+} offload_funcs[OFFLOAD_FUNCS_MAX];
+
+static int offload_funcs_count;
+
+int
+offload_register(const char *name, offload_buf_f func)
+{
+	for (int i = 0; i < offload_funcs_count; i++) {
+		if (strcmp(offload_funcs[i].name, name) == 0) {
+			offload_funcs[i].func = func;
+			return 0;
+		}
+	}
+	if (offload_funcs_count == OFFLOAD_FUNCS_MAX ||
+	    strlen(name) >= OFFLOAD_NAME_MAX)
+		return -1;
+	snprintf(offload_funcs[offload_funcs_count].name, OFFLOAD_NAME_MAX,
+		 "%s", name);
+	offload_funcs[offload_funcs_count].func = func;
+	offload_funcs_count++;
+	return 0;
+}
+
+offload_buf_f
+offload_find(const char *name)
+{
+	for (int i = 0; i < offload_funcs_count; i++) {
+		if (strcmp(offload_funcs[i].name, name) == 0)
+			return offload_funcs[i].func;
+	}
+	return NULL;
+}
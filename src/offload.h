@@ -0,0 +1,114 @@
+#ifndef TARANTOOL_OFFLOAD_H_INCLUDED
+#define TARANTOOL_OFFLOAD_H_INCLUDED
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <sys/types.h> /* ssize_t */
+#include <stdarg.h>
+
+/**
+ * @brief A pool of worker cords for CPU-heavy computations.
+ *
+ * Everything a fiber of the tx cord does blocks all other
+ * fibers of the cord until it yields, so a long computation,
+ * such as a digest of a large string, stalls request
+ * processing. offload_call() runs a function in one of the
+ * worker cords instead, and yields until it returns. Unlike
+ * coio_call(), it doesn't occupy the libeio threads, which
+ * are needed for file I/O.
+ *
+ * The pool is started on the first call, with a worker per
+ * CPU core but one. Calls are sent to the worker with the
+ * fewest calls in progress over cbus.
+ */
+
+enum { OFFLOAD_WORKERS_MAX = 16 };
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+typedef ssize_t (*offload_f)(va_list ap);
+
+/**
+ * Run a function in a worker cord and wait for it to return.
+ * The function must be thread-safe and must not use the
+ * runtime of the calling cord: fibers, the fiber region, Lua.
+ * The arguments are passed by reference, so memory they point
+ * to may be read in place, without copying. Like coio_call(),
+ * the call is not cancellable, and errno set by the function
+ * is preserved.
+ *
+ * May be used in the tx cord only.
+ *
+ * @retval -1 and errno = ENOMEM if failed to start the pool
+ * @retval the function return value
+ */
+ssize_t
+offload_call(offload_f func, ...);
+
+/** Stop the worker cords, if they are started. */
+void
+offload_free();
+
+/**
+ * Set a function to be called in every worker cord when it
+ * stops, to free the thread-local state of offloaded
+ * functions.
+ */
+void
+offload_set_worker_cleanup(void (*cleanup)(void));
+
+/**
+ * A function to be called by name with offload.call() from
+ * Lua. Is run in a worker cord, so must be thread-safe.
+ * Reads the argument in place and returns a malloc()'ed
+ * result.
+ * @retval NULL and errno on error
+ */
+typedef char *(*offload_buf_f)(const char *data, size_t size,
+			       size_t *result_size);
+
+/**
+ * Make a function callable with offload.call().
+ * Replaces a function registered with the same name.
+ * @retval -1 if there are too many functions or the name
+ *         is too long
+ */
+int
+offload_register(const char *name, offload_buf_f func);
+
+/** @return NULL if there is no such function. */
+offload_buf_f
+offload_find(const char *name);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_OFFLOAD_H_INCLUDED */
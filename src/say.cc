@@ -32,18 +32,24 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <sys/uio.h>
 #ifndef PIPE_BUF
 #include <sys/param.h>
 #endif
 
 #include "fiber.h"
 
+const char *say_format_STRS[] = { "plain", "json", NULL };
+
 char log_path[PATH_MAX + 1];
 int log_fd = STDERR_FILENO;
 static int logger_nonblock;
+static enum say_format logger_format = SF_PLAIN;
 pid_t logger_pid;
 static bool booting = true;
 static bool logger_background = true;
@@ -57,6 +63,56 @@ sayf(int level, const char *filename, int line, const char *error,
 
 sayfunc_t _say = sayf;
 
+enum {
+	/** The number of records in the logger ring. */
+	SAY_RING_SIZE = 512,
+	/** Max records written by the logger with one writev(). */
+	SAY_WRITEV_MAX = 64,
+	/**
+	 * How long the logger waits for a non-blocking log to
+	 * take the rest of a partially written record, in ms.
+	 */
+	SAY_PARTIAL_TIMEOUT = 1000,
+};
+
+/** A formatted log message in the logger ring. */
+struct say_record {
+	/**
+	 * Equals the position of the record in the ring when
+	 * the record is free, the position + 1 when the message
+	 * is ready to be written.
+	 */
+	uint64_t seq;
+	/** The length of the message, with the trailing newline. */
+	int len;
+	char buf[PIPE_BUF];
+};
+
+/**
+ * A bounded lock-free ring of log messages. There are many
+ * producers, which format messages right in the ring, and
+ * a single consumer, the logger cord. A producer never
+ * waits: when the ring is full, the message is dropped and
+ * counted.
+ */
+struct say_ring {
+	/** The next position to take by a producer. */
+	uint64_t head;
+	/** The next position to write by the logger. */
+	uint64_t tail;
+	/** The number of messages lost since the last report. */
+	uint64_t dropped;
+	struct say_record records[SAY_RING_SIZE];
+};
+
+/** Set if the log is written by the logger cord. */
+static struct say_ring *say_ring;
+static struct cord logger_cord;
+/** Wakes up the logger when there are new messages. */
+static struct ev_async logger_wakeup;
+static bool logger_is_ready;
+static bool logger_is_stopping;
+
 static char
 level_to_char(int level)
 {
@@ -86,6 +142,15 @@ say_init(const char *argv0)
 	binary_filename = strdup(argv0);
 }
 
+enum say_format
+say_format_by_name(const char *format)
+{
+	int f = 0;
+	while (f < SAY_FORMAT_MAX && strcasecmp(say_format_STRS[f], format))
+		f++;
+	return (enum say_format) f;
+}
+
 void
 say_set_log_level(int new_level)
 {
@@ -176,11 +241,16 @@ say_logrotate(int /* signo */)
 	/* For cases when used from a Lua FFI binding */
 	if (logger_pid || strlen(log_path) == 0)
 		return;
-	close(log_fd);
-	log_fd = open(log_path, O_WRONLY | O_APPEND | O_CREAT,
+	int fd = open(log_path, O_WRONLY | O_APPEND | O_CREAT,
 		      S_IRUSR | S_IWUSR | S_IRGRP);
-	if (log_fd < 0)
+	if (fd < 0)
 		return;
+	/*
+	 * Replace the descriptor atomically: the logger cord
+	 * may be writing to it.
+	 */
+	dup2(fd, log_fd);
+	close(fd);
 
 	if (logger_background) {
 		dup2(log_fd, STDOUT_FILENO);
@@ -213,11 +283,19 @@ say_init_file()
 /**
  * Initialize logging subsystem to use in daemon mode.
  */
+static void
+say_logger_start();
+
 void
-say_logger_init(const char *path, int level, int nonblock, int background)
+say_logger_init(const char *path, int level, int nonblock,
+		const char *format, int async, int background)
 {
 	*log_level = level;
 	logger_nonblock = nonblock;
+	if (format != NULL) {
+		logger_format = say_format_by_name(format);
+		assert(logger_format != SAY_FORMAT_MAX);
+	}
 	logger_background = background;
 	setvbuf(stderr, NULL, _IONBF, 0);
 
@@ -239,38 +317,46 @@ say_logger_init(const char *path, int level, int nonblock, int background)
 		fcntl(log_fd, F_SETFL, flags | O_NONBLOCK);
 	}
 	booting = false;
+	if (async)
+		say_logger_start();
 }
 
-void
-vsay(int level, const char *filename, int line, const char *error, const char *format, va_list ap)
+/** Print time in format 2012-08-07 18:30:00.634 */
+static int
+say_format_time(char *buf, int len)
 {
-	size_t p = 0, len = PIPE_BUF;
-	const char *f;
-	static __thread char buf[PIPE_BUF];
-
-	if (booting) {
-		fprintf(stderr, "%s: ", binary_filename);
-		vfprintf(stderr, format, ap);
-		if (error)
-			fprintf(stderr, ": %s", error);
-		fprintf(stderr, "\n");
-		return;
-	}
-
-	for (f = filename; *f; f++)
-		if (*f == '/' && *(f + 1) != '\0')
-			filename = f + 1;
-
 	/* Don't use ev_now() since it requires a working event loop. */
 	ev_tstamp now = ev_time();
 	time_t now_seconds = (time_t) now;
 	struct tm tm;
 	localtime_r(&now_seconds, &tm);
 
-	/* Print time in format 2012-08-07 18:30:00.634 */
-	p += strftime(buf + p, len - p, "%F %H:%M", &tm);
+	int p = strftime(buf, len, "%F %H:%M", &tm);
 	p += snprintf(buf + p, len - p, ":%06.3f",
 		      now - now_seconds + tm.tm_sec);
+	return p;
+}
+
+static const char *
+basename_of(const char *filename)
+{
+	for (const char *f = filename; *f; f++)
+		if (*f == '/' && *(f + 1) != '\0')
+			filename = f + 1;
+	return filename;
+}
+
+/**
+ * Format a log message.
+ * @return the length of the message, with the newline.
+ */
+static int
+say_format_plain(char *buf, int level, const char *filename, int line,
+		 const char *error, const char *format, va_list ap)
+{
+	int p = 0, len = PIPE_BUF;
+
+	p += say_format_time(buf + p, len - p);
 	struct cord *cord = cord();
 	p += snprintf(buf + p, len - p, " [%i]", getpid());
 	if (cord) {
@@ -281,8 +367,10 @@ vsay(int level, const char *filename, int line, const char *error, const char *f
 		}
 	}
 
-	if (level == S_WARN || level == S_ERROR || level == S_SYSERROR)
-		p += snprintf(buf + p, len - p, " %s:%i", filename, line);
+	if (level == S_WARN || level == S_ERROR || level == S_SYSERROR) {
+		p += snprintf(buf + p, len - p, " %s:%i",
+			      basename_of(filename), line);
+	}
 
 	p += snprintf(buf + p, len - p, " %c> ", level_to_char(level));
 	/* until here it is guaranteed that p < len */
@@ -293,12 +381,332 @@ vsay(int level, const char *filename, int line, const char *error, const char *f
 	if (p >= len - 1)
 		p = len - 1;
 	*(buf + p) = '\n';
+	return p + 1;
+}
+
+static const char *
+level_to_str(int level)
+{
+	static const char *levels[] = {
+		"FATAL", "SYSERROR", "ERROR", "CRIT", "WARN", "INFO", "DEBUG"
+	};
+	if (level < S_FATAL || level > S_DEBUG)
+		return "UNKNOWN";
+	return levels[level];
+}
+
+/**
+ * Append a JSON string with the given contents.
+ * Stops short of the end of the buffer, leaving room for
+ * the closing quote and a few more bytes.
+ */
+static int
+json_str(char *buf, int len, const char *str)
+{
+	int p = 0;
+	buf[p++] = '"';
+	for (; *str != '\0' && p < len - 8; str++) {
+		unsigned char c = *str;
+		if (c == '"' || c == '\\') {
+			buf[p++] = '\\';
+			buf[p++] = c;
+		} else if (c == '\n') {
+			buf[p++] = '\\';
+			buf[p++] = 'n';
+		} else if (c < 0x20) {
+			p += snprintf(buf + p, len - p, "\\u%04x", c);
+		} else {
+			buf[p++] = c;
+		}
+	}
+	buf[p++] = '"';
+	return p;
+}
+
+/**
+ * Format a log message as a JSON object on a single line.
+ * @return the length of the message, with the newline.
+ */
+static int
+say_format_json(char *buf, int level, const char *filename, int line,
+		const char *error, const char *format, va_list ap)
+{
+	int p = 0, len = PIPE_BUF;
+	char tmp[PIPE_BUF];
+
+	say_format_time(tmp, sizeof(tmp));
+	p += snprintf(buf + p, len - p, "{\"time\": \"%s\", \"level\": \"%s\", "
+		      "\"pid\": %i", tmp, level_to_str(level), getpid());
+	struct cord *cord = cord();
+	if (cord) {
+		p += snprintf(buf + p, len - p, ", \"cord\": ");
+		p += json_str(buf + p, len - p, cord->name);
+		if (fiber() && fiber()->fid != 1) {
+			p += snprintf(buf + p, len - p, ", \"fid\": %i, "
+				      "\"fiber\": ", fiber()->fid);
+			p += json_str(buf + p, len - p, fiber_name(fiber()));
+		}
+	}
+	if (filename != NULL) {
+		p += snprintf(buf + p, len - p, ", \"file\": ");
+		p += json_str(buf + p, len - p, basename_of(filename));
+		p += snprintf(buf + p, len - p, ", \"line\": %i", line);
+	}
+	/* until here it is guaranteed that p < len */
+
+	vsnprintf(tmp, sizeof(tmp), format, ap);
+	p += snprintf(buf + p, len - p, ", \"message\": ");
+	/* Leave room for the error and the closing brace. */
+	int error_len = error != NULL ? len / 4 : 0;
+	p += json_str(buf + p, len - p - error_len, tmp);
+	if (error != NULL) {
+		p += snprintf(buf + p, len - p, ", \"error\": ");
+		p += json_str(buf + p, len - p, error);
+	}
+	buf[p++] = '}';
+	buf[p++] = '\n';
+	return p;
+}
+
+static int
+say_format_message(char *buf, int level, const char *filename, int line,
+		   const char *error, const char *format, va_list ap)
+{
+	if (logger_format == SF_JSON) {
+		return say_format_json(buf, level, filename, line, error,
+				       format, ap);
+	}
+	return say_format_plain(buf, level, filename, line, error,
+				format, ap);
+}
+
+/**
+ * Write the whole iovec of records of the ring, unless there
+ * is an error. The records which are not written are counted
+ * as dropped, but a record is never cut in the middle, if
+ * that can be helped.
+ */
+static void
+say_writev(struct say_ring *ring, struct iovec *iov, int iovcnt)
+{
+	/* Set if the first record is partially written. */
+	bool partial = false;
+	while (iovcnt > 0) {
+		ssize_t r = writev(log_fd, iov, iovcnt);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN && partial) {
+				/*
+				 * A non-blocking log is full in the
+				 * middle of a record: wait a bit for
+				 * it to take the rest of the record.
+				 */
+				struct pollfd pfd = { log_fd, POLLOUT, 0 };
+				if (poll(&pfd, 1, SAY_PARTIAL_TIMEOUT) > 0)
+					continue;
+			}
+			/* E.g. EAGAIN with logger_nonblock. */
+			__atomic_add_fetch(&ring->dropped, iovcnt,
+					   __ATOMIC_RELAXED);
+			return;
+		}
+		while (iovcnt > 0 && (size_t) r >= iov->iov_len) {
+			r -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+		partial = iovcnt > 0 && r > 0;
+		if (partial) {
+			iov->iov_base = (char *) iov->iov_base + r;
+			iov->iov_len -= r;
+		}
+	}
+}
+
+/**
+ * Write out all ready messages of the ring, in batches.
+ * Must be called by a single consumer at a time.
+ */
+static void
+say_ring_flush(struct say_ring *ring)
+{
+	struct iovec iov[SAY_WRITEV_MAX];
+	uint64_t tail = ring->tail;
+	for (;;) {
+		int count = 0;
+		uint64_t pos = tail;
+		while (count < SAY_WRITEV_MAX) {
+			struct say_record *rec =
+				&ring->records[pos % SAY_RING_SIZE];
+			if (__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) !=
+			    pos + 1)
+				break;
+			iov[count].iov_base = rec->buf;
+			iov[count].iov_len = rec->len;
+			count++;
+			pos++;
+		}
+		if (count == 0)
+			break;
+		say_writev(ring, iov, count);
+		/* Give the records back to the producers. */
+		for (; tail < pos; tail++) {
+			__atomic_store_n(&ring->records[tail %
+					 SAY_RING_SIZE].seq,
+					 tail + SAY_RING_SIZE, __ATOMIC_RELEASE);
+		}
+		__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+	}
+}
 
-	int r = write(log_fd, buf, p + 1);
+/**
+ * Put a message to the logger ring.
+ * Lock-free, so it's safe to use in a signal handler.
+ */
+static void
+say_ring_push(struct say_ring *ring, int level, const char *filename,
+	      int line, const char *error, const char *format, va_list ap)
+{
+	uint64_t pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+	struct say_record *rec;
+	for (;;) {
+		rec = &ring->records[pos % SAY_RING_SIZE];
+		uint64_t seq = __atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE);
+		int64_t diff = (int64_t) (seq - pos);
+		if (diff == 0) {
+			/* The record is free, try to take it. */
+			if (__atomic_compare_exchange_n(&ring->head, &pos,
+							pos + 1, true,
+							__ATOMIC_RELAXED,
+							__ATOMIC_RELAXED))
+				break;
+		} else if (diff < 0) {
+			/* The ring is full. */
+			__atomic_add_fetch(&ring->dropped, 1,
+					   __ATOMIC_RELAXED);
+			return;
+		} else {
+			/* Taken by another producer. */
+			pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+		}
+	}
+	rec->len = say_format_message(rec->buf, level, filename, line,
+				      error, format, ap);
+	__atomic_store_n(&rec->seq, pos + 1, __ATOMIC_RELEASE);
+	ev_async_send(logger_cord.loop, &logger_wakeup);
+}
+
+static void
+say_logger_cb(ev_loop *loop, struct ev_async * /* watcher */,
+	      int /* revents */)
+{
+	say_ring_flush(say_ring);
+	uint64_t dropped = __atomic_exchange_n(&say_ring->dropped, 0,
+					       __ATOMIC_RELAXED);
+	if (dropped > 0) {
+		say_warn("%llu log messages were dropped",
+			 (unsigned long long) dropped);
+	}
+	if (logger_is_stopping)
+		ev_break(loop, EVBREAK_ALL);
+}
+
+static void *
+say_logger_f(void * /* arg */)
+{
+	ev_async_init(&logger_wakeup, say_logger_cb);
+	ev_async_start(loop(), &logger_wakeup);
+	__atomic_store_n(&logger_is_ready, true, __ATOMIC_RELEASE);
+	ev_run(loop(), 0);
+	ev_async_stop(loop(), &logger_wakeup);
+	return NULL;
+}
+
+static void
+say_logger_start()
+{
+	struct say_ring *ring = (struct say_ring *) malloc(sizeof(*ring));
+	if (ring == NULL) {
+		say_error("failed to allocate the logger ring, "
+			  "logging synchronously");
+		return;
+	}
+	ring->head = ring->tail = ring->dropped = 0;
+	for (uint64_t i = 0; i < SAY_RING_SIZE; i++)
+		ring->records[i].seq = i;
+	if (cord_start(&logger_cord, "logger", say_logger_f, NULL) != 0) {
+		say_syserror("failed to start the logger, "
+			     "logging synchronously");
+		free(ring);
+		return;
+	}
+	/* The logger loop must be able to get wakeups. */
+	while (! __atomic_load_n(&logger_is_ready, __ATOMIC_ACQUIRE))
+		usleep(100);
+	__atomic_store_n(&say_ring, ring, __ATOMIC_RELEASE);
+}
+
+void
+say_logger_free()
+{
+	struct say_ring *ring = say_ring;
+	if (ring == NULL)
+		return;
+	logger_is_stopping = true;
+	ev_async_send(logger_cord.loop, &logger_wakeup);
+	cord_join(&logger_cord);
+	say_ring = NULL;
+	/* Messages which came after the logger stopped. */
+	say_ring_flush(ring);
+	free(ring);
+}
+
+void
+say_atfork()
+{
+	say_ring = NULL;
+}
+
+void
+vsay(int level, const char *filename, int line, const char *error, const char *format, va_list ap)
+{
+	static __thread char buf[PIPE_BUF];
+
+	if (booting) {
+		fprintf(stderr, "%s: ", binary_filename);
+		vfprintf(stderr, format, ap);
+		if (error)
+			fprintf(stderr, ": %s", error);
+		fprintf(stderr, "\n");
+		return;
+	}
+
+	struct say_ring *ring = __atomic_load_n(&say_ring, __ATOMIC_ACQUIRE);
+	if (ring != NULL) {
+		if (level != S_FATAL) {
+			say_ring_push(ring, level, filename, line, error,
+				      format, ap);
+			return;
+		}
+		/*
+		 * The process is about to exit: let the logger
+		 * write what it has, to keep the order of
+		 * messages, but don't wait for too long.
+		 */
+		for (int i = 0; i < 1000 &&
+		     __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) !=
+		     __atomic_load_n(&ring->head, __ATOMIC_RELAXED); i++)
+			usleep(1000);
+	}
+
+	int len = say_format_message(buf, level, filename, line, error,
+				     format, ap);
+	int r = write(log_fd, buf, len);
 	(void)r;
 
 	if (level == S_FATAL && log_fd != STDERR_FILENO) {
-		r = write(STDERR_FILENO, buf, p + 1);
+		r = write(STDERR_FILENO, buf, len);
 		(void)r;
 	}
 }
@@ -315,3 +723,23 @@ sayf(int level, const char *filename, int line, const char *error, const char *f
 	va_end(ap);
 	errno = errsv; /* Preserve the errno. */
 }
+
+bool
+say_ratelimit_check(struct say_ratelimit *rl, int *suppressed)
+{
+	ev_tstamp now = ev_time();
+	*suppressed = 0;
+	if (now > rl->start + rl->interval || now < rl->start) {
+		/* A new interval, or the clock went back. */
+		*suppressed = rl->suppressed;
+		rl->start = now;
+		rl->emitted = 0;
+		rl->suppressed = 0;
+	}
+	if (rl->emitted < rl->burst) {
+		rl->emitted++;
+		return true;
+	}
+	rl->suppressed++;
+	return false;
+}
@@ -30,6 +30,7 @@
  */
 #include <stdlib.h>
 #include <stdarg.h>
+#include <stdbool.h>
 #include <errno.h>
 
 #if defined(__cplusplus)
@@ -50,6 +51,15 @@ enum say_level {
 
 /** \endcond public */
 
+/** Log output formats. */
+enum say_format { SF_PLAIN = 0, SF_JSON, SAY_FORMAT_MAX };
+
+extern const char *say_format_STRS[];
+
+/** @return SAY_FORMAT_MAX if the format is unknown. */
+enum say_format
+say_format_by_name(const char *format);
+
 extern int log_fd;
 extern pid_t logger_pid;
 
@@ -62,9 +72,22 @@ say_set_log_level(int new_level);
 /** Basic init. */
 void say_init(const char *argv0);
 
-/* Move logging to a separate process. */
+/**
+ * Initialize logging to a file, a pipe or stderr.
+ * @param format  plain or json, NULL means plain
+ * @param async   write the log from a separate logger cord
+ */
 void say_logger_init(const char *logger, int log_level, int nonblock,
-		     int background);
+		     const char *format, int async, int background);
+
+/** Flush the log and stop the logger cord, if any. */
+void say_logger_free();
+
+/**
+ * A pthread_atfork() callback for a child process: there
+ * is no logger cord in the child, so log synchronously.
+ */
+void say_atfork();
 
 void vsay(int level, const char *filename, int line, const char *error,
           const char *format, va_list ap)
@@ -89,6 +112,59 @@ extern sayfunc_t _say __attribute__ ((format(printf, 5, 6)));
 #define say_debug(...)			say(S_DEBUG, NULL, __VA_ARGS__)
 /** \endcond public */
 
+/**
+ * A rate limit of a log call site: at most @a burst
+ * messages per @a interval seconds get to the log, the
+ * number of the suppressed ones is reported when the next
+ * interval begins.
+ */
+struct say_ratelimit {
+	double interval;
+	int burst;
+	/** The beginning of the current interval. */
+	double start;
+	/** Messages logged in the current interval. */
+	int emitted;
+	/** Messages suppressed in the current interval. */
+	int suppressed;
+};
+
+enum { SAY_RATELIMIT_INTERVAL = 5, SAY_RATELIMIT_BURST = 10 };
+
+#define SAY_RATELIMIT_INITIALIZER \
+	{ SAY_RATELIMIT_INTERVAL, SAY_RATELIMIT_BURST, 0, 0, 0 }
+
+/**
+ * Check whether a message of the call site may be logged.
+ * @param[out] suppressed the number of messages suppressed
+ *             in the previous interval, to be reported
+ */
+bool
+say_ratelimit_check(struct say_ratelimit *rl, int *suppressed);
+
+/**
+ * Evaluate @a log, an expression which writes a message to
+ * the log, under the rate limit of the call site.
+ */
+#define say_ratelimited_do(log) ({					\
+	static struct say_ratelimit rl = SAY_RATELIMIT_INITIALIZER;	\
+	int suppressed;							\
+	if (say_ratelimit_check(&rl, &suppressed)) {			\
+		if (suppressed > 0)					\
+			say(S_WARN, NULL, "%d similar messages "	\
+			    "suppressed", suppressed);			\
+		log;							\
+	}								\
+})
+
+#define say_ratelimited(level, ...) \
+	say_ratelimited_do(say(level, __VA_ARGS__))
+
+#define say_syserror_ratelimited(...) \
+	say_ratelimited(S_SYSERROR, strerror(errno), __VA_ARGS__)
+#define say_error_ratelimited(...)	say_ratelimited(S_ERROR, NULL, __VA_ARGS__)
+#define say_warn_ratelimited(...)	say_ratelimited(S_WARN, NULL, __VA_ARGS__)
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
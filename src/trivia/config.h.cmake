@@ -41,6 +41,11 @@
  * Set if the system has bfd.h header and GNU bfd library.
  */
 #cmakedefine HAVE_BFD 1
+/*
+ * Defined if the LZ4 library is available, used for tuple
+ * compression.
+ */
+#cmakedefine HAVE_LZ4 1
 #cmakedefine HAVE_MAP_ANON 1
 #cmakedefine HAVE_MAP_ANONYMOUS 1
 #if !defined(HAVE_MAP_ANONYMOUS) && defined(HAVE_MAP_ANON)
@@ -130,6 +135,12 @@
 #cmakedefine HAVE_FFSL 1
 #cmakedefine HAVE_FFSLL 1
 
+/*
+ * Defined if 256-bit integer SIMD is enabled at compile time
+ * (see cmake/simd.cmake).
+ */
+#cmakedefine ENABLE_AVX2 1
+
 /*
  * pthread have problems with -std=c99
  */
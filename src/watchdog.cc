@@ -0,0 +1,313 @@
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "watchdog.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+
+#include "fiber.h"
+#include "say.h"
+#include "tt_pthread.h"
+
+enum { WATCHDOG_FRAMES_MAX = 32 };
+
+/**
+ * What the signal handler has found running in a stalled
+ * loop iteration. Filled by the handler, which can't log
+ * itself, and reported by the watchdog thread.
+ */
+struct watchdog_report {
+	/** The stalled iteration, set when the report is ready. */
+	uint32_t seq;
+	uint32_t fid;
+	char name[FIBER_NAME_MAX];
+	/** Return addresses of the stack of the fiber. */
+	void *frames[WATCHDOG_FRAMES_MAX];
+	int frame_count;
+};
+
+static struct watchdog_report watchdog_report;
+
+static struct {
+	/** The watched cord. */
+	struct cord *cord;
+	/** In seconds, 0 if the watchdog is stopped. */
+	double threshold;
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	bool is_stopped;
+	/** The loop iteration the cord has been signaled about. */
+	uint32_t seq;
+	/** Reports the iterations when they end. */
+	ev_prepare prepare_event;
+} watchdog = {
+	NULL, 0, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER,
+	false, 0, {}
+};
+
+static double
+watchdog_clock()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+#ifdef ENABLE_BACKTRACE
+/** @sa backtrace() */
+struct watchdog_frame {
+	struct watchdog_frame *rbp;
+	void *ret;
+};
+
+/**
+ * Collect the return addresses of the current stack, without
+ * resolving them, which is not async-signal-safe.
+ */
+static int
+watchdog_collect_frames(struct fiber *f, void **frames, int max)
+{
+	struct watchdog_frame *frame = (struct watchdog_frame *)
+		__builtin_frame_address(0);
+	void *stack_bottom, *stack_top;
+	if (f == &cord()->sched) {
+		stack_bottom = frame;
+		stack_top = __libc_stack_end;
+	} else {
+		stack_bottom = f->coro.stack;
+		stack_top = (char *) f->coro.stack + f->coro.stack_size;
+	}
+	int count = 0;
+	while (count < max && stack_bottom <= (void *) frame &&
+	       (void *) frame < stack_top) {
+		frames[count++] = frame->ret;
+		frame = frame->rbp;
+	}
+	return count;
+}
+#endif /* ENABLE_BACKTRACE */
+
+/**
+ * Runs in the watched cord on the stack of a stalled fiber.
+ * Only copies what is running to the report, which the
+ * watchdog thread writes to the log.
+ */
+static void
+watchdog_signal_cb(int /* signo */)
+{
+	struct cord *cord = cord();
+	uint32_t seq = __atomic_load_n(&watchdog.seq, __ATOMIC_RELAXED);
+	if (cord == NULL || cord != watchdog.cord ||
+	    __atomic_load_n(&cord->loop_seq, __ATOMIC_RELAXED) != seq) {
+		/* The loop has moved on meanwhile. */
+		return;
+	}
+	struct fiber *f = fiber();
+	struct watchdog_report *report = &watchdog_report;
+	report->fid = f->fid;
+	memcpy(report->name, fiber_name(f), sizeof(report->name));
+	report->name[sizeof(report->name) - 1] = '\0';
+#ifdef ENABLE_BACKTRACE
+	report->frame_count = watchdog_collect_frames(f, report->frames,
+						      WATCHDOG_FRAMES_MAX);
+#else
+	report->frame_count = 0;
+#endif /* ENABLE_BACKTRACE */
+	__atomic_store_n(&report->seq, seq, __ATOMIC_RELEASE);
+}
+
+/** Log the report of the signal handler, in the watchdog thread. */
+static void
+watchdog_log_report(struct watchdog_report *report, double threshold)
+{
+	char bt[WATCHDOG_FRAMES_MAX * 80 + 1];
+	char *p = bt, *end = bt + sizeof(bt);
+	*p = '\0';
+	for (int i = 0; i < report->frame_count; i++) {
+		void *ret = report->frames[i];
+		int len;
+#ifdef HAVE_BFD
+		struct symbol *s = addr2symbol(ret);
+		if (s != NULL) {
+			len = snprintf(p, end - p, "\n#%-2d %p in %s+%zu", i,
+				       ret, s->name,
+				       (size_t) ((char *) ret - (char *) s->addr));
+		} else
+#endif /* HAVE_BFD */
+		{
+			len = snprintf(p, end - p, "\n#%-2d %p in ?", i, ret);
+		}
+		if (len >= end - p)
+			break;
+		p += len;
+	}
+	say_warn("event loop is stalled for more than %.3f sec "
+		 "in fiber %u '%s'%s", threshold, report->fid,
+		 report->name, bt);
+}
+
+/**
+ * Runs after cord_prepare_cb(), which charges the scheduler
+ * for the end of the iteration.
+ */
+static void
+watchdog_prepare_cb(ev_loop * /* loop */, ev_prepare * /* watcher */,
+		    int /* revents */)
+{
+	struct cord *cord = cord();
+	double elapsed = fiber_ticks_to_sec(cord->switch_ticks -
+					    cord->loop_ticks);
+	struct fiber *f = cord->slice_fiber;
+	if (elapsed <= watchdog.threshold || f == NULL)
+		return;
+	say_warn_ratelimited("event loop iteration took %.3f sec, "
+			     "fiber %u '%s' held the CPU for %.3f sec",
+			     elapsed, cord->slice_fid,
+			     /* The fiber may have been recycled. */
+			     f->fid == cord->slice_fid ? fiber_name(f) : "",
+			     fiber_ticks_to_sec(cord->slice_max));
+}
+
+/**
+ * Sample the loop of the watched cord a few times per
+ * threshold. An odd sequence number which doesn't change for
+ * the threshold is a stall.
+ */
+static void *
+watchdog_f(void * /* arg */)
+{
+	struct cord *cord = watchdog.cord;
+	uint32_t seq = 0;
+	double since = 0;
+	bool is_signaled = false;
+	bool is_reported = false;
+	tt_pthread_mutex_lock(&watchdog.mutex);
+	while (! watchdog.is_stopped) {
+		double timeout = watchdog.threshold / 4;
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += (time_t) timeout;
+		deadline.tv_nsec += (long) ((timeout - (time_t) timeout) * 1e9);
+		if (deadline.tv_nsec >= 1000000000) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000;
+		}
+		pthread_cond_timedwait(&watchdog.cond, &watchdog.mutex,
+				       &deadline);
+		if (is_signaled && ! is_reported &&
+		    __atomic_load_n(&watchdog_report.seq,
+				    __ATOMIC_ACQUIRE) == seq) {
+			/* The handler has run, log what it found. */
+			watchdog_log_report(&watchdog_report,
+					    watchdog.threshold);
+			is_reported = true;
+		}
+		uint32_t cur = __atomic_load_n(&cord->loop_seq,
+					       __ATOMIC_RELAXED);
+		double now = watchdog_clock();
+		if (cur != seq || cur % 2 == 0) {
+			seq = cur;
+			since = now;
+			is_signaled = false;
+		} else if (! is_signaled &&
+			   now - since >= watchdog.threshold) {
+			__atomic_store_n(&watchdog.seq, seq, __ATOMIC_RELAXED);
+			pthread_kill(cord->id, SIGURG);
+			is_signaled = true;
+			is_reported = false;
+		}
+	}
+	tt_pthread_mutex_unlock(&watchdog.mutex);
+	return NULL;
+}
+
+static int
+watchdog_start(double threshold)
+{
+	/* SIGURG is ignored by default, a late signal is harmless. */
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sigemptyset(&sa.sa_mask);
+	sa.sa_handler = watchdog_signal_cb;
+	sa.sa_flags = SA_RESTART;
+	if (sigaction(SIGURG, &sa, NULL) == -1) {
+		say_syserror("sigaction");
+		return -1;
+	}
+	watchdog.cord = cord();
+	watchdog.threshold = threshold;
+	watchdog.is_stopped = false;
+	if (tt_pthread_create(&watchdog.thread, NULL, watchdog_f, NULL)) {
+		watchdog.cord = NULL;
+		watchdog.threshold = 0;
+		return -1;
+	}
+	ev_prepare_init(&watchdog.prepare_event, watchdog_prepare_cb);
+	ev_set_priority(&watchdog.prepare_event, EV_MINPRI);
+	ev_prepare_start(loop(), &watchdog.prepare_event);
+	ev_unref(loop());
+	return 0;
+}
+
+void
+watchdog_free()
+{
+	if (watchdog.cord == NULL)
+		return;
+	tt_pthread_mutex_lock(&watchdog.mutex);
+	watchdog.is_stopped = true;
+	tt_pthread_cond_signal(&watchdog.cond);
+	tt_pthread_mutex_unlock(&watchdog.mutex);
+	tt_pthread_join(watchdog.thread, NULL);
+	ev_ref(watchdog.cord->loop);
+	ev_prepare_stop(watchdog.cord->loop, &watchdog.prepare_event);
+	watchdog.cord = NULL;
+	watchdog.threshold = 0;
+}
+
+void
+watchdog_set_threshold(double threshold)
+{
+	if (threshold <= 0) {
+		watchdog_free();
+		return;
+	}
+	if (watchdog.cord == NULL) {
+		watchdog_start(threshold);
+		return;
+	}
+	assert(watchdog.cord == cord());
+	tt_pthread_mutex_lock(&watchdog.mutex);
+	watchdog.threshold = threshold;
+	tt_pthread_cond_signal(&watchdog.cond);
+	tt_pthread_mutex_unlock(&watchdog.mutex);
+}
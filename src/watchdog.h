@@ -0,0 +1,66 @@
+#ifndef TARANTOOL_WATCHDOG_H_INCLUDED
+#define TARANTOOL_WATCHDOG_H_INCLUDED
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * @brief The event loop stall watchdog.
+ *
+ * A fiber which doesn't yield for long blocks all other fibers
+ * of its cord. The watchdog is a thread which samples the loop
+ * iterations of the tx cord. If an iteration lasts longer than
+ * the threshold, the watchdog interrupts the cord with SIGURG.
+ * The signal handler only records the id, the name and the
+ * return addresses of the fiber which is running at the
+ * moment, and the watchdog thread logs them. When the
+ * iteration ends, the total time of the iteration and the
+ * fiber which held the CPU for the longest time in it are
+ * logged as well.
+ */
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/**
+ * Start the watchdog for the current cord, change its
+ * threshold, in seconds, or stop it if the threshold is 0.
+ */
+void
+watchdog_set_threshold(double threshold);
+
+/** Stop the watchdog thread, if it is running. */
+void
+watchdog_free();
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_WATCHDOG_H_INCLUDED */
@@ -0,0 +1,53 @@
+#!/usr/bin/env tarantool
+
+local tap = require('tap')
+local offload = require('offload')
+local digest = require('digest')
+local fiber = require('fiber')
+local ffi = require('ffi')
+
+local test = tap.test('offload')
+test:plan(12)
+
+local data = string.rep('0123456789abcdef', 4096)
+test:is(offload.call('sha1', data), digest.sha1(data), 'sha1')
+test:is(offload.call('base64_encode', data), digest.base64_encode(data),
+    'base64_encode')
+test:is(offload.call('base64_decode', offload.call('base64_encode', data)),
+    data, 'base64_decode')
+test:ok(not pcall(offload.call, 'no_such_function', data),
+    'unknown function')
+
+test:ok(not pcall(offload.register, 'bad', ffi.new('int[1]')),
+    'register an array')
+test:ok(not pcall(offload.register, 'bad', ffi.cast('void *', 1)),
+    'register a data pointer')
+-- getenv() ignores the extra arguments and returns NULL
+-- without setting errno.
+ffi.cdef('char *getenv(const char *name);')
+offload.register('getenv', ffi.C.getenv)
+local ok, err = pcall(offload.call, 'getenv', 'NO_SUCH_VARIABLE')
+test:ok(not ok and err:match('returned NULL') ~= nil, 'NULL without errno')
+
+test:is(offload.eval('local s = ... return s:upper()', 'abc'), 'ABC', 'eval')
+test:is(offload.eval('return nil', ''), nil, 'eval returns nil')
+ok, err = pcall(offload.eval, 'error("boom")', '')
+test:ok(not ok and err:match('boom') ~= nil, 'eval error')
+test:ok(not pcall(offload.eval, 'return {}', ''), 'eval returns a table')
+
+-- Many fibers share the pool.
+local ch = fiber.channel(10)
+for i = 1, 10 do
+    fiber.create(function()
+        local s = tostring(i)
+        ch:put(offload.eval('return string.rep(..., 2)', s) == s..s)
+    end)
+end
+local all = true
+for i = 1, 10 do
+    all = ch:get() and all
+end
+test:ok(all, 'concurrent calls')
+
+test:check()
+os.exit()
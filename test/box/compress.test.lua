@@ -0,0 +1,119 @@
+-- tuple compression
+msgpack = require('msgpack')
+_space = box.space._space
+FLAGS = 6
+
+s = box.schema.space.create('compress', { compress = 64 })
+index = s:create_index('primary', { type = 'tree' })
+
+-- below the threshold: stored as is
+t = s:insert{1, 'short'}
+t
+t:bsize() == #msgpack.encode(t:totable())
+
+-- above the threshold: the tail is compressed
+long = string.rep('abcd', 100)
+_ = s:insert{2, long, long, 'tail'}
+t = s:get{2}
+t:bsize() < #msgpack.encode(t:totable())
+#t
+t[1]
+t[2] == long
+t[3] == long
+t[4]
+t:totable()[3] == long
+
+-- incompressible data is stored as is
+_ = s:insert{3, require('digest').urandom(200)}
+t = s:get{3}
+t:bsize() == #msgpack.encode(t:totable())
+
+-- select and update
+#s:select{}
+s:select{1}
+t = s:update(2, {{'=', 4, 'new tail'}})
+t:bsize() < #msgpack.encode(t:totable())
+t[2] == long
+t[4]
+s:get{2}[4]
+s:update(2, {{'=', 2, 'a'}, {'=', 3, 'b'}})
+s:get{2}:bsize() == #msgpack.encode(s:get{2}:totable())
+t = s:update(2, {{'=', 2, long}, {'#', 3, 1}})
+t:bsize() < #msgpack.encode(t:totable())
+t[3]
+_ = s:replace{1, long, 'replaced'}
+s:get{1}:bsize() < #msgpack.encode(s:get{1}:totable())
+s:get{1}[3]
+
+-- snapshot and recovery
+box.snapshot()
+--# stop server default
+--# start server default
+msgpack = require('msgpack')
+_space = box.space._space
+FLAGS = 6
+long = string.rep('abcd', 100)
+s = box.space.compress
+s:len()
+t = s:get{1}
+t:bsize() < #msgpack.encode(t:totable())
+t[2] == long
+t[3]
+t = s:get{2}
+t:bsize() < #msgpack.encode(t:totable())
+t[2] == long
+t[3]
+-- recovery from the WAL
+_ = s:insert{4, long, 'wal'}
+--# stop server default
+--# start server default
+msgpack = require('msgpack')
+_space = box.space._space
+FLAGS = 6
+long = string.rep('abcd', 100)
+s = box.space.compress
+t = s:get{4}
+t:bsize() < #msgpack.encode(t:totable())
+t[2] == long
+t[3]
+
+-- alter restrictions
+_ = _space:update(s.id, {{'=', FLAGS, ''}})
+s:create_index('secondary', { parts = {2, 'str'} })
+-- an index on the prefix fields can be added
+index = s:create_index('secondary', { parts = {1, 'num'} })
+#index:select{}
+index:drop()
+s:truncate()
+_ = _space:update(s.id, {{'=', FLAGS, ''}})
+index = s:create_index('secondary', { type = 'hash', parts = {2, 'str'} })
+_ = _space:update(s.id, {{'=', FLAGS, 'compress=64'}})
+_ = s:insert{1, long, long}
+t = index:get{long}
+t[1]
+t:bsize() < #msgpack.encode(t:totable())
+s:drop()
+
+-- compressed tuples and the field offset cache
+s = box.schema.space.create('compress', { compress = 64, field_offsets = 4 })
+index = s:create_index('primary', { type = 'tree' })
+wide = {} for i = 1, 50 do wide[i] = long end wide[1] = 1
+_ = s:insert(wide)
+t = s:get{1}
+t:bsize() < #msgpack.encode(t:totable())
+#t
+t[2] == long, t[5] == long, t[50] == long
+t = s:update(1, {{'=', 10, 'x'}, {'=', 50, 'y'}})
+t:bsize() < #msgpack.encode(t:totable())
+#t
+t[9] == long, t[10], t[11] == long, t[50]
+-- short tuples are stored as is and use the cache
+_ = s:insert{2, 'a', 'b', 'c', 'd', 'e'}
+t = s:get{2}
+t:bsize() == #msgpack.encode(t:totable())
+t[5], t[6], t[7]
+-- a new index is built over compressed tuples
+index2 = s:create_index('secondary', { type = 'hash', parts = {1, 'num'} })
+index2:get{1}[10]
+index2:get{2}[6]
+s:drop()
@@ -0,0 +1,71 @@
+-- dictionary-encoded fields
+msgpack = require('msgpack')
+remote = require('net.box')
+_space = box.space._space
+FLAGS = 6
+
+s = box.schema.space.create('dict', { dict = {2, 3, 4} })
+index = s:create_index('primary', { type = 'tree' })
+s:insert{1, 'red', 'green', 'blue'}
+s:insert{2, 'red', 'green', 'blue', 'not encoded'}
+s:insert{3, 'blue', 'red', 'green'}
+s:insert{4, 5}
+s:insert{4, 'red', 5}
+
+-- equal values are interned once, tuples store their ids
+t = s:get{1}
+t:bsize() < #msgpack.encode(t:totable())
+s:get{3}:bsize() == t:bsize()
+
+-- values are restored on access
+t[2], t[3], t[4]
+t:totable()
+s:select{}
+s:update(1, {{'=', 3, 'yellow'}})
+s:get{1}[3]
+
+-- iteration survives writes and eviction of the unpacked data
+--# setopt delimiter ';'
+result = {};
+for i, v in s:get{1}:pairs() do
+    s:replace{10 + i, 'cyan', 'magenta', 'yellow'}
+    for _, x in s:pairs() do
+        _ = x:totable()
+    end
+    table.insert(result, v)
+end;
+--# setopt delimiter ''
+result
+#s:select{}
+
+-- tuples are sent to clients decoded
+box.schema.user.grant('guest', 'read,write,execute', 'universe')
+cn = remote:new(box.cfg.listen)
+cn.space.dict:select{1}
+cn.space.dict:select{3}
+cn:close()
+box.schema.user.revoke('guest', 'read,write,execute', 'universe')
+
+-- alter
+index2 = s:create_index('secondary', { unique = false, parts = {2, 'str'} })
+index2:select{'red'}
+_ = _space:update(s.id, {{'=', FLAGS, ''}})
+s:get{1}
+_ = s:insert{21, 'red', 'green', 'blue'}
+t = s:get{21}
+t:bsize() == #msgpack.encode(t:totable())
+index2:select{'red'}
+s:drop()
+
+-- a full dictionary stores new values as is
+s = box.schema.space.create('dict', { dict = {2}, temporary = true })
+index = s:create_index('primary', { type = 'tree' })
+for i = 1, 65537 do s:insert{i, 'value' .. i} end
+t = s:get{65536}
+t:bsize() < #msgpack.encode(t:totable())
+t[2]
+t = s:get{65537}
+t:bsize() == #msgpack.encode(t:totable())
+t[2]
+s:get{1}[2]
+s:drop()
@@ -0,0 +1,46 @@
+-- field offset cache
+s = box.schema.space.create('field_offsets', { field_offsets = 4 })
+index = s:create_index('primary', { type = 'tree' })
+wide = {} for i = 1, 300 do wide[i] = i end
+_ = s:insert(wide)
+t = s:get{1}
+#t
+t[1], t[2], t[4], t[5], t[6], t[8], t[9], t[100], t[256], t[257], t[258], t[300]
+t[301]
+
+-- tuples shorter than the cached range
+_ = s:insert{2, 'a', 'b'}
+t = s:get{2}
+#t
+t[2], t[3], t[4], t[5], t[100]
+_ = s:insert{3, 2, 3, 4}
+t = s:get{3}
+t[4], t[5], t[6]
+_ = s:insert{4, 2, 3, 4, 5}
+t = s:get{4}
+t[4], t[5], t[6]
+
+-- update
+t = s:update(1, {{'=', 6, 'x'}, {'#', 2, 1}})
+#t
+t[2], t[5], t[6], t[100], t[299], t[300]
+s:update(1, {{'#', 3, 290}})
+t = s:update(2, {{'!', 4, 'c'}})
+t
+t[3], t[4], t[5]
+
+-- snapshot and recovery
+wide[1] = 5
+_ = s:insert(wide)
+box.snapshot()
+wide[1] = 6
+_ = s:insert(wide)
+--# stop server default
+--# start server default
+s = box.space.field_offsets
+t = s:get{5}
+#t, t[5], t[100], t[300]
+t = s:get{6}
+#t, t[5], t[100], t[300]
+s:get{3}
+s:drop()
@@ -0,0 +1,28 @@
+-- hash function selection for HASH indexes
+s = box.schema.space.create('test')
+i = s:create_index('primary', { type = 'tree', hash_func = 'crc32c' })
+i = s:create_index('primary', { type = 'hash', hash_func = 'sha1' })
+i = s:create_index('primary', { type = 'hash', hash_func = 'crc32c' })
+s.index.primary.hash_func
+i = s:create_index('str', { type = 'hash', parts = {2, 'str'}, hash_func = 'wyhash' })
+s.index.str.hash_func
+i = s:create_index('multi', { type = 'hash', parts = {2, 'str', 3, 'num'}, hash_func = 'crc32c' })
+for k = 1, 1000 do s:insert{k, 'key'..k, k * 3} end
+s:get{500}
+s.index.str:get{'key700'}
+s.index.multi:get{'key42', 126}
+s.index.multi:get{'key42', 127}
+s:delete{700}
+s.index.str:get{'key700'}
+s.index.str:count()
+-- changing the hash function rebuilds the index
+s.index.str:alter({ hash_func = 'murmur' })
+s.index.str.hash_func
+s.index.str:get{'key999'}
+s.index.multi:alter({ hash_func = 'wyhash' })
+s.index.multi.hash_func
+s.index.multi:get{'key42', 126}
+box.space._index:get{s.id, 2}[11]
+-- unknown index options are rejected
+box.space._index:insert{s.id, 3, 'bad', 'hash', 1, 1, 0, 'num', 'foo=bar'}
+s:drop()
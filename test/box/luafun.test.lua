@@ -34,6 +34,12 @@ fun.iter(space.index[0]):totable()
 fun.iter(space.index[0]:pairs()):totable()
 space.index[0]:pairs():drop(2):take(3):totable()
 
+-- iter on index in batches
+space.index[0]:pairs(nil, {batch = 2}):totable()
+space.index[0]:pairs(nil, {batch = 2}):drop(1):take(3):totable()
+space:pairs(nil, {batch = 100}):map(function(t) return t[2] end):totable()
+space.index[0]:pairs(nil, {batch = 0})
+
 -- test global functions
 --# setopt delimiter ';'
 fun.reduce(function(acc, val) return acc + val end, 0,
@@ -31,3 +31,62 @@ box.stat.SELECT.total
 
 -- cleanup
 box.space.tweedledum:drop()
+
+-- space:bsize() and box.stat.spaces()
+space = box.schema.space.create('tweedledee')
+space:bsize()
+index = space:create_index('primary', { type = 'tree' })
+space:bsize()
+_ = space:insert{1, 'a'}
+size = space:bsize()
+size > 0
+_ = space:insert{2, 'a'}
+space:bsize() == 2 * size
+_ = space:replace{2, 'aaaa'}
+space:bsize() - 2 * size
+_ = space:update(2, {{'=', 2, 'a'}})
+space:bsize() == 2 * size
+_ = space:delete{2}
+space:bsize() == size
+-- a rolled back statement is not accounted
+box.begin() space:insert{2, 'a'} box.rollback()
+space:bsize() == size
+-- alter carries the size over
+_ = space:insert{2, 'a'}
+index2 = space:create_index('secondary', { type = 'hash', parts = {2, 'str', 1, 'num'} })
+space:bsize() == 2 * size
+space:rename('tweedledee2')
+space:bsize() == 2 * size
+space:rename('tweedledee')
+stat = box.stat.spaces().tweedledee
+stat.bsize == space:bsize()
+stat.index[0].keys
+stat.index[1].keys
+stat.index[0].bsize > 0
+stat.index[1].bsize > 0
+index2:drop()
+box.stat.spaces().tweedledee.index[1]
+space:bsize() == 2 * size
+_ = space:delete{1}
+_ = space:delete{2}
+space:bsize()
+_ = space:insert{1, 'a'}
+_ = space:insert{2, 'a'}
+space:truncate()
+space:bsize()
+box.stat.spaces().tweedledee.bsize
+-- recovery restores the size
+_ = space:insert{1, 'a'}
+_ = space:insert{2, 'b'}
+box.snapshot()
+_ = space:insert{3, 'c'}
+--# stop server default
+--# start server default
+space = box.space.tweedledee
+size = space:bsize()
+_ = space:insert{4, 'd'}
+size == 3 * (space:bsize() - size)
+box.stat.spaces().tweedledee.bsize == space:bsize()
+box.stat.spaces().tweedledee.index[0].keys
+space:drop()
+box.stat.spaces().tweedledee
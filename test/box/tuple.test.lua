@@ -289,4 +289,37 @@ map['test'] = 48
 map
 getmetatable(map) == nil
 
+-- field accessors without Lua strings
+ffi = require('ffi')
+digest = require('digest')
+t = box.tuple.new({'abc', string.rep('x', 40), 42, -1, 1.5, 18446744073709551615ULL, {}})
+t:field_number(3), t:field_number(4), t:field_number(5)
+t:field_number(6) == 2^64
+t:field_number(1) == nil, t:field_number(7) == nil, t:field_number(8) == nil
+data, len = t:field_string(1)
+ffi.string(data, len), len
+data, len = t:field_string(2)
+ffi.string(data, len) == t[2], len
+t:field_string(3) == nil, t:field_string(8) == nil
+t:field_compare(1, 'abc'), t:field_compare(1, 'abd') < 0, t:field_compare(1, 'ab') > 0
+t:field_compare(1, 'abcd') < 0, t:field_compare(3, 'abc') == nil
+t:field_hash(1) == digest.murmur('abc'), t:field_hash(2) == digest.murmur(t[2])
+t:field_hash(3) == nil
+-- field_string() copies the data of compressed and dictionary-encoded tuples
+s = box.schema.space.create('packed', {compress = 16})
+_ = s:create_index('primary')
+for i = 1, 6 do s:insert{i, string.rep(string.char(96 + i), 40)} end
+t = s:get{1}
+data, len = t:field_string(2)
+for i = 2, 6 do _ = s:get{i}[2] end
+ffi.string(data, len) == string.rep('a', 40), len
+t:field_compare(2, string.rep('a', 40)), t:field_hash(2) == digest.murmur(t[2])
+s:drop()
+s = box.schema.space.create('dict', {dict = {2}})
+_ = s:create_index('primary')
+t = s:insert{1, 'abc'}
+data, len = t:field_string(2)
+ffi.string(data, len), len
+s:drop()
+
 space:drop()
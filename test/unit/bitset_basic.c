@@ -1,5 +1,6 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdbool.h>
 
 #include <bitset/bitset.h>
 
@@ -182,11 +183,149 @@ void test_get_set()
 	footer();
 }
 
+static
+void check_bits(struct bitset *bm, const bool *ref, size_t size)
+{
+	size_t cardinality = 0;
+	for (size_t i = 0; i < size; i++) {
+		fail_unless(bitset_test(bm, i) == ref[i]);
+		if (ref[i])
+			cardinality++;
+	}
+	fail_unless(bitset_cardinality(bm) == cardinality);
+}
+
+static
+void test_containers()
+{
+	header();
+
+	struct bitset bm;
+	bitset_create(&bm, realloc);
+
+	struct bitset_info info;
+	enum { PAGE_BIT = 1280, PAGES = 16, SIZE = PAGE_BIT * PAGES };
+	bool *ref = calloc(SIZE, sizeof(*ref));
+
+	/* Sparse pages are stored as arrays */
+	for (size_t i = 0; i < SIZE; i += 97) {
+		fail_if(bitset_set(&bm, i) < 0);
+		ref[i] = true;
+	}
+	check_bits(&bm, ref, SIZE);
+	bitset_info(&bm, &info);
+	fail_unless(info.pages == PAGES);
+	fail_unless(info.pages_array == PAGES);
+	fail_unless(info.mem_size < info.pages * info.page_total_size);
+
+	/* Long stretches of ones are stored as runs */
+	for (size_t i = 0; i < SIZE; i++) {
+		fail_if(bitset_set(&bm, i) < 0);
+		ref[i] = true;
+	}
+	check_bits(&bm, ref, SIZE);
+	bitset_info(&bm, &info);
+	fail_unless(info.pages_run == PAGES);
+	fail_unless(info.mem_size < info.pages * info.page_total_size);
+
+	/* Random bits are stored as bitmaps */
+	for (size_t i = 0; i < SIZE; i++) {
+		bool value = rand() % 2;
+		if (value) {
+			fail_if(bitset_set(&bm, i) < 0);
+		} else {
+			fail_if(bitset_clear(&bm, i) < 0);
+		}
+		ref[i] = value;
+	}
+	check_bits(&bm, ref, SIZE);
+	bitset_info(&bm, &info);
+	fail_unless(info.pages_bitmap == PAGES);
+
+	/* Random updates move pages between all containers */
+	for (size_t i = 0; i < SIZE * 8; i++) {
+		size_t pos = rand() % SIZE;
+		/* Favor runs in the first half and sparse bits in the rest */
+		bool value = pos < SIZE / 2 ? rand() % 8 != 0 : rand() % 8 == 0;
+		if (value) {
+			fail_if(bitset_set(&bm, pos) < 0);
+		} else {
+			fail_if(bitset_clear(&bm, pos) < 0);
+		}
+		ref[pos] = value;
+	}
+	check_bits(&bm, ref, SIZE);
+	bitset_info(&bm, &info);
+
+	for (size_t i = 0; i < SIZE; i++) {
+		fail_if(bitset_clear(&bm, i) < 0);
+	}
+	fail_unless(bitset_cardinality(&bm) == 0);
+	fail_unless(bitset_mem_size(&bm) == 0);
+
+	free(ref);
+	bitset_destroy(&bm);
+
+	footer();
+}
+
+static bool realloc_fails;
+
+static void *
+realloc_failing(void *ptr, size_t size)
+{
+	if (realloc_fails && size > 0)
+		return NULL;
+	return realloc(ptr, size);
+}
+
+static
+void test_clear_oom()
+{
+	header();
+
+	struct bitset bm;
+	bitset_create(&bm, realloc_failing);
+
+	struct bitset_info info;
+	/* Four runs fill the smallest run container */
+	for (size_t first = 0; first < 120; first += 30) {
+		for (size_t i = first; i < first + 20; i++)
+			fail_if(bitset_set(&bm, i) < 0);
+	}
+	bitset_info(&bm, &info);
+	fail_unless(info.pages_run == 1);
+
+	realloc_fails = true;
+	fail_unless(bitset_set(&bm, 25) < 0);
+	/* Splitting a run needs a larger container */
+	fail_unless(bitset_clear(&bm, 10) == 1);
+	fail_if(bitset_test(&bm, 10));
+	fail_unless(bitset_test(&bm, 9) && bitset_test(&bm, 11));
+	fail_unless(bitset_cardinality(&bm) == 79);
+	bitset_info(&bm, &info);
+	fail_unless(info.pages_bitmap == 1);
+	/* A larger container is kept for the rest */
+	for (size_t i = 0; i < 120; i++) {
+		fail_if(bitset_clear(&bm, i) < 0);
+		fail_if(bitset_test(&bm, i));
+	}
+	fail_unless(bitset_cardinality(&bm) == 0);
+	fail_unless(bitset_mem_size(&bm) == 0);
+	realloc_fails = false;
+
+	bitset_destroy(&bm);
+
+	footer();
+}
+
 int main(int argc, char *argv[])
 {
 	setbuf(stdout, NULL);
 	test_cardinality();
 	test_get_set();
+	test_containers();
+	test_clear_oom();
 
 	return 0;
 }
@@ -474,6 +474,102 @@ void test_disjunction()
 	footer();
 }
 
+static
+void test_empty_pages()
+{
+	header();
+
+	enum { PAGES = 1024, PAGE_BIT = 1280, STEP = 97 };
+
+	struct bitset **bitsets = bitsets_create(2);
+
+	/*
+	 * Both bitsets have every page, but the conjunction is
+	 * only non-empty on every STEP-th page.
+	 */
+	size_t expected = 0;
+	for (size_t p = 0; p < PAGES; p++) {
+		size_t first_pos = p * PAGE_BIT;
+		bitset_set(bitsets[0], first_pos + 1);
+		bitset_set(bitsets[1], first_pos + 2);
+		if (p % STEP == 0) {
+			bitset_set(bitsets[0], first_pos + PAGE_BIT - 1);
+			bitset_set(bitsets[1], first_pos + PAGE_BIT - 1);
+			expected++;
+		}
+	}
+
+	struct bitset_expr expr;
+	bitset_expr_create(&expr, realloc);
+	fail_unless(bitset_expr_add_conj(&expr) == 0);
+	fail_unless(bitset_expr_add_param(&expr, 0, false) == 0);
+	fail_unless(bitset_expr_add_param(&expr, 1, false) == 0);
+
+	struct bitset_iterator it;
+	bitset_iterator_create(&it, realloc);
+	fail_unless(bitset_iterator_init(&it, &expr, bitsets, 2) == 0);
+	bitset_expr_destroy(&expr);
+
+	for (size_t p = 0; p < PAGES; p += STEP) {
+		size_t pos = bitset_iterator_next(&it);
+		fail_unless(pos == p * PAGE_BIT + PAGE_BIT - 1);
+	}
+	fail_unless(bitset_iterator_next(&it) == SIZE_MAX);
+
+	fail_unless(bitset_iterator_count(&it) == expected);
+	bitset_iterator_rewind(&it);
+	fail_unless(bitset_iterator_next(&it) == PAGE_BIT - 1);
+
+	bitset_iterator_destroy(&it);
+
+	bitsets_destroy(bitsets, 2);
+
+	footer();
+}
+
+static
+void test_count()
+{
+	header();
+
+	enum { BITSETS_SIZE = 4 };
+
+	struct bitset **bitsets = bitsets_create(BITSETS_SIZE);
+
+	nums_shuffle(NUMS, NUMS_SIZE);
+	for (size_t i = 0; i < NUMS_SIZE; i++) {
+		bitset_set(bitsets[i % BITSETS_SIZE], NUMS[i]);
+		if (i % 3 == 0)
+			bitset_set(bitsets[(i + 1) % BITSETS_SIZE], NUMS[i]);
+	}
+
+	struct bitset_expr expr;
+	bitset_expr_create(&expr, realloc);
+	fail_unless(bitset_expr_add_conj(&expr) == 0);
+	fail_unless(bitset_expr_add_param(&expr, 0, false) == 0);
+	fail_unless(bitset_expr_add_param(&expr, 2, true) == 0);
+	fail_unless(bitset_expr_add_conj(&expr) == 0);
+	fail_unless(bitset_expr_add_param(&expr, 1, false) == 0);
+	fail_unless(bitset_expr_add_param(&expr, 3, true) == 0);
+
+	struct bitset_iterator it;
+	bitset_iterator_create(&it, realloc);
+	fail_unless(bitset_iterator_init(&it, &expr, bitsets, BITSETS_SIZE) == 0);
+	bitset_expr_destroy(&expr);
+
+	size_t count = 0;
+	while (bitset_iterator_next(&it) != SIZE_MAX)
+		count++;
+	fail_unless(count > 0);
+	fail_unless(bitset_iterator_count(&it) == count);
+
+	bitset_iterator_destroy(&it);
+
+	bitsets_destroy(bitsets, BITSETS_SIZE);
+
+	footer();
+}
+
 int main(void)
 {
 	setbuf(stdout, NULL);
@@ -489,6 +585,8 @@ int main(void)
 	test_not_empty();
 	test_not_last();
 	test_disjunction();
+	test_empty_pages();
+	test_count();
 
 	return 0;
 }
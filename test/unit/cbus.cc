@@ -0,0 +1,183 @@
+#include "memory.h"
+#include "fiber.h"
+#include "cbus.h"
+#include "unit.h"
+#include <stdio.h>
+
+/*
+ * Messages between the main cord and a worker cord: a burst
+ * of round trips to measure throughput, and a sequence of
+ * cbus_call() to measure latency. The numbers differ from run
+ * to run, so they are printed only if the test is run with
+ * an argument: cbus.test -v
+ */
+
+enum {
+	MESSAGES = 200000,
+	CALLS = 20000,
+};
+
+struct ping_msg {
+	struct cmsg base;
+	int seq;
+};
+
+static struct cord worker_cord;
+static struct cbus_endpoint main_endpoint;
+static struct cbus_endpoint worker_endpoint;
+/** Created in the main cord. */
+static struct cpipe to_worker;
+/** Created in the worker cord. */
+static struct cpipe to_main;
+
+static bool worker_is_ready;
+static bool worker_is_stopped;
+static struct fiber *worker_fiber;
+
+static struct ping_msg msgs[MESSAGES];
+static int worker_seq;
+static int main_seq;
+static struct fiber *main_fiber;
+static bool verbose;
+
+static void
+ping_f(struct cmsg *m)
+{
+	struct ping_msg *msg = (struct ping_msg *) m;
+	/* Messages of one pipe arrive in order. */
+	fail_unless(msg->seq == worker_seq);
+	worker_seq++;
+}
+
+static void
+pong_f(struct cmsg *m)
+{
+	struct ping_msg *msg = (struct ping_msg *) m;
+	fail_unless(msg->seq == main_seq);
+	if (++main_seq == MESSAGES)
+		fiber_wakeup(main_fiber);
+}
+
+static const struct cmsg_hop ping_route[] = {
+	{ ping_f, &to_main },
+	{ pong_f, NULL },
+};
+
+static void
+stop_f(struct cmsg * /* msg */)
+{
+	worker_is_stopped = true;
+	fiber_wakeup(worker_fiber);
+}
+
+static const struct cmsg_hop stop_route[] = {
+	{ stop_f, NULL },
+};
+
+static void
+worker_f(va_list /* ap */)
+{
+	worker_fiber = fiber();
+	cbus_endpoint_create(&worker_endpoint);
+	cpipe_create(&to_main, &main_endpoint);
+	__atomic_store_n(&worker_is_ready, true, __ATOMIC_RELEASE);
+	while (! worker_is_stopped)
+		fiber_yield();
+	cpipe_destroy(&to_main);
+	cbus_endpoint_destroy(&worker_endpoint);
+}
+
+static double
+since(ev_tstamp start)
+{
+	ev_now_update(loop());
+	return ev_now(loop()) - start;
+}
+
+static void
+cbus_throughput()
+{
+	header();
+	ev_now_update(loop());
+	ev_tstamp start = ev_now(loop());
+	for (int i = 0; i < MESSAGES; i++) {
+		cmsg_init(&msgs[i].base, ping_route);
+		msgs[i].seq = i;
+		cpipe_push(&to_worker, &msgs[i].base);
+	}
+	while (main_seq < MESSAGES)
+		fiber_yield();
+	double elapsed = since(start);
+	if (verbose) {
+		fprintf(stderr, "throughput: %.0f round trips per second\n",
+			MESSAGES / elapsed);
+	}
+	fail_unless(worker_seq == MESSAGES);
+	footer();
+}
+
+static int
+call_f(struct cbus_call_msg *msg)
+{
+	(void) msg;
+	fail_unless(cord() == &worker_cord);
+	/* The function runs in a fiber and may yield. */
+	fiber_wakeup(fiber());
+	fiber_yield();
+	return 42;
+}
+
+static void
+cbus_latency()
+{
+	header();
+	ev_now_update(loop());
+	ev_tstamp start = ev_now(loop());
+	for (int i = 0; i < CALLS; i++) {
+		struct cbus_call_msg msg;
+		fail_unless(cbus_call(&to_worker, &to_main, &msg,
+				      call_f) == 42);
+	}
+	double elapsed = since(start);
+	if (verbose) {
+		fprintf(stderr, "latency: %.2f us per call\n",
+			elapsed * 1e6 / CALLS);
+	}
+	footer();
+}
+
+static void
+main_f(va_list /* ap */)
+{
+	main_fiber = fiber();
+	cbus_endpoint_create(&main_endpoint);
+	fail_unless(cord_costart(&worker_cord, "worker", worker_f,
+				 NULL) == 0);
+	while (! __atomic_load_n(&worker_is_ready, __ATOMIC_ACQUIRE))
+		fiber_sleep(0.001);
+	cpipe_create(&to_worker, &worker_endpoint);
+
+	cbus_throughput();
+	cbus_latency();
+
+	struct cmsg stop;
+	cmsg_init(&stop, stop_route);
+	cpipe_push(&to_worker, &stop);
+	cpipe_destroy(&to_worker);
+	cord_join(&worker_cord);
+	cbus_endpoint_destroy(&main_endpoint);
+	ev_break(loop(), EVBREAK_ALL);
+}
+
+int main(int argc, char ** /* argv */)
+{
+	verbose = argc > 1;
+	memory_init();
+	fiber_init();
+	struct fiber *main = fiber_new("main", main_f);
+	fiber_wakeup(main);
+	ev_run(loop(), 0);
+	fiber_free();
+	memory_free();
+	return 0;
+}
@@ -0,0 +1,107 @@
+#include "memory.h"
+#include "fiber.h"
+#include "coeio.h"
+#include "unit.h"
+#include <errno.h>
+#include <unistd.h>
+
+/*
+ * Calls in a coio pool complete while the libeio threads are
+ * busy with slow calls, and a burst of calls completes in
+ * batches.
+ */
+
+enum {
+	SLOW_CALLS = 16,
+	POOL_CALLS = 1000,
+	POOL_THREADS = 4,
+};
+
+static const double SLOW_CALL_TIME = 0.2;
+
+static int slow_calls_done;
+static int pool_calls_done;
+
+static ssize_t
+sleep_cb(va_list ap)
+{
+	double delay = va_arg(ap, double);
+	usleep(delay * 1000000);
+	return 0;
+}
+
+static ssize_t
+echo_cb(va_list ap)
+{
+	int value = va_arg(ap, int);
+	errno = value;
+	return value;
+}
+
+static void
+slow_f(va_list /* ap */)
+{
+	coio_call(sleep_cb, SLOW_CALL_TIME);
+	slow_calls_done++;
+}
+
+static void
+pool_f(va_list ap)
+{
+	struct coio_pool *pool = va_arg(ap, struct coio_pool *);
+	int value = va_arg(ap, int);
+	fail_unless(coio_pool_call(pool, echo_cb, value) == value);
+	fail_unless(errno == value);
+	pool_calls_done++;
+}
+
+static void
+coio_pool_test()
+{
+	header();
+
+	struct coio_pool *pool = coio_pool_new("test", POOL_THREADS);
+	fail_unless(pool != NULL);
+	fail_unless(coio_pool_by_name("test") == pool);
+	fail_unless(coio_pool_by_name("system") == coio_system_pool);
+
+	/* Occupy all libeio threads. */
+	for (int i = 0; i < SLOW_CALLS; i++)
+		fiber_start(fiber_new("slow", slow_f));
+	ev_tstamp start = ev_time();
+	fail_unless(coio_pool_call(coio_system_pool, echo_cb, 1) == 1);
+	fail_unless(ev_time() - start < SLOW_CALL_TIME);
+	fail_unless(slow_calls_done == 0);
+
+	for (int i = 0; i < POOL_CALLS; i++)
+		fiber_start(fiber_new("pool", pool_f), pool, i % 100 + 1);
+	while (pool_calls_done < POOL_CALLS)
+		fiber_sleep(0.001);
+	while (slow_calls_done < SLOW_CALLS)
+		fiber_sleep(0.01);
+
+	coio_pool_delete(pool);
+	fail_unless(coio_pool_by_name("test") == NULL);
+
+	footer();
+}
+
+static void
+main_f(va_list /* ap */)
+{
+	coio_pool_test();
+	ev_break(loop(), EVBREAK_ALL);
+}
+
+int main()
+{
+	memory_init();
+	fiber_init();
+	coeio_init();
+	struct fiber *main = fiber_new("main", main_f);
+	fiber_wakeup(main);
+	ev_run(loop(), 0);
+	fiber_free();
+	memory_free();
+	return 0;
+}
@@ -1,6 +1,9 @@
 #include "memory.h"
 #include "fiber.h"
 #include "unit.h"
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 static void
 noop_f(va_list ap)
@@ -95,10 +98,243 @@ fiber_join_test()
 	footer();
 }
 
+static void
+stack_f(va_list ap)
+{
+	size_t size = va_arg(ap, size_t);
+	char *buf = (char *) alloca(size);
+	memset(buf, 0, size);
+}
+
+/**
+ * The number of resident bytes in a page-aligned range,
+ * or -1 if it is not mapped.
+ */
+static ssize_t
+resident_size(void *addr, size_t size)
+{
+	const size_t page = sysconf(_SC_PAGESIZE);
+	size_t count = size / page;
+	unsigned char vec[count];
+	if (mincore(addr, size, vec) != 0) {
+		fail_unless(errno == ENOMEM);
+		return -1;
+	}
+	ssize_t resident = 0;
+	for (size_t i = 0; i < count; i++)
+		resident += (vec[i] & 1) * page;
+	return resident;
+}
+
+/** The bytes of a dead fiber stack which should be released. */
+static ssize_t
+cold_stack_resident_size(struct fiber *fiber)
+{
+	return resident_size(fiber->coro.stack,
+			     fiber->coro.stack_size - FIBER_STACK_WARM);
+}
+
+static void
+fiber_stack_test()
+{
+	header();
+
+	/* Deeper than the default stack. */
+	size_t size = 2 * FIBER_STACK_SIZE_DEFAULT;
+	fiber_set_stack_size(4 * FIBER_STACK_SIZE_DEFAULT);
+	struct fiber *fiber = fiber_new("stack", stack_f);
+	fail_unless(fiber->coro.stack_size == 4 * FIBER_STACK_SIZE_DEFAULT);
+	fiber_set_joinable(fiber, true);
+	fiber_start(fiber, size);
+	fiber_join(fiber);
+
+	/* A dead fiber gets a stack of the new size on reuse. */
+	fiber_set_stack_size(FIBER_STACK_SIZE_DEFAULT);
+	fiber = fiber_new("stack", stack_f);
+	fail_unless(fiber->coro.stack_size == FIBER_STACK_SIZE_DEFAULT);
+	fiber_set_joinable(fiber, true);
+	fiber_start(fiber, (size_t) FIBER_STACK_WARM);
+	fiber_join(fiber);
+
+	/* Fibers beyond the warm pool release their stacks. */
+	struct fiber *fibers[FIBER_POOL_WARM * 2];
+	for (int i = 0; i < FIBER_POOL_WARM * 2; i++) {
+		fibers[i] = fiber_new("stack", stack_f);
+		fiber_set_joinable(fibers[i], true);
+		fiber_start(fibers[i], size / 4);
+	}
+	for (int i = 0; i < FIBER_POOL_WARM * 2; i++)
+		fiber_join(fibers[i]);
+	fail_unless(cord()->dead_count >= FIBER_POOL_WARM * 2);
+	fail_unless(cord()->warm_count == FIBER_POOL_WARM);
+	uint32_t pos = 0;
+	rlist_foreach_entry(fiber, &cord()->dead, link) {
+		if (pos++ >= cord()->warm_count)
+			fail_unless(cold_stack_resident_size(fiber) == 0);
+	}
+	for (int i = 0; i < FIBER_POOL_WARM * 2; i++) {
+		fibers[i] = fiber_new("stack", stack_f);
+		fiber_set_joinable(fibers[i], true);
+		fiber_start(fibers[i], size / 4);
+	}
+	for (int i = 0; i < FIBER_POOL_WARM * 2; i++)
+		fiber_join(fibers[i]);
+	fail_unless(cord()->warm_count == FIBER_POOL_WARM);
+
+	footer();
+}
+
+static void
+coro_f(void *data)
+{
+	(void) data;
+}
+
+static void
+coro_stack_test()
+{
+	header();
+
+	const size_t page = sysconf(_SC_PAGESIZE);
+	const size_t stack_size = FIBER_STACK_SIZE_DEFAULT;
+	struct coro_stack_cache cache;
+	coro_stack_cache_create(&cache);
+	struct tarantool_coro coros[CORO_STACK_CHUNK + 1];
+	for (int i = 0; i < CORO_STACK_CHUNK + 1; i++) {
+		tarantool_coro_create(&coros[i], &cache, stack_size,
+				      coro_f, NULL);
+		memset(coros[i].stack, 1, stack_size);
+	}
+	/* Stacks of a chunk are adjacent, each above its guard. */
+	fail_unless(coros[1].chunk == coros[0].chunk);
+	fail_unless((char *) coros[1].stack ==
+		    (char *) coros[0].stack + stack_size + page);
+	fail_unless(coros[CORO_STACK_CHUNK].chunk != coros[0].chunk);
+
+	/* A destroyed stack is released and then reused. */
+	void *stack = coros[1].stack;
+	tarantool_coro_destroy(&coros[1]);
+	fail_unless(resident_size(stack, stack_size) == 0);
+	tarantool_coro_create(&coros[1], &cache, stack_size, coro_f, NULL);
+	fail_unless(coros[1].stack == stack);
+
+	/* A chunk without stacks in use is unmapped. */
+	char *map = coros[0].chunk->map;
+	for (int i = 0; i < CORO_STACK_CHUNK + 1; i++)
+		tarantool_coro_destroy(&coros[i]);
+	fail_unless(resident_size(map, CORO_STACK_CHUNK *
+				  (stack_size + page)) == -1);
+	fail_unless(rlist_empty(&cache.chunks));
+
+	footer();
+}
+
+enum { TIMEOUT_FIBERS = 1000 };
+
+static int timeouts_fired;
+
+/** The timer wheel runs on the monotonic clock. */
+static double
+monotonic_time()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+timeout_f(va_list ap)
+{
+	double delay = va_arg(ap, double);
+	double start = monotonic_time();
+	if (fiber_yield_timeout(delay)) {
+		/* Never early, at most a few ticks late. */
+		fail_unless(monotonic_time() - start >= delay);
+		fail_unless(monotonic_time() - start < delay + 0.1);
+		timeouts_fired++;
+	}
+}
+
+static void
+fiber_timeout_test()
+{
+	header();
+
+	/* Coarse timeouts, which go to the timer wheel. */
+	struct fiber *fibers[TIMEOUT_FIBERS];
+	for (int i = 0; i < TIMEOUT_FIBERS; i++) {
+		fibers[i] = fiber_new("timeout", timeout_f);
+		fiber_set_joinable(fibers[i], true);
+		fiber_start(fibers[i], 1.0 + (i % 50) * 0.001);
+	}
+	/* Half of them are woken up before the timeout. */
+	for (int i = 0; i < TIMEOUT_FIBERS; i += 2)
+		fiber_wakeup(fibers[i]);
+	/* A timeout far beyond the range of the wheel. */
+	struct fiber *far = fiber_new("timeout", timeout_f);
+	fiber_set_joinable(far, true);
+	fiber_start(far, 1e6);
+	/* An infinite timeout doesn't need a timer at all. */
+	struct fiber *infinite = fiber_new("timeout", timeout_f);
+	fiber_set_joinable(infinite, true);
+	fiber_start(infinite, TIMEOUT_INFINITY);
+	for (int i = 0; i < TIMEOUT_FIBERS; i++)
+		fiber_join(fibers[i]);
+	fail_unless(timeouts_fired == TIMEOUT_FIBERS / 2);
+	fail_unless(cord()->wheel.count == 1);
+	fiber_wakeup(far);
+	fiber_join(far);
+	fail_unless(cord()->wheel.count == 0);
+	fiber_wakeup(infinite);
+	fiber_join(infinite);
+
+	footer();
+}
+
+enum { STAT_REGION_SIZE = 100000 };
+
+static void
+stat_f(va_list ap)
+{
+	double busy = va_arg(ap, double);
+	ev_tstamp start = ev_time();
+	while (ev_time() - start < busy)
+		;
+	region_alloc(&fiber()->gc, STAT_REGION_SIZE);
+	fiber_gc();
+	fiber_yield();
+}
+
+static void
+fiber_stat_test()
+{
+	header();
+
+	struct fiber *fiber = fiber_new("stat", stat_f);
+	fiber_set_joinable(fiber, true);
+	fiber_start(fiber, 0.05);
+	/* Only the time the fiber holds the CPU is counted. */
+	fail_unless(fiber_cpu_time(fiber) >= 0.04);
+	fail_unless(fiber_cpu_time(fiber) < 1);
+	fail_unless(region_used(&fiber->gc) == 0);
+	fail_unless(fiber_gc_peak(fiber) >= STAT_REGION_SIZE);
+	uint64_t cpu_ticks = fiber->cpu_ticks;
+	fiber_sleep(0.05);
+	fail_unless(fiber->cpu_ticks == cpu_ticks);
+	fiber_wakeup(fiber);
+	fiber_join(fiber);
+
+	footer();
+}
+
 static void
 main_f(va_list ap)
 {
 	fiber_join_test();
+	fiber_stack_test();
+	coro_stack_test();
+	fiber_timeout_test();
+	fiber_stat_test();
 	ev_break(loop(), EVBREAK_ALL);
 }
 
@@ -0,0 +1,273 @@
+#include "memory.h"
+#include "fiber.h"
+#include "ipc.h"
+#include "unit.h"
+#include <errno.h>
+
+/*
+ * Latches, read-write locks, conditions and semaphores: FIFO
+ * hand-over, timeouts, cancellation and contention counters.
+ */
+
+enum { WAITERS = 3 };
+
+static int order[WAITERS * 2];
+static int order_count;
+
+static void
+latch_f(va_list ap)
+{
+	struct ipc_latch *latch = va_arg(ap, struct ipc_latch *);
+	int id = va_arg(ap, int);
+	ipc_latch_lock(latch);
+	order[order_count++] = id;
+	fiber_sleep(0);
+	ipc_latch_unlock(latch);
+}
+
+static void
+latch_timeout_f(va_list ap)
+{
+	struct ipc_latch *latch = va_arg(ap, struct ipc_latch *);
+	fail_unless(ipc_latch_lock_timeout(latch, 0.01) == -1);
+	fail_unless(errno == ETIMEDOUT);
+}
+
+static void
+latch_test()
+{
+	header();
+
+	struct ipc_latch latch;
+	ipc_latch_create(&latch);
+	ipc_latch_lock(&latch);
+	fail_unless(ipc_latch_owner(&latch) == fiber());
+	struct fiber *fibers[WAITERS];
+	for (int i = 0; i < WAITERS; i++) {
+		fibers[i] = fiber_new("latch", latch_f);
+		fiber_set_joinable(fibers[i], true);
+		fiber_start(fibers[i], &latch, i);
+	}
+	struct fiber *timeout = fiber_new("latch", latch_timeout_f);
+	fiber_set_joinable(timeout, true);
+	fiber_start(timeout, &latch);
+	fiber_join(timeout);
+	ipc_latch_unlock(&latch);
+	/* Handed over: can't be taken while the waiters run. */
+	fail_unless(! ipc_latch_trylock(&latch));
+	for (int i = 0; i < WAITERS; i++)
+		fiber_join(fibers[i]);
+	/* In the order of arrival. */
+	for (int i = 0; i < WAITERS; i++)
+		fail_unless(order[i] == i);
+	fail_unless(latch.stat.acquired == WAITERS + 1);
+	fail_unless(latch.stat.waited == WAITERS + 1);
+	fail_unless(latch.stat.timedout == 1);
+	fail_unless(ipc_latch_trylock(&latch));
+	ipc_latch_unlock(&latch);
+	ipc_latch_destroy(&latch);
+
+	footer();
+}
+
+static void
+rwlock_f(va_list ap)
+{
+	struct ipc_rwlock *rwlock = va_arg(ap, struct ipc_rwlock *);
+	int id = va_arg(ap, int);
+	bool is_reader = va_arg(ap, int);
+	if (is_reader)
+		ipc_rwlock_rdlock(rwlock);
+	else
+		ipc_rwlock_wrlock(rwlock);
+	order[order_count++] = id;
+	fiber_sleep(0.01);
+	if (! is_reader)
+		fail_unless(rwlock->readers == 0);
+	ipc_rwlock_unlock(rwlock);
+}
+
+static void
+wrlock_timeout_f(va_list ap)
+{
+	struct ipc_rwlock *rwlock = va_arg(ap, struct ipc_rwlock *);
+	fail_unless(ipc_rwlock_wrlock_timeout(rwlock, 0.01) == -1);
+	fail_unless(errno == ETIMEDOUT);
+}
+
+static void
+rwlock_test()
+{
+	header();
+
+	struct ipc_rwlock rwlock;
+	ipc_rwlock_create(&rwlock);
+	order_count = 0;
+	/* Readers 0 and 1 share the lock, writer 2 waits. */
+	struct fiber *fibers[4];
+	static const bool is_reader[4] = { true, true, false, true };
+	for (int i = 0; i < 4; i++) {
+		fibers[i] = fiber_new("rwlock", rwlock_f);
+		fiber_set_joinable(fibers[i], true);
+		fiber_start(fibers[i], &rwlock, i, (int) is_reader[i]);
+	}
+	fail_unless(rwlock.readers == 2);
+	/* Reader 3 came after the writer and waits for it. */
+	fail_unless(order_count == 2);
+	fail_unless(! ipc_rwlock_tryrdlock(&rwlock));
+	for (int i = 0; i < 4; i++)
+		fiber_join(fibers[i]);
+	fail_unless(order_count == 4);
+	fail_unless(order[2] == 2 && order[3] == 3);
+
+	/* A writer which times out lets the readers behind through. */
+	fail_unless(ipc_rwlock_tryrdlock(&rwlock));
+	order_count = 0;
+	struct fiber *writer = fiber_new("rwlock", wrlock_timeout_f);
+	fiber_set_joinable(writer, true);
+	fiber_start(writer, &rwlock);
+	fibers[0] = fiber_new("rwlock", rwlock_f);
+	fiber_set_joinable(fibers[0], true);
+	fiber_start(fibers[0], &rwlock, 0, (int) true);
+	fail_unless(order_count == 0);
+	fiber_join(writer);
+	fiber_join(fibers[0]);
+	fail_unless(order_count == 1);
+	fail_unless(rwlock.stat.timedout == 1);
+	ipc_rwlock_unlock(&rwlock);
+	fail_unless(ipc_rwlock_trywrlock(&rwlock));
+	fail_unless(! ipc_rwlock_tryrdlock(&rwlock));
+	ipc_rwlock_unlock(&rwlock);
+	fail_unless(rwlock.writer == NULL && rwlock.readers == 0);
+	ipc_rwlock_destroy(&rwlock);
+
+	footer();
+}
+
+static struct ipc_cond cond;
+static struct ipc_latch cond_latch;
+static int cond_woken;
+
+static void
+cond_f(va_list ap)
+{
+	double timeout = va_arg(ap, double);
+	ipc_latch_lock(&cond_latch);
+	if (ipc_cond_wait_timeout(&cond, &cond_latch, timeout) == 0)
+		cond_woken++;
+	fail_unless(ipc_latch_owner(&cond_latch) == fiber());
+	ipc_latch_unlock(&cond_latch);
+}
+
+static void
+cond_test()
+{
+	header();
+
+	ipc_cond_create(&cond);
+	ipc_latch_create(&cond_latch);
+	struct fiber *fibers[WAITERS + 1];
+	for (int i = 0; i < WAITERS; i++) {
+		fibers[i] = fiber_new("cond", cond_f);
+		fiber_set_joinable(fibers[i], true);
+		fiber_start(fibers[i], TIMEOUT_INFINITY);
+	}
+	fibers[WAITERS] = fiber_new("cond", cond_f);
+	fiber_set_joinable(fibers[WAITERS], true);
+	fiber_start(fibers[WAITERS], 0.01);
+	fiber_join(fibers[WAITERS]);
+	fail_unless(cond.stat.timedout == 1);
+	ipc_cond_signal(&cond);
+	fiber_sleep(0);
+	fail_unless(cond_woken == 1);
+	ipc_cond_broadcast(&cond);
+	for (int i = 0; i < WAITERS; i++)
+		fiber_join(fibers[i]);
+	fail_unless(cond_woken == WAITERS);
+	ipc_latch_destroy(&cond_latch);
+	ipc_cond_destroy(&cond);
+
+	footer();
+}
+
+static int sem_holders;
+static int sem_holders_max;
+
+static void
+sem_f(va_list ap)
+{
+	struct ipc_sem *sem = va_arg(ap, struct ipc_sem *);
+	ipc_sem_acquire(sem);
+	if (++sem_holders > sem_holders_max)
+		sem_holders_max = sem_holders;
+	fiber_sleep(0.001);
+	sem_holders--;
+	ipc_sem_release(sem);
+}
+
+static void
+cancel_f(va_list ap)
+{
+	struct ipc_sem *sem = va_arg(ap, struct ipc_sem *);
+	ipc_sem_acquire(sem);
+	fail("unreachable", "acquired");
+}
+
+static void
+sem_test()
+{
+	header();
+
+	struct ipc_sem sem;
+	ipc_sem_create(&sem, 2);
+	struct fiber *fibers[WAITERS * 2];
+	for (int i = 0; i < WAITERS * 2; i++) {
+		fibers[i] = fiber_new("sem", sem_f);
+		fiber_set_joinable(fibers[i], true);
+		fiber_start(fibers[i], &sem);
+	}
+	for (int i = 0; i < WAITERS * 2; i++)
+		fiber_join(fibers[i]);
+	fail_unless(sem_holders_max == 2);
+	fail_unless(sem.count == 2);
+	fail_unless(sem.stat.acquired == WAITERS * 2);
+	fail_unless(sem.stat.waited == WAITERS * 2 - 2);
+
+	/* A cancelled waiter leaves the queue. */
+	fail_unless(ipc_sem_tryacquire(&sem));
+	fail_unless(ipc_sem_tryacquire(&sem));
+	struct fiber *cancel = fiber_new("sem", cancel_f);
+	fiber_set_joinable(cancel, true);
+	fiber_start(cancel, &sem);
+	fiber_cancel(cancel);
+	fiber_join(cancel);
+	fail_unless(rlist_empty(&sem.queue));
+	ipc_sem_release(&sem);
+	ipc_sem_release(&sem);
+	fail_unless(sem.count == 2);
+	ipc_sem_destroy(&sem);
+
+	footer();
+}
+
+static void
+main_f(va_list /* ap */)
+{
+	latch_test();
+	rwlock_test();
+	cond_test();
+	sem_test();
+	ev_break(loop(), EVBREAK_ALL);
+}
+
+int main()
+{
+	memory_init();
+	fiber_init();
+	struct fiber *main = fiber_new("main", main_f);
+	fiber_wakeup(main);
+	ev_run(loop(), 0);
+	fiber_free();
+	memory_free();
+	return 0;
+}
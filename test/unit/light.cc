@@ -317,6 +317,60 @@ itr_freeze_check()
 	footer();
 }
 
+static void
+reserve_test()
+{
+	header();
+
+	const size_t test_data_size = 10000;
+	struct light_core ht;
+
+	/* Reserve an empty table */
+	light_create(&ht, light_extent_size, my_light_alloc, my_light_free, 0);
+	if (light_reserve(&ht, test_data_size) != 0)
+		fail("reserve failed", "true");
+	if (ht.table_size < test_data_size)
+		fail("reserved size is too small", "true");
+	if (light_selfcheck(&ht))
+		fail("internal test failed!", "true");
+	uint32_t table_size = ht.table_size;
+	for (hash_value_t val = 0; val < test_data_size; val++)
+		light_insert(&ht, hash(val), val);
+	if (ht.table_size != table_size)
+		fail("table has grown after reserve", "true");
+	if (light_selfcheck(&ht))
+		fail("internal test failed!", "true");
+	for (hash_value_t val = 0; val < test_data_size; val++) {
+		if (light_find(&ht, hash(val), val) == light_end)
+			fail("find key failed!", "true");
+	}
+
+	/* A non-empty table is not resized */
+	if (light_reserve(&ht, test_data_size * 3) != 0)
+		fail("reserve failed", "true");
+	if (ht.table_size != table_size)
+		fail("non-empty table has been resized", "true");
+	if (light_selfcheck(&ht))
+		fail("internal test failed!", "true");
+	for (hash_value_t val = 0; val < test_data_size; val++) {
+		if (light_find(&ht, hash(val), val) == light_end)
+			fail("find key failed!", "true");
+	}
+	if (ht.count != test_data_size)
+		fail("count check failed!", "true");
+	light_destroy(&ht);
+
+	/* Too large a size is rejected without allocating */
+	light_create(&ht, light_extent_size, my_light_alloc, my_light_free, 0);
+	if (light_reserve(&ht, UINT32_MAX) == 0)
+		fail("too large reserve succeeded", "true");
+	if (ht.table_size != 0)
+		fail("table has been allocated", "true");
+	light_destroy(&ht);
+
+	footer();
+}
+
 int
 main(int, const char**)
 {
@@ -325,6 +379,7 @@ main(int, const char**)
 	collision_test();
 	itr_test();
 	itr_freeze_check();
+	reserve_test();
 	if (extents_count != 0)
 		fail("memory leak!", "true");
 }
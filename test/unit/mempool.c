@@ -112,6 +112,52 @@ mempool_align()
 	footer();
 }
 
+void
+mempool_relocate()
+{
+	header();
+
+	mempool_create(&pool, &cache, 64);
+	uint32_t count = pool.objcount * 8;
+	void **objs = (void **) calloc(count, sizeof(*objs));
+	for (uint32_t i = 0; i < count; i++)
+		objs[i] = mempool_alloc_nothrow(&pool);
+	/* Full slabs are never fragmented. */
+	for (uint32_t i = 0; i < count; i++) {
+		if (mempool_should_relocate(&pool, objs[i]))
+			fail("relocate", "full slab");
+	}
+	/* Leave every 4th object alive. */
+	for (uint32_t i = 0; i < count; i++) {
+		if (i % 4 == 0)
+			continue;
+		mempool_free(&pool, objs[i]);
+		objs[i] = NULL;
+	}
+	size_t total = mempool_total(&pool);
+	/* Move objects around until nothing is worth moving. */
+	bool moved;
+	do {
+		moved = false;
+		for (uint32_t i = 0; i < count; i++) {
+			if (objs[i] == NULL ||
+			    ! mempool_should_relocate(&pool, objs[i]))
+				continue;
+			void *copy = mempool_alloc_nothrow(&pool);
+			memcpy(copy, objs[i], pool.objsize);
+			mempool_free(&pool, objs[i]);
+			objs[i] = copy;
+			moved = true;
+		}
+	} while (moved);
+	fail_unless(mempool_used(&pool) == count / 4 * pool.objsize);
+	fail_unless(mempool_total(&pool) * 2 < total);
+	free(objs);
+	mempool_destroy(&pool);
+
+	footer();
+}
+
 int main()
 {
 	seed = time(0);
@@ -132,5 +178,7 @@ int main()
 
 	mempool_align();
 
+	mempool_relocate();
+
 	slab_cache_destroy(&cache);
 }
@@ -8,10 +8,16 @@
 #include "salad/rtree.h"
 
 static int page_count = 0;
+/* The number of allocations to succeed, -1 for no limit */
+static int page_alloc_limit = -1;
 
 static void *
 page_alloc()
 {
+	if (page_alloc_limit == 0)
+		return NULL;
+	if (page_alloc_limit > 0)
+		page_alloc_limit--;
 	page_count++;
 	return malloc(RTREE_PAGE_SIZE);
 }
@@ -277,12 +283,123 @@ neighbor_test()
 	footer();
 }
 
+static void
+bulk_load_test()
+{
+	header();
+
+	const unsigned counts[] = { 0, 1, 2, 10, 100, 1000, 10000 };
+	const unsigned max_count = 10000;
+	struct rtree_rect *rects = new struct rtree_rect[max_count];
+	struct rtree_entry *entries = new struct rtree_entry[max_count];
+	struct rtree_iterator iterator;
+	rtree_iterator_init(&iterator);
+
+	for (unsigned i = 0; i < max_count; i++) {
+		coord_t x = rand() % 1000, y = rand() % 1000;
+		rtree_set2d(&rects[i], x, y, x + rand() % 10, y + rand() % 10);
+	}
+
+	for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+		unsigned count = counts[c];
+		struct rtree tree;
+		rtree_init(&tree, page_alloc, page_free);
+
+		for (unsigned i = 0; i < count; i++) {
+			entries[i].rect = rects[i];
+			entries[i].record = (record_t)(uintptr_t)(i + 1);
+		}
+		rtree_build(&tree, entries, count);
+		if (rtree_number_of_records(&tree) != count)
+			fail("Tree count mismatch", "true");
+
+		/* Compare overlap search with a brute force scan */
+		for (unsigned q = 0; q < 100; q++) {
+			struct rtree_rect rect;
+			coord_t x = rand() % 1000, y = rand() % 1000;
+			rtree_set2d(&rect, x, y, x + 50, y + 50);
+			unsigned expected = 0;
+			for (unsigned i = 0; i < count; i++) {
+				if (rects[i].lower_point.coords[0] <= x + 50 &&
+				    rects[i].upper_point.coords[0] >= x &&
+				    rects[i].lower_point.coords[1] <= y + 50 &&
+				    rects[i].upper_point.coords[1] >= y)
+					expected++;
+			}
+			unsigned found = 0;
+			rtree_search(&tree, &rect, SOP_OVERLAPS, &iterator);
+			while (rtree_iterator_next(&iterator) != NULL)
+				found++;
+			if (found != expected)
+				fail("overlap search result", "false");
+		}
+
+		/* The tree remains usable for inserts and removals */
+		struct rtree_rect rect;
+		rtree_set2d(&rect, 2000, 2000, 2001, 2001);
+		rtree_insert(&tree, &rect, (record_t)(uintptr_t)(count + 1));
+		if (!rtree_remove(&tree, &rect,
+				  (record_t)(uintptr_t)(count + 1)))
+			fail("delete inserted element", "false");
+		for (unsigned i = 0; i < count; i++) {
+			if (!rtree_remove(&tree, &rects[i],
+					  (record_t)(uintptr_t)(i + 1)))
+				fail("delete element in tree", "false");
+		}
+		if (rtree_number_of_records(&tree) != 0)
+			fail("Tree count mismatch", "true");
+		rtree_destroy(&tree);
+	}
+
+	rtree_iterator_destroy(&iterator);
+	delete[] entries;
+	delete[] rects;
+
+	footer();
+}
+
+static void
+bulk_load_oom_test()
+{
+	header();
+
+	const unsigned count = 10000;
+	struct rtree_entry *entries = new struct rtree_entry[count];
+
+	/* Fail on a leaf, on the second level and on the root */
+	const int limits[] = { 0, 1, 200, 400, 408, 416 };
+	for (size_t l = 0; l < sizeof(limits) / sizeof(limits[0]); l++) {
+		for (unsigned i = 0; i < count; i++) {
+			coord_t x = rand() % 1000, y = rand() % 1000;
+			rtree_set2d(&entries[i].rect, x, y, x + 1, y + 1);
+			entries[i].record = (record_t)(uintptr_t)(i + 1);
+		}
+		struct rtree tree;
+		rtree_init(&tree, page_alloc, page_free);
+		page_alloc_limit = limits[l];
+		if (rtree_build(&tree, entries, count) == 0)
+			fail("build with a failing allocator", "false");
+		page_alloc_limit = -1;
+		if (page_count != 0)
+			fail("pages of a failed build are freed", "false");
+		if (rtree_number_of_records(&tree) != 0 ||
+		    rtree_used_size(&tree) != 0)
+			fail("the tree is empty after a failed build", "false");
+		rtree_destroy(&tree);
+	}
+
+	delete[] entries;
+
+	footer();
+}
 
 int
 main(void)
 {
 	simple_check();
 	neighbor_test();
+	bulk_load_test();
+	bulk_load_oom_test();
 	if (page_count != 0) {
 		fail("memory leak!", "true");
 	}
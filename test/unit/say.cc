@@ -0,0 +1,115 @@
+#include "memory.h"
+#include "fiber.h"
+#include "say.h"
+#include "unit.h"
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+/*
+ * JSON messages written by the logger cord from a few
+ * threads, and rate limiting of a call site.
+ */
+
+enum {
+	THREADS = 4,
+	MESSAGES_PER_THREAD = 100,
+	RATELIMITED = 20,
+};
+
+static const char *filename = "say.log";
+
+static void *
+log_f(void *arg)
+{
+	int thread = (int)(intptr_t) arg;
+	for (int i = 0; i < MESSAGES_PER_THREAD; i++)
+		say_info("thread %d message %d", thread, i);
+	return NULL;
+}
+
+static void
+say_ratelimit_test()
+{
+	header();
+
+	struct say_ratelimit rl = SAY_RATELIMIT_INITIALIZER;
+	int suppressed;
+	for (int i = 0; i < SAY_RATELIMIT_BURST; i++) {
+		fail_unless(say_ratelimit_check(&rl, &suppressed));
+		fail_unless(suppressed == 0);
+	}
+	fail_unless(! say_ratelimit_check(&rl, &suppressed));
+	fail_unless(! say_ratelimit_check(&rl, &suppressed));
+	/* The next interval. */
+	rl.start -= SAY_RATELIMIT_INTERVAL + 1;
+	fail_unless(say_ratelimit_check(&rl, &suppressed));
+	fail_unless(suppressed == 2);
+
+	footer();
+}
+
+static void
+say_json_test()
+{
+	header();
+
+	pthread_t threads[THREADS];
+	for (int i = 0; i < THREADS; i++) {
+		pthread_create(&threads[i], NULL, log_f,
+			       (void *)(intptr_t) i);
+	}
+	for (int i = 0; i < THREADS; i++)
+		pthread_join(threads[i], NULL);
+	say_info("a \"quoted\"\nmessage");
+	for (int i = 0; i < RATELIMITED; i++)
+		say_warn_ratelimited("ratelimited");
+	/* Writes out everything. */
+	say_logger_free();
+
+	FILE *f = fopen(filename, "r");
+	fail_unless(f != NULL);
+	int next[THREADS] = { 0 };
+	int ratelimited = 0;
+	bool quoted = false;
+	char line[PIPE_BUF];
+	while (fgets(line, sizeof(line), f) != NULL) {
+		fail_unless(line[0] == '{');
+		fail_unless(strcmp(line + strlen(line) - 2, "}\n") == 0);
+		fail_unless(strstr(line, "\"level\": \"") != NULL);
+		const char *message = strstr(line, "\"message\": ");
+		fail_unless(message != NULL);
+		int thread, i;
+		if (sscanf(message, "\"message\": \"thread %d message %d\"",
+			   &thread, &i) == 2) {
+			/* Messages of a thread are in order. */
+			fail_unless(i == next[thread]);
+			next[thread]++;
+		} else if (strstr(message, "ratelimited") != NULL) {
+			ratelimited++;
+		} else if (strstr(message, "a \\\"quoted\\\"\\nmessage")) {
+			quoted = true;
+		}
+	}
+	fclose(f);
+	for (int i = 0; i < THREADS; i++)
+		fail_unless(next[i] == MESSAGES_PER_THREAD);
+	fail_unless(ratelimited == SAY_RATELIMIT_BURST);
+	fail_unless(quoted);
+
+	footer();
+}
+
+int main()
+{
+	memory_init();
+	fiber_init();
+	say_ratelimit_test();
+	remove(filename);
+	say_logger_init(filename, S_INFO, false, "json", true, false);
+	say_json_test();
+	remove(filename);
+	fiber_free();
+	memory_free();
+	return 0;
+}
@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <limits.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include "unit.h"
 
@@ -15,6 +16,91 @@ slab_arena_print(struct slab_arena *arena)
 	       arena->used, arena->slab_size);
 }
 
+static void
+slab_test_numa_nodes_parse(const char *str)
+{
+	unsigned long nodes;
+	int rc = slab_numa_nodes_parse(str, &nodes);
+	printf("parse '%s': %s", str, rc == 0 ? "ok" : "error");
+	if (rc == 0)
+		printf(", mask = %#lx", nodes);
+	printf("\n");
+}
+
+static void
+slab_test_placement()
+{
+	slab_test_numa_nodes_parse("0");
+	slab_test_numa_nodes_parse("0-3");
+	slab_test_numa_nodes_parse("0,2-3,5");
+	slab_test_numa_nodes_parse("");
+	slab_test_numa_nodes_parse("3-1");
+	slab_test_numa_nodes_parse("1,x");
+	slab_test_numa_nodes_parse("64");
+
+	/*
+	 * Whether huge pages and NUMA policies are available
+	 * depends on the host, but the arena must always work,
+	 * falling back to regular pages.
+	 */
+	struct quota quota;
+	struct slab_arena arena;
+	for (int h = 0; h < slab_hugepages_MAX; h++) {
+		for (int n = 0; n < slab_numa_MAX; n++) {
+			struct slab_placement placement;
+			placement.hugepages = (enum slab_hugepages) h;
+			placement.numa = (enum slab_numa) n;
+			placement.numa_nodes = 0;
+			quota_init(&quota, 4 * SLAB_HUGE_PAGE_SIZE);
+			slab_arena_create_with_placement(&arena, &quota,
+				SLAB_HUGE_PAGE_SIZE, SLAB_HUGE_PAGE_SIZE,
+				MAP_PRIVATE, &placement);
+			char *ptr = (char *) slab_map(&arena);
+			char *ptr1 = (char *) slab_map(&arena);
+			bool ok = ptr != NULL && ptr1 != NULL;
+			if (ok) {
+				ptr[0] = ptr1[SLAB_HUGE_PAGE_SIZE - 1] = 1;
+			}
+			size_t placed = arena.hugetlb_size +
+				arena.madvise_size;
+			if (h != SLAB_HUGEPAGES_OFF && placed == 0 &&
+			    arena.placement_errors == 0)
+				ok = false;
+			if (n != SLAB_NUMA_DEFAULT && arena.numa_size == 0 &&
+			    arena.placement_errors == 0)
+				ok = false;
+			printf("placement %s/%s: %s\n", slab_hugepages_strs[h],
+			       slab_numa_strs[n], ok ? "ok" : "fail");
+			slab_unmap(&arena, ptr);
+			slab_unmap(&arena, ptr1);
+			slab_arena_destroy(&arena);
+		}
+	}
+}
+
+static void
+slab_test_release(int flags)
+{
+	struct quota quota;
+	struct slab_arena arena;
+	quota_init(&quota, 2 * SLAB_MIN_SIZE);
+	slab_arena_create(&arena, &quota, 2 * SLAB_MIN_SIZE, 1, flags);
+	char *ptr = (char *) slab_map(&arena);
+	char *ptr1 = (char *) slab_map(&arena);
+	memset(ptr, 'x', arena.slab_size);
+	slab_release(&arena, ptr);
+	printf("released: quota used = %zu, released = %zu\n",
+	       quota_used(&quota), arena.released_size);
+	char *ptr2 = (char *) slab_map(&arena);
+	printf("remapped: %s, zero-filled: %s, quota used = %zu\n",
+	       ptr2 == ptr ? "same" : "other",
+	       ptr2[arena.slab_size - 1] == 0 ? "yes" : "no",
+	       quota_used(&quota));
+	slab_unmap(&arena, ptr1);
+	slab_unmap(&arena, ptr2);
+	slab_arena_destroy(&arena);
+}
+
 int main()
 {
 	struct quota quota;
@@ -42,4 +128,9 @@ int main()
 	slab_arena_create(&arena, &quota, 3000000, 1, MAP_PRIVATE);
 	slab_arena_print(&arena);
 	slab_arena_destroy(&arena);
+
+	slab_test_placement();
+
+	slab_test_release(MAP_PRIVATE);
+	slab_test_release(MAP_SHARED);
 }
@@ -10,6 +10,57 @@
 enum { NRUNS = 25, ITERATIONS = 1000, MAX_ALLOC = 5000000 };
 static struct slab *runs[NRUNS];
 
+/**
+ * Free slabs are released by slab_cache_trim() only if they
+ * stayed unused since the previous call.
+ */
+static void
+slab_test_trim()
+{
+	struct quota quota;
+	struct slab_arena arena;
+	struct slab_cache cache;
+
+	quota_init(&quota, UINT_MAX);
+	slab_arena_create(&arena, &quota, 0, 4000000, MAP_PRIVATE);
+	slab_cache_create(&cache, &arena);
+
+	uint8_t order = cache.order_max;
+	struct slab *slabs[4];
+	for (int i = 0; i < 4; i++)
+		slabs[i] = slab_get_with_order(&cache, order);
+	for (int i = 0; i < 4; i++)
+		slab_put(&cache, slabs[i]);
+	printf("first trim: %zu slabs\n",
+	       slab_cache_trim(&cache) / arena.slab_size);
+	/* Two slabs are reused during the period. */
+	slabs[0] = slab_get_with_order(&cache, order);
+	slabs[1] = slab_get_with_order(&cache, order);
+	slab_put(&cache, slabs[1]);
+	slab_cache_check(&cache);
+	printf("second trim: %zu slabs\n",
+	       slab_cache_trim(&cache) / arena.slab_size);
+	slab_cache_check(&cache);
+	printf("quota used: %zu slabs, released: %zu slabs\n",
+	       quota_used(&quota) / arena.slab_size,
+	       arena.released_size / arena.slab_size);
+	/* Released slabs are mapped again. */
+	for (int i = 1; i < 4; i++)
+		slabs[i] = slab_get_with_order(&cache, order);
+	slab_cache_check(&cache);
+	printf("quota used: %zu slabs, released: %zu slabs\n",
+	       quota_used(&quota) / arena.slab_size,
+	       arena.released_size / arena.slab_size);
+	for (int i = 0; i < 4; i++)
+		slab_put(&cache, slabs[i]);
+	printf("release: %zu slabs\n",
+	       slab_cache_release(&cache) / arena.slab_size);
+	slab_cache_check(&cache);
+
+	slab_cache_destroy(&cache);
+	slab_arena_destroy(&arena);
+}
+
 int main()
 {
 	srand(time(0));
@@ -38,4 +89,6 @@ int main()
 	}
 
 	slab_cache_destroy(&cache);
+
+	slab_test_trim();
 }
@@ -0,0 +1,92 @@
+#include "small/small.h"
+#include "small/quota.h"
+#include "unit.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Memory footprint of small tuples: how many bytes the
+ * allocator spends per tuple of a given msgpack size, for
+ * the old 12-byte tuple header with 8-byte size classes and
+ * the current 8-byte one with 4-byte size classes of the
+ * tuple allocator.
+ * The numbers are deterministic, so the output is compared
+ * with the expected result like any other unit test.
+ */
+
+enum {
+	OBJSIZE_MIN = 16,
+	TUPLE_COUNT = 100000,
+	HEADER_SIZE_OLD = 12,
+	HEADER_SIZE = 8,
+	STEP_SIZE_OLD = 8,
+	STEP_SIZE = 4,
+};
+
+static const float ALLOC_FACTOR = 1.1;
+
+struct slab_arena arena;
+struct slab_cache cache;
+struct small_alloc alloc;
+struct quota quota;
+
+static void *ptrs[TUPLE_COUNT];
+
+static int
+stats_noop_cb(const struct mempool_stats *stats, void *cb_ctx)
+{
+	(void) stats;
+	(void) cb_ctx;
+	return 0;
+}
+
+/**
+ * Print bytes per tuple of the given msgpack size:
+ * the object size and the share of slab memory.
+ */
+static void
+bytes_per_tuple(size_t bsize, size_t header_size, uint32_t step_size)
+{
+	size_t size = header_size + bsize;
+	small_alloc_create_with_step(&alloc, &cache, OBJSIZE_MIN,
+				     ALLOC_FACTOR, step_size);
+	for (int i = 0; i < TUPLE_COUNT; i++) {
+		ptrs[i] = smalloc_nothrow(&alloc, size);
+		fail_unless(ptrs[i] != NULL);
+	}
+	struct small_stats totals;
+	small_stats(&alloc, &totals, stats_noop_cb, NULL);
+	printf("bsize %zu, header %zu, step %u: %zu bytes, %.2f with slabs\n",
+	       bsize, header_size, step_size, totals.used / TUPLE_COUNT,
+	       (double) totals.total / TUPLE_COUNT);
+	for (int i = 0; i < TUPLE_COUNT; i++)
+		smfree(&alloc, ptrs[i], size);
+	small_alloc_destroy(&alloc);
+}
+
+static void
+small_alloc_bytes()
+{
+	header();
+
+	static const size_t bsizes[] = { 10, 16, 20, 24, 30, 40, 50, 64 };
+	for (size_t i = 0; i < sizeof(bsizes) / sizeof(*bsizes); i++) {
+		bytes_per_tuple(bsizes[i], HEADER_SIZE_OLD, STEP_SIZE_OLD);
+		bytes_per_tuple(bsizes[i], HEADER_SIZE, STEP_SIZE);
+	}
+
+	footer();
+}
+
+int main()
+{
+	quota_init(&quota, UINT_MAX);
+
+	slab_arena_create(&arena, &quota, 0, 4000000,
+			  MAP_PRIVATE);
+	slab_cache_create(&cache, &arena);
+
+	small_alloc_bytes();
+
+	slab_cache_destroy(&cache);
+}
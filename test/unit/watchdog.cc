@@ -0,0 +1,85 @@
+#include "memory.h"
+#include "fiber.h"
+#include "say.h"
+#include "watchdog.h"
+#include "unit.h"
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * A fiber which doesn't yield for longer than the threshold
+ * is reported by the watchdog while it is still running, and
+ * the iteration is reported when it ends.
+ */
+
+static const char *filename = "watchdog.log";
+
+static void
+stall_f(va_list ap)
+{
+	double busy = va_arg(ap, double);
+	ev_tstamp start = ev_time();
+	while (ev_time() - start < busy)
+		;
+}
+
+static void
+watchdog_stall_test()
+{
+	header();
+
+	watchdog_set_threshold(0.1);
+	struct fiber *fiber = fiber_new("stall", stall_f);
+	fiber_set_joinable(fiber, true);
+	uint32_t fid = fiber->fid;
+	fiber_start(fiber, 0.5);
+	fiber_join(fiber);
+	/* Let the iteration end. */
+	fiber_sleep(0.01);
+	watchdog_free();
+
+	FILE *f = fopen(filename, "r");
+	fail_unless(f != NULL);
+	char stalled[100], slow[100];
+	snprintf(stalled, sizeof(stalled), "event loop is stalled for "
+		 "more than 0.100 sec in fiber %u 'stall'", fid);
+	/* The fiber is recycled before the iteration ends. */
+	snprintf(slow, sizeof(slow), "fiber %u '' held the CPU", fid);
+	bool is_stalled = false, is_slow = false;
+	char line[PIPE_BUF];
+	while (fgets(line, sizeof(line), f) != NULL) {
+		if (strstr(line, stalled) != NULL)
+			is_stalled = true;
+		if (strstr(line, "event loop iteration took") != NULL &&
+		    strstr(line, slow) != NULL)
+			is_slow = true;
+	}
+	fclose(f);
+	fail_unless(is_stalled);
+	fail_unless(is_slow);
+
+	footer();
+}
+
+static void
+main_f(va_list ap)
+{
+	watchdog_stall_test();
+	ev_break(loop(), EVBREAK_ALL);
+}
+
+int main()
+{
+	memory_init();
+	fiber_init();
+	remove(filename);
+	say_logger_init(filename, S_INFO, false, "plain", false, false);
+	struct fiber *main = fiber_new("main", main_f);
+	fiber_wakeup(main);
+	ev_run(loop(), 0);
+	remove(filename);
+	fiber_free();
+	memory_free();
+	return 0;
+}